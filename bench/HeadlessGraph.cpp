@@ -0,0 +1,211 @@
+#include "pch.h"
+
+#include "ArrayCore.h"
+#include "CounterCore.h"
+#include "DisplayCore.h"
+#include "HeadlessGraph.h"
+#include "ScriptCore.h"
+#include "SwitchCore.h"
+#include "TopoOrder.h"
+#include "ValueCore.h"
+
+using json = nlohmann::json;
+
+namespace Mirael::Bench
+{
+
+using namespace NodeTypes::Cores;
+
+namespace
+{
+
+// a node's pins by their keys, in the pin order its core type gives
+NodePins getPins(NodeId nodeId, const json &pins, const NodePinKeys &keys)
+{
+    auto getPin = [&](const std::string &key) {
+        if (!pins.contains(key))
+            throw std::runtime_error(std::format("Node {} is missing pin '{}'.", nodeId, key));
+        return static_cast<PinId>(pins[key].get<uint64_t>());
+    };
+
+    NodePins result;
+    for (const auto &key : keys.inputs)
+        result.inputs.push_back(getPin(key));
+    for (const auto &key : keys.outputs)
+        result.outputs.push_back(getPin(key));
+    return result;
+}
+
+// as Graph::try_parse(), which only builds with the UI
+ExecutionMode parseExecutionMode(const std::string &s)
+{
+    if (s == "skipunchanged")
+        return ExecutionMode::SkipUnchanged;
+    else
+        return ExecutionMode::RunAll;
+}
+
+LuaGcMode parseLuaGcMode(const std::string &s)
+{
+    if (s == "framestep")
+        return LuaGcMode::FrameStep;
+    else if (s == "idlecollect")
+        return LuaGcMode::IdleCollect;
+    else if (s == "manual")
+        return LuaGcMode::Manual;
+    else
+        return LuaGcMode::Automatic;
+}
+
+} // namespace
+
+std::unique_ptr<HeadlessGraph> HeadlessGraph::deserialize(GraphId id, const json &j)
+{
+    auto graph   = std::make_unique<HeadlessGraph>();
+    graph->id_   = id;
+    graph->uid_  = j.value("uid", "");
+    graph->name_ = j.value("name", "");
+
+    if (j.contains("initlua"))
+        graph->initScript_ = j["initlua"].get<std::string>();
+
+    graph->executionMode_ = parseExecutionMode(j.value("execmode", "runall"));
+    graph->luaGcMode_     = parseLuaGcMode(j.value("gcmode", "automatic"));
+    graph->luaGcBudgetMs_ = j.value("gcbudget", graph->luaGcBudgetMs_);
+
+    graph->delta_->version          = 1;
+    graph->delta_->luaEnvInitScript = graph->initScript_;
+    if (j.contains("luastates"))
+        graph->setLuaStateCount(j["luastates"].get<uint32_t>());
+
+    // nodes are added in id order, so that runs of the same project are repeatable
+    std::vector<std::pair<NodeId, const json *>> nodes;
+    for (const auto &[key, value] : j.at("nodes").items())
+        nodes.emplace_back(static_cast<NodeId>(std::stoull(key)), &value);
+    std::ranges::sort(nodes, {}, &std::pair<NodeId, const json *>::first);
+    for (auto [nodeId, nodeJson] : nodes)
+        graph->addNode(nodeId, *nodeJson);
+
+    if (j.contains("links"))
+        for (const auto &[key, value] : j["links"].items())
+            graph->addLink(value);
+
+    graph->buildPlan();
+    return graph;
+}
+
+void HeadlessGraph::setLuaStateCount(uint32_t count)
+{
+    assert(delta_); // not yet posted
+    luaStateCount_           = std::clamp(count, 1u, Runner::MaxLuaStates);
+    delta_->luaStateCount    = luaStateCount_;
+    delta_->luaEnvInitScript = initScript_.value_or(""); // as only a reset creates the states
+}
+
+void HeadlessGraph::updateScriptStatuses()
+{
+    for (auto &node : nodes_)
+        if (node.scriptChannel)
+            if (auto taken = node.scriptChannel->pendingCoreStatus.tryAcceptLatest())
+                node.scriptStatus = std::move(*taken);
+}
+
+void HeadlessGraph::postTo(Runner &runner)
+{
+    assert(delta_ && plan_ && !cyclic_); // may only be called once, and never for a cyclic graph
+    runner.queueDelta(std::move(delta_));
+    runner.postPlan(std::move(plan_));
+}
+
+void HeadlessGraph::addNode(NodeId nodeId, const json &j)
+{
+    // each core type gives its node's saved config, pin keys and core, as the Node types themselves use them
+
+    const auto type   = j.at("type").get<std::string>();
+    const auto &pins  = j.at("pins");
+    const json config = j.contains("config") ? j["config"] : json::object();
+
+    auto &nodePins = nodePins_[nodeId];
+    std::unique_ptr<NodeCore> core;
+    std::shared_ptr<ScriptCore::Channel> scriptChannel;
+    std::string label = type;
+
+    if (type == "script") {
+        auto settings = ScriptCore::readSettings(config);
+        label         = settings.name.empty() ? label : settings.name;
+        nodePins      = getPins(nodeId, pins, ScriptCore::getPinKeys(settings));
+
+        ScriptCore::DebugInfo debugInfo{.graphNameWhenCreated = name_, .graphUid = uid_, .graphId = id_, .nodeId = nodeId};
+        scriptChannel = std::make_shared<ScriptCore::Channel>();
+        core          = ScriptCore::create(settings, std::move(debugInfo), scriptChannel);
+    } else if (type == "switch") {
+        auto settings = SwitchCore::readSettings(config);
+        nodePins      = getPins(nodeId, pins, SwitchCore::getPinKeys(settings));
+        core          = SwitchCore::create(settings, nodePins, std::make_shared<SwitchCore::Channel>());
+    } else if (type == "counter") {
+        nodePins = getPins(nodeId, pins, CounterCore::getPinKeys());
+        core     = CounterCore::create(CounterCore::readConfig(config), nodePins, std::make_shared<CounterCore::Channel>());
+    } else if (type == "value") {
+        nodePins = getPins(nodeId, pins, ValueCore::getPinKeys());
+        core     = ValueCore::create(ValueCore::readValue(config), nodePins, std::make_shared<ValueCore::Channel>());
+    } else if (type == "array") {
+        auto settings = ArrayCore::readSettings(config);
+        nodePins      = getPins(nodeId, pins, ArrayCore::getPinKeys(settings.op));
+        core          = ArrayCore::create(settings, nodePins, std::make_shared<ArrayCore::Channel>());
+    } else if (type == "display") {
+        nodePins = getPins(nodeId, pins, DisplayCore::getPinKeys());
+        core     = DisplayCore::create(nodePins, std::make_shared<DisplayCore::Channel>());
+    } else if (type != "comment") {
+        throw std::runtime_error(std::format("Node {} has unknown type '{}'.", nodeId, type));
+    }
+
+    auto &info = nodes_.emplace_back(
+        NodeInfo{.id = nodeId, .type = type, .label = std::move(label), .scriptChannel = std::move(scriptChannel)});
+    if (!core)
+        return;
+
+    core->internalChannel_ = info.internalChannel = std::make_shared<CoreInternalChannel>();
+    delta_->addedCores.try_emplace(nodeId, std::move(core));
+    delta_->addedOutputs.insert(delta_->addedOutputs.end(), nodePins.outputs.begin(), nodePins.outputs.end());
+}
+
+void HeadlessGraph::addLink(const json &j)
+{
+    // a link always runs from an output pin (a) to an input pin (b)
+    links_.push_back(ExecutionPlan::Link{.output = static_cast<PinId>(j.at("a").get<uint64_t>()),
+                                         .input  = static_cast<PinId>(j.at("b").get<uint64_t>())});
+}
+
+void HeadlessGraph::buildPlan()
+{
+    // the same ordering and plan a Graph builds, built up node by node and link by link
+    TopoOrder topoOrder;
+    std::unordered_map<PinId, NodeId> pinOwners;
+    for (const auto &node : nodes_) {
+        topoOrder.addNode(node.id);
+        const auto &pins = nodePins_.at(node.id);
+        for (auto pinId : pins.inputs)
+            pinOwners[pinId] = node.id;
+        for (auto pinId : pins.outputs)
+            pinOwners[pinId] = node.id;
+    }
+
+    for (const auto &link : links_) {
+        auto from = pinOwners.find(link.output), to = pinOwners.find(link.input);
+        if (from == pinOwners.end() || to == pinOwners.end())
+            throw std::runtime_error(std::format("Graph {} has a link between unknown pins ({} -> {}).", id_, link.output, link.input));
+        topoOrder.addEdge(from->second, to->second);
+    }
+    topoOrder.update();
+
+    cyclic_ = topoOrder.hasCycle();
+    if (cyclic_)
+        return;
+
+    plan_          = std::make_unique<ExecutionPlan>();
+    plan_->version = delta_->version;
+    plan_->setOrder(topoOrder, [this](NodeId nodeId, ExecutionPlan::NodePins &pins) { pins = nodePins_.at(nodeId); });
+    plan_->valueLinks = links_;
+}
+
+} // namespace Mirael::Bench
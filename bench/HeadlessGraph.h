@@ -0,0 +1,83 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "data.h"
+#include "NodeCore.h"
+#include "Runner.h"
+#include "ScriptCore.h"
+
+namespace Mirael::Bench
+{
+
+/*
+ * A HeadlessGraph stands in for a Graph where there is no UI.  It reads one graph of a saved project, creates the same
+ * Cores that the graph's Nodes would create, and hands them to a Runner along with an Execution Plan, exactly as a Graph
+ * does on load.  It keeps each Core's internal channel so that per-node metrics can be read back.
+ *
+ * Only what affects execution is read from the project - node positions, canvas state and run rate are ignored, though the
+ * execution mode and Lua GC mode are kept for the caller to run with.  The Lua state count is sent with the delta, as a
+ * Graph sends it with its init script.  Script Cores' statuses are kept too, so that a caller can tell when scripts fail.
+ */
+class HeadlessGraph
+{
+public:
+    using ScriptCore = NodeTypes::Cores::ScriptCore;
+
+    struct NodeInfo {
+        NodeId id;
+        std::string type;
+        std::string label;                                    // the script name for Script nodes, otherwise the type name
+        std::shared_ptr<CoreInternalChannel> internalChannel; // nullptr for nodes that have no Core
+        std::shared_ptr<ScriptCore::Channel> scriptChannel;   // nullptr for nodes other than Script nodes
+        std::optional<ScriptCore::CoreStatus> scriptStatus{}; // the latest its Core posted, if any
+    };
+
+    static std::unique_ptr<HeadlessGraph> deserialize(GraphId id, const nlohmann::json &j);
+
+    GraphId getId() const { return id_; }
+    const std::string &getName() const { return name_; }
+    std::span<const NodeInfo> getNodes() const { return nodes_; }
+    bool isCyclic() const { return cyclic_; }
+    ExecutionMode getExecutionMode() const { return executionMode_; }
+    LuaGcMode getLuaGcMode() const { return luaGcMode_; }
+    float getLuaGcBudgetMs() const { return luaGcBudgetMs_; }
+    uint32_t getLuaStateCount() const { return luaStateCount_; }
+    void setLuaStateCount(uint32_t count); // only before postTo()
+
+    // accepts each Script Core's latest status, as a Script node does every UI frame - a Core only posts when it changes
+    void updateScriptStatuses();
+
+    /// <summary>
+    /// Queue the delta creating every Core and output buffer, then post the plan.  May only be called once.
+    /// </summary>
+    void postTo(Runner &runner);
+
+private:
+    GraphId id_{};
+    std::string uid_, name_;
+    std::optional<std::string> initScript_{};
+    std::vector<NodeInfo> nodes_;
+    std::unordered_map<NodeId, ExecutionPlan::NodePins> nodePins_;
+    std::vector<ExecutionPlan::Link> links_;
+    std::unique_ptr<ResourceDelta> delta_ = std::make_unique<ResourceDelta>();
+    std::unique_ptr<ExecutionPlan> plan_{};
+    bool cyclic_                 = false;
+    ExecutionMode executionMode_ = ExecutionMode::RunAll;
+    LuaGcMode luaGcMode_         = LuaGcMode::Automatic;
+    float luaGcBudgetMs_         = RunRateSetting{}.luaGcBudgetMs;
+    uint32_t luaStateCount_      = 1;
+
+    void addNode(NodeId nodeId, const nlohmann::json &j);
+    void addLink(const nlohmann::json &j);
+    void buildPlan();
+};
+
+} // namespace Mirael::Bench
@@ -0,0 +1,206 @@
+// Benchmark of the Runner's work to adopt each Execution Plan while a large graph is edited one link at a time, comparing
+// full plans (as every plan used to be) against the patches a Graph now sends for small edits.
+//
+// A synthetic DAG is built in which every node has two inputs and one output, each input linked from a node shortly before
+// it, and half of the cores may run on any thread.  Edits relink a random input to the output of a random earlier node, so
+// the graph stays acyclic - but such a link may raise the levels of much of the graph below it, in which case the patch is
+// large and a full plan is sent instead, as Graph::updateExecutionPlan() would.  Each plan is built, posted, and adopted by
+// the Runner, and both steps are timed.
+//
+// usage: PlanPatchBench [editCount] [nodeCount...]   (default: 200 edits on 1k, 10k and 100k nodes)
+
+#include "pch.h"
+
+#include <random>
+
+#include "Runner.h"
+#include "TopoOrder.h"
+
+using namespace Mirael;
+using benchClock_t = std::chrono::steady_clock;
+
+namespace
+{
+
+// the bench only measures plan adoption, so its cores never run
+class BenchCore : public NodeCore
+{
+public:
+    explicit BenchCore(CoreAffinity affinity) : affinity_(affinity) {}
+    CoreAffinity getAffinity() const override { return affinity_; }
+
+protected:
+    void onFrame(const RunContext &) override {}
+
+private:
+    CoreAffinity affinity_;
+};
+
+// node k has id 4k+1, inputs 4k+2 and 4k+3, and output 4k+4
+NodeId getNodeId(size_t k) { return static_cast<NodeId>(4 * k + 1); }
+PinId getInputPin(size_t k, size_t j) { return static_cast<PinId>(4 * k + 2 + j); }
+PinId getOutputPin(size_t k) { return static_cast<PinId>(4 * k + 4); }
+size_t getNodeIndex(GraphElementId id) { return static_cast<size_t>((id - 1) / 4); }
+size_t getInputIndex(PinId pinId) { return 2 * getNodeIndex(pinId) + (pinId - getInputPin(getNodeIndex(pinId), 0)); }
+
+struct BenchGraph {
+    size_t nodeCount = 0;
+    std::vector<PinId> linkedOutputs; // per input index - the output linked to it, or 0
+    TopoOrder topoOrder;
+    std::vector<NodeId> levelChanges;
+
+    ExecutionPlan::NodePins getPins(size_t k) const
+    {
+        return ExecutionPlan::NodePins{.inputs = {getInputPin(k, 0), getInputPin(k, 1)}, .outputs = {getOutputPin(k)}};
+    }
+};
+
+BenchGraph buildGraph(size_t nodeCount, std::mt19937 &rng)
+{
+    BenchGraph graph;
+    graph.nodeCount = nodeCount;
+    graph.linkedOutputs.assign(2 * nodeCount, 0);
+    for (size_t k = 0; k < nodeCount; k++)
+        graph.topoOrder.addNode(getNodeId(k));
+
+    for (size_t k = 1; k < nodeCount; k++) {
+        for (size_t j = 0; j < 2; j++) {
+            if (j && rng() % 2)
+                continue;
+            auto from = std::uniform_int_distribution<size_t>(k > 64 ? k - 64 : 0, k - 1)(rng);
+            graph.linkedOutputs[2 * k + j] = getOutputPin(from);
+            graph.topoOrder.addEdge(getNodeId(from), getNodeId(k));
+        }
+    }
+    graph.topoOrder.update();
+    graph.topoOrder.takeLevelChanges(graph.levelChanges);
+    return graph;
+}
+
+void buildFullPlan(const BenchGraph &graph, ExecutionPlan &plan)
+{
+    plan.nodeExecutionOrder.reserve(graph.nodeCount);
+    plan.nodeLevels.reserve(graph.nodeCount);
+    plan.nodePins.reserve(graph.nodeCount);
+    graph.topoOrder.forEachInOrder([&](NodeId nodeId, uint32_t level) {
+        plan.nodeExecutionOrder.push_back(nodeId);
+        plan.nodeLevels.push_back(level);
+        plan.nodePins.push_back(graph.getPins(getNodeIndex(nodeId)));
+    });
+
+    for (size_t i = 0; i < graph.linkedOutputs.size(); i++)
+        if (graph.linkedOutputs[i])
+            plan.valueLinks.push_back(ExecutionPlan::Link{.output = graph.linkedOutputs[i], .input = getInputPin(i / 2, i % 2)});
+}
+
+// as Graph::buildPlanPatch() - the node owning the edited input is updated along with those whose level changed
+void buildPlanPatch(const BenchGraph &graph, PinId editedInput, ExecutionPlan &plan)
+{
+    plan.isPatch = true;
+    auto update  = [&](NodeId nodeId) {
+        plan.updatedNodes.push_back(ExecutionPlan::NodeUpdate{
+            .nodeId = nodeId, .level = graph.topoOrder.getLevel(nodeId), .pins = graph.getPins(getNodeIndex(nodeId))});
+    };
+
+    const NodeId editedNodeId = getNodeId(getNodeIndex(editedInput));
+    if (std::ranges::find(graph.levelChanges, editedNodeId) == graph.levelChanges.end())
+        update(editedNodeId);
+    for (auto nodeId : graph.levelChanges)
+        update(nodeId);
+    plan.linkedInputs.push_back(ExecutionPlan::Link{.output = graph.linkedOutputs[getInputIndex(editedInput)], .input = editedInput});
+}
+
+std::unique_ptr<ResourceDelta> buildDelta(const BenchGraph &graph)
+{
+    auto delta     = std::make_unique<ResourceDelta>();
+    delta->version = 1;
+    for (size_t k = 0; k < graph.nodeCount; k++) {
+        delta->addedCores.try_emplace(getNodeId(k), std::make_unique<BenchCore>(k % 2 ? CoreAffinity::Any : CoreAffinity::LuaThread));
+        delta->addedOutputs.push_back(getOutputPin(k));
+    }
+    return delta;
+}
+
+double toMs(benchClock_t::duration d) { return std::chrono::duration<double, std::milli>(d).count(); }
+
+struct Contender {
+    Runner runner;
+    benchClock_t::duration build{}, adopt{};
+
+    template <typename Build> void post(PlanVersion version, Build &&build)
+    {
+        auto t0       = benchClock_t::now();
+        auto plan     = std::make_unique<ExecutionPlan>();
+        plan->version = version;
+        build(*plan);
+        auto t1 = benchClock_t::now();
+        runner.postPlan(std::move(plan));
+        runner.adoptPendingPlans();
+        auto t2 = benchClock_t::now();
+        this->build += t1 - t0;
+        adopt += t2 - t1;
+    }
+};
+
+void runBench(size_t nodeCount, size_t editCount)
+{
+    std::mt19937 rng(1234);
+    auto graph = buildGraph(nodeCount, rng);
+
+    Contender full, patched;
+    for (auto *contender : {&full, &patched}) {
+        contender->runner.queueDelta(buildDelta(graph));
+        contender->post(1, [&](ExecutionPlan &plan) { buildFullPlan(graph, plan); });
+        contender->build = contender->adopt = {};
+    }
+
+    size_t patchCount = 0, levelChangeCount = 0;
+    for (size_t e = 0; e < editCount; e++) {
+        // relink a random input of a node other than the first to the output of a random node before it
+        const size_t k    = 1 + rng() % (nodeCount - 1);
+        const size_t j    = rng() % 2;
+        const size_t from = rng() % k;
+        auto &linked      = graph.linkedOutputs[2 * k + j];
+        if (linked)
+            graph.topoOrder.removeEdge(getNodeId(getNodeIndex(linked)), getNodeId(k));
+        linked = getOutputPin(from);
+        graph.topoOrder.addEdge(getNodeId(from), getNodeId(k));
+
+        graph.topoOrder.update();
+        const bool levelsTracked = graph.topoOrder.takeLevelChanges(graph.levelChanges);
+        levelChangeCount += graph.levelChanges.size();
+
+        const PlanVersion version = 2 + e;
+        full.post(version, [&](ExecutionPlan &plan) { buildFullPlan(graph, plan); });
+        if (levelsTracked && (graph.levelChanges.size() + 2) * 4 <= nodeCount) {
+            patched.post(version, [&](ExecutionPlan &plan) { buildPlanPatch(graph, getInputPin(k, j), plan); });
+            patchCount++;
+        } else
+            patched.post(version, [&](ExecutionPlan &plan) { buildFullPlan(graph, plan); });
+    }
+
+    auto perEdit = [&](benchClock_t::duration d) { return toMs(d) / editCount; };
+    std::cout << std::format("nodes: {}, edits: {} ({} sent as patches, {:.1f} level changes per edit)\n", nodeCount, editCount,
+                             patchCount, static_cast<double>(levelChangeCount) / editCount);
+    std::cout << std::format("  per edit, full plans:  build {:10.4f} ms, adopt {:10.4f} ms\n", perEdit(full.build),
+                             perEdit(full.adopt));
+    std::cout << std::format("  per edit, patches:     build {:10.4f} ms, adopt {:10.4f} ms\n", perEdit(patched.build),
+                             perEdit(patched.adopt));
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const size_t editCount = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200;
+
+    std::vector<size_t> nodeCounts;
+    for (int i = 2; i < argc; i++)
+        nodeCounts.push_back(std::strtoul(argv[i], nullptr, 10));
+    if (nodeCounts.empty())
+        nodeCounts = {1'000, 10'000, 100'000};
+
+    for (auto nodeCount : nodeCounts)
+        runBench(nodeCount, editCount);
+    return 0;
+}
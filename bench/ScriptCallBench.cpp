@@ -0,0 +1,98 @@
+// Benchmark of the per-frame cost of calling a Script node's script, apart from any work the script does.
+//
+// A synthetic graph of trivial Script nodes is built, each linked from the one before it, and run for a number of frames
+// at an unlimited rate.  One script does nothing at all, so measures the call path alone; the other passes a value through
+// the input and output proxies, so measures those as well.  Each is reported as core execution time per call, which is
+// what the app's metrics attribute to the node.
+//
+// usage: ScriptCallBench [nodeCount] [frameCount]   (default: 1000 nodes for 1000 frames)
+
+#include "pch.h"
+
+#include "HeadlessGraph.h"
+
+using namespace Mirael;
+using Bench::HeadlessGraph;
+using json         = nlohmann::json;
+using benchClock_t = std::chrono::steady_clock;
+
+namespace
+{
+
+struct BenchScript {
+    const char *name;
+    const char *script;
+};
+
+constexpr BenchScript BenchScripts[] = {
+    {"empty", "-- nothing"},
+    {"passthrough", "output[1] = (input[1] or 0) + 1"},
+};
+
+// node k has id 3k+1, input 3k+2 and output 3k+3, and each input is linked from the output of the node before
+json buildProject(size_t nodeCount, const char *script)
+{
+    json nodes = json::object(), links = json::object();
+    for (size_t k = 0; k < nodeCount; k++) {
+        nodes[std::to_string(3 * k + 1)] = {{"type", "script"},
+                                            {"pins", {{"in1", 3 * k + 2}, {"out1", 3 * k + 3}}},
+                                            {"config", {{"name", std::format("node {}", k)}, {"script", script}}}};
+        if (k)
+            links[std::to_string(k)] = {{"a", 3 * k}, {"b", 3 * k + 2}};
+    }
+    return {{"name", "ScriptCallBench"}, {"nodes", std::move(nodes)}, {"links", std::move(links)}};
+}
+
+void runFrames(Runner &runner, uint64_t frameCount)
+{
+    runner.setFrameLimit(frameCount);
+    runner.run({.rateMode = RunRateMode::Unlimited, .desiredFramesPerSecond = 0.0f});
+    runner.waitUntilFinished();
+    runner.stop();
+}
+
+// the core execution time of every frame run since the last call
+FrameMetricsBucket takeCoreExecution(Runner &runner)
+{
+    FrameMetricsBucket total{};
+    auto read = [&]() {
+        const auto &bucket = runner.getMetricsBuckets().coreExecution;
+        total.count += bucket.count;
+        total.totalNs += bucket.totalNs;
+    };
+    while (runner.releaseMetricsBuckets())
+        read();
+    runner.flushMetricsBuckets();
+    while (runner.releaseMetricsBuckets())
+        read();
+    return total;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const size_t nodeCount    = argc > 1 ? std::stoull(argv[1]) : 1'000;
+    const uint64_t frameCount = argc > 2 ? std::stoull(argv[2]) : 1'000;
+
+    std::cout << std::format("{} script nodes, {} frames\n", nodeCount, frameCount);
+    std::cout << std::format("  {:<12} {:>14} {:>14}\n", "script", "ns per call", "us per frame");
+
+    for (const auto &[name, script] : BenchScripts) {
+        auto graph = HeadlessGraph::deserialize(1, buildProject(nodeCount, script));
+        Runner runner;
+        graph->postTo(runner);
+
+        runFrames(runner, 1); // has each script core submit its script for compilation
+        runner.waitUntilScriptsCompiled();
+        runFrames(runner, 10); // loads the scripts and warms the JIT
+        takeCoreExecution(runner);
+
+        runFrames(runner, frameCount);
+        const auto coreExecution = takeCoreExecution(runner);
+
+        const double nsPerFrame = static_cast<double>(coreExecution.totalNs) / std::max<uint64_t>(coreExecution.count, 1);
+        std::cout << std::format("  {:<12} {:>14.1f} {:>14.1f}\n", name, nsPerFrame / nodeCount, nsPerFrame / 1000.0);
+    }
+    return 0;
+}
@@ -0,0 +1,272 @@
+// Benchmark comparing the Graph's former full toposort (rebuilding hash maps of in-degrees and downstream nodes for the whole
+// graph) against TopoOrder's incremental maintenance, when links are edited one at a time.
+//
+// A synthetic DAG is built in which each node takes one or two links from nodes shortly before it, with links in shuffled
+// order as they are when a project is loaded.  Link drags are then simulated: a random link is removed, and a new link from a
+// random node is added to the same input.  If the new link closes a cycle it is removed again and the old link restored, as
+// a user would undo it.  The full toposort runs once per edit, as Graph::updateExecutionPlan() used to; the incremental order
+// is updated per edit and then read out in full, as the plan still needs it.
+//
+// usage: TopoOrderBench [dragCount] [nodeCount...]   (default: 200 drags on 1k, 10k and 100k nodes)
+
+#include "pch.h"
+
+#include <random>
+
+#include "TopoOrder.h"
+
+using namespace Mirael;
+using benchClock_t = std::chrono::steady_clock;
+
+namespace
+{
+
+struct BenchLink {
+    NodeId from, to;
+};
+
+struct SyntheticGraph {
+    std::vector<NodeId> nodes;
+    std::unordered_map<LinkId, BenchLink> links;
+    LinkId nextLinkId = 1;
+};
+
+// the former Graph::toposort(), minus the Graph
+std::vector<NodeId> fullToposort(const SyntheticGraph &graph, std::vector<uint32_t> &levels, bool &cycleDetected)
+{
+    std::vector<NodeId> result;
+    std::unordered_map<NodeId, int> inDegree;
+    std::unordered_map<NodeId, uint32_t> level;
+    std::unordered_map<NodeId, std::vector<NodeId>> downstream;
+    std::vector<NodeId> queue;
+
+    const auto nodeCount = graph.nodes.size();
+    result.reserve(nodeCount);
+    inDegree.reserve(nodeCount);
+    level.reserve(nodeCount);
+    downstream.reserve(nodeCount);
+    queue.reserve(nodeCount);
+
+    for (auto id : graph.nodes) {
+        inDegree.try_emplace(id, 0);
+        level.try_emplace(id, 0);
+        downstream.try_emplace(id);
+    }
+
+    for (auto &[id, link] : graph.links) {
+        inDegree.at(link.to)++;
+        downstream.at(link.from).push_back(link.to);
+    }
+
+    for (auto &[id, degree] : inDegree)
+        if (degree == 0)
+            queue.push_back(id);
+
+    while (!queue.empty()) {
+        auto id = queue.back();
+        queue.pop_back();
+        result.push_back(id);
+        auto nextLevel = level.at(id) + 1;
+        for (auto next : downstream.at(id)) {
+            auto &l = level.at(next);
+            l       = std::max(l, nextLevel);
+            if (!--inDegree.at(next))
+                queue.push_back(next);
+        }
+    }
+
+    levels.clear();
+    levels.reserve(result.size());
+    for (auto id : result)
+        levels.push_back(level.at(id));
+
+    cycleDetected = result.size() != nodeCount;
+    return result;
+}
+
+SyntheticGraph buildGraph(size_t nodeCount, std::mt19937 &rng)
+{
+    SyntheticGraph graph;
+    for (size_t i = 0; i < nodeCount; i++)
+        graph.nodes.push_back(static_cast<NodeId>(i + 1));
+
+    std::vector<BenchLink> links;
+    for (size_t i = 1; i < nodeCount; i++) {
+        const size_t inputs = 1 + rng() % 2;
+        for (size_t k = 0; k < inputs; k++) {
+            auto from = std::uniform_int_distribution<size_t>(i > 64 ? i - 64 : 0, i - 1)(rng);
+            links.push_back(BenchLink{.from = graph.nodes[from], .to = graph.nodes[i]});
+        }
+    }
+    std::shuffle(links.begin(), links.end(), rng);
+    for (auto &link : links)
+        graph.links.try_emplace(graph.nextLinkId++, link);
+    return graph;
+}
+
+// one edit, a link removal or addition, as it reaches the Graph
+struct Edit {
+    bool add;
+    LinkId linkId;
+    BenchLink link;
+};
+
+// Generates the link drags up front, so both contenders replay exactly the same edits.  Cycle checks use a TopoOrder
+// private to the generator.
+std::vector<Edit> generateEdits(SyntheticGraph graph, size_t dragCount, std::mt19937 &rng, size_t &cycleCount)
+{
+    TopoOrder topo;
+    for (auto id : graph.nodes)
+        topo.addNode(id);
+    for (auto &[id, link] : graph.links)
+        topo.addEdge(link.from, link.to);
+    topo.update();
+
+    std::vector<LinkId> linkIds;
+    for (auto &[id, link] : graph.links)
+        linkIds.push_back(id);
+    std::ranges::sort(linkIds);
+
+    std::vector<Edit> edits;
+    cycleCount = 0;
+    for (size_t d = 0; d < dragCount; d++) {
+        const size_t index = rng() % linkIds.size();
+        const LinkId oldId = linkIds[index];
+        const auto oldLink = graph.links.at(oldId);
+        edits.push_back(Edit{.add = false, .linkId = oldId, .link = oldLink});
+        topo.removeEdge(oldLink.from, oldLink.to);
+        topo.update();
+        graph.links.erase(oldId);
+
+        const BenchLink newLink{.from = graph.nodes[rng() % graph.nodes.size()], .to = oldLink.to};
+        const LinkId newId = graph.nextLinkId++;
+        edits.push_back(Edit{.add = true, .linkId = newId, .link = newLink});
+        topo.addEdge(newLink.from, newLink.to);
+        topo.update();
+        if (!topo.hasCycle()) {
+            graph.links.try_emplace(newId, newLink);
+            linkIds[index] = newId;
+        } else {
+            // undone by the user - and the original link restored, so the graph stays roughly the same shape
+            cycleCount++;
+            topo.removeEdge(newLink.from, newLink.to);
+            edits.push_back(Edit{.add = false, .linkId = newId, .link = newLink});
+            topo.addEdge(oldLink.from, oldLink.to);
+            topo.update();
+            const LinkId restoredId = graph.nextLinkId++;
+            graph.links.try_emplace(restoredId, oldLink);
+            edits.push_back(Edit{.add = true, .linkId = restoredId, .link = oldLink});
+            linkIds[index] = restoredId;
+        }
+    }
+    return edits;
+}
+
+double toMs(benchClock_t::duration d) { return std::chrono::duration<double, std::milli>(d).count(); }
+
+void runBench(size_t nodeCount, size_t dragCount)
+{
+    std::mt19937 rng(1234);
+    auto graph = buildGraph(nodeCount, rng);
+    size_t cycleCount;
+    const auto edits = generateEdits(graph, dragCount, rng, cycleCount);
+
+    std::vector<NodeId> order;
+    std::vector<uint32_t> levels;
+    uint64_t checksum = 0;
+    auto readOrder    = [&](const TopoOrder &topo) {
+        order.clear();
+        levels.clear();
+        topo.forEachInOrder([&](NodeId nodeId, uint32_t level) {
+            order.push_back(nodeId);
+            levels.push_back(level);
+        });
+    };
+
+    // before: a full toposort per edit
+    auto fullGraph = graph;
+    bool cycle     = false;
+    auto start     = benchClock_t::now();
+    fullToposort(fullGraph, levels, cycle);
+    const double fullBuildMs = toMs(benchClock_t::now() - start);
+
+    start = benchClock_t::now();
+    for (const auto &edit : edits) {
+        if (edit.add)
+            fullGraph.links.try_emplace(edit.linkId, edit.link);
+        else
+            fullGraph.links.erase(edit.linkId);
+        order = fullToposort(fullGraph, levels, cycle);
+        checksum += cycle ? 1 : levels.back();
+    }
+    const double fullEditMs = toMs(benchClock_t::now() - start) / edits.size();
+
+    // after: the order maintained per edit, then read out
+    TopoOrder topo;
+    auto build = [&]() {
+        topo.clear();
+        for (auto id : graph.nodes)
+            topo.addNode(id);
+        for (auto &[id, link] : graph.links)
+            topo.addEdge(link.from, link.to);
+        topo.update();
+    };
+
+    start = benchClock_t::now();
+    build();
+    readOrder(topo);
+    const double incrementalBuildMs = toMs(benchClock_t::now() - start);
+
+    size_t visited = 0;
+    start          = benchClock_t::now();
+    for (const auto &edit : edits) {
+        if (edit.add)
+            topo.addEdge(edit.link.from, edit.link.to);
+        else
+            topo.removeEdge(edit.link.from, edit.link.to);
+        topo.update();
+        visited += topo.getLastVisitedCount();
+    }
+    const double incrementalEditMs = toMs(benchClock_t::now() - start) / edits.size();
+
+    build();
+    start = benchClock_t::now();
+    for (const auto &edit : edits) {
+        if (edit.add)
+            topo.addEdge(edit.link.from, edit.link.to);
+        else
+            topo.removeEdge(edit.link.from, edit.link.to);
+        topo.update();
+        if (!topo.hasCycle())
+            readOrder(topo);
+        checksum += topo.hasCycle() ? 1 : levels.back();
+    }
+    const double incrementalEditReadMs = toMs(benchClock_t::now() - start) / edits.size();
+
+    std::cout << std::format("nodes: {}, links: {}, edits: {} ({} drags, {} undone as cycles)\n", nodeCount, graph.links.size(),
+                             edits.size(), dragCount, cycleCount);
+    std::cout << std::format("  initial build, full toposort:    {:10.3f} ms\n", fullBuildMs);
+    std::cout << std::format("  initial build, incremental:      {:10.3f} ms\n", incrementalBuildMs);
+    std::cout << std::format("  per edit, full toposort:         {:10.4f} ms\n", fullEditMs);
+    std::cout << std::format("  per edit, incremental:           {:10.4f} ms ({:.1f} nodes visited)\n", incrementalEditMs,
+                             static_cast<double>(visited) / edits.size());
+    std::cout << std::format("  per edit, incremental + read:    {:10.4f} ms\n", incrementalEditReadMs);
+    std::cout << std::format("  (checksum {})\n", checksum);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const size_t dragCount = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200;
+
+    std::vector<size_t> nodeCounts;
+    for (int i = 2; i < argc; i++)
+        nodeCounts.push_back(std::strtoul(argv[i], nullptr, 10));
+    if (nodeCounts.empty())
+        nodeCounts = {1'000, 10'000, 100'000};
+
+    for (auto nodeCount : nodeCounts)
+        runBench(nodeCount, dragCount);
+    return 0;
+}
@@ -0,0 +1,149 @@
+// Microbenchmark comparing the Runner's former output buffer storage (one heap allocation per buffer, owned by a hash map)
+// against ValueBufferArena (chunked slabs, arranged in execution order).
+//
+// A 10k-node graph is simulated in which every node reads one upstream buffer and writes its own.  To resemble a graph that
+// was built up by editing, buffers are created in shuffled order, interleaved with unrelated allocations.  Frames walk the
+// same compiled slot pointer arrays the Runner uses, so the difference measured is purely that of buffer layout.  Delta
+// churn (removing and re-adding outputs) is measured separately.
+//
+// usage: ValueBufferArenaBench [nodeCount] [frameCount]
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <concepts>
+#include <cstdint>
+#include <cstdlib>
+#include <format>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+#include "ValueBuffer.h"
+#include "ValueBufferArena.h"
+
+using namespace Mirael;
+using benchClock_t = std::chrono::steady_clock;
+
+namespace
+{
+
+struct Layout {
+    std::vector<const ValueBuffer *> inputs; // per node, in execution order
+    std::vector<ValueBuffer *> outputs;      // per node, in execution order
+};
+
+double runFrames(const Layout &layout, int frameCount, double &checksum)
+{
+    const size_t n = layout.outputs.size();
+    double best    = 1e300;
+
+    for (int f = 0; f < frameCount; f++) {
+        const auto start = benchClock_t::now();
+        for (size_t i = 0; i < n; i++) {
+            auto *in = layout.inputs[i];
+            double v = in ? in->toDouble().value_or(0.0) : 1.0;
+            layout.outputs[i]->setValue(v * 0.5 + 1.0);
+        }
+        const auto ns = std::chrono::duration<double, std::nano>(benchClock_t::now() - start).count();
+        best          = std::min(best, ns);
+    }
+
+    checksum = 0.0;
+    for (auto *out : layout.outputs)
+        checksum += out->toDouble().value_or(0.0);
+    return best;
+}
+
+template <typename F> double timePerOp(size_t opCount, F &&fn)
+{
+    const auto start = benchClock_t::now();
+    fn();
+    return std::chrono::duration<double, std::nano>(benchClock_t::now() - start).count() / static_cast<double>(opCount);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const size_t nodeCount = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10'000;
+    const int frameCount   = argc > 2 ? std::atoi(argv[2]) : 1'000;
+    const size_t churn     = nodeCount / 10;
+
+    // node i reads the output of some earlier node (node 0 reads nothing), giving a graph deep enough to be realistic
+    std::mt19937 rng(1234);
+    std::vector<int64_t> upstream(nodeCount, -1);
+    for (size_t i = 1; i < nodeCount; i++)
+        upstream[i] = std::uniform_int_distribution<int64_t>(std::max<int64_t>(0, static_cast<int64_t>(i) - 64), i - 1)(rng);
+
+    std::vector<size_t> creationOrder(nodeCount);
+    for (size_t i = 0; i < nodeCount; i++)
+        creationOrder[i] = i;
+    std::shuffle(creationOrder.begin(), creationOrder.end(), rng);
+
+    // before: one heap allocation per buffer, interleaved with unrelated allocations
+    std::unordered_map<size_t, std::unique_ptr<ValueBuffer>> mapBuffers;
+    std::vector<std::unique_ptr<char[]>> heapNoise;
+    for (auto i : creationOrder) {
+        mapBuffers.try_emplace(i, std::make_unique<ValueBuffer>(nullptr));
+        heapNoise.push_back(std::make_unique<char[]>(std::uniform_int_distribution<size_t>(16, 256)(rng)));
+    }
+
+    Layout before;
+    for (size_t i = 0; i < nodeCount; i++) {
+        before.inputs.push_back(upstream[i] < 0 ? nullptr : mapBuffers.at(static_cast<size_t>(upstream[i])).get());
+        before.outputs.push_back(mapBuffers.at(i).get());
+    }
+
+    // after: arena slots acquired in the same shuffled order, then arranged in execution order as the Runner does
+    ValueBufferArena arena;
+    std::vector<ValueBufferArena::Slot> slots(nodeCount);
+    for (auto i : creationOrder)
+        slots[i] = arena.acquire();
+    arena.arrangeInOrder(slots);
+    for (size_t i = 0; i < nodeCount; i++)
+        slots[i] = static_cast<ValueBufferArena::Slot>(i);
+
+    Layout after;
+    for (size_t i = 0; i < nodeCount; i++) {
+        after.inputs.push_back(upstream[i] < 0 ? nullptr : &arena[slots[static_cast<size_t>(upstream[i])]]);
+        after.outputs.push_back(&arena[slots[i]]);
+    }
+
+    double beforeSum = 0.0, afterSum = 0.0;
+    const double beforeNs = runFrames(before, frameCount, beforeSum);
+    const double afterNs  = runFrames(after, frameCount, afterSum);
+    if (beforeSum != afterSum) {
+        std::cerr << "checksum mismatch\n";
+        return 1;
+    }
+
+    // delta churn: remove then re-add a tenth of the outputs, as an edit would
+    const double mapChurnNs = timePerOp(churn * 2, [&]() {
+        for (size_t i = 0; i < churn; i++)
+            mapBuffers.erase(creationOrder[i]);
+        for (size_t i = 0; i < churn; i++)
+            mapBuffers.try_emplace(creationOrder[i], std::make_unique<ValueBuffer>(nullptr));
+    });
+    const double arenaChurnNs = timePerOp(churn * 2, [&]() {
+        for (size_t i = 0; i < churn; i++)
+            arena.release(slots[creationOrder[i]]);
+        for (size_t i = 0; i < churn; i++)
+            slots[creationOrder[i]] = arena.acquire();
+    });
+
+    std::cout << std::format("nodes: {}, frames: {} (best frame reported)\n", nodeCount, frameCount);
+    std::cout << std::format("  frame, map of heap buffers:  {:10.0f} ns ({:.2f} ns/node)\n", beforeNs, beforeNs / nodeCount);
+    std::cout << std::format("  frame, arena in exec order:  {:10.0f} ns ({:.2f} ns/node)\n", afterNs, afterNs / nodeCount);
+    std::cout << std::format("  delta churn, map:            {:10.1f} ns/op\n", mapChurnNs);
+    std::cout << std::format("  delta churn, arena:          {:10.1f} ns/op\n", arenaChurnNs);
+    return 0;
+}
@@ -0,0 +1,520 @@
+// Headless frame benchmark.  Loads a saved project, builds each graph's Cores and Execution Plan without any UI, and drives
+// a Runner for an exact number of frames at an unlimited rate, so that Runner and Core changes can be measured on real
+// graphs from the command line (and from CI, with --json).
+//
+// The numbers reported are the ones the app's metrics window shows, gathered over the whole run instead of per UI frame:
+// total core execution time and runner overhead per frame, the cores executed and skipped per frame, and each node's own
+// execution time - the times with their percentiles (p50, p99, and p99.9 in the JSON) as well as their average, min and max.
+// --fps N runs the frames at a set rate instead, adding the period between frame starts, and how late each started after its
+// deadline, to the report - so measuring the Runner's pacing.
+//
+// Each graph runs in its saved execution mode unless --execmode (runall or skipunchanged) overrides it, and likewise its
+// Lua GC mode unless --gcmode (automatic, framestep, idlecollect or manual) does, with --gcbudget in ms, and its Lua state
+// count unless --luastates does.
+//
+// Built with MIRAEL_COUNT_ALLOCATIONS, it also reports the heap allocations made per frame, and by each node.  --zeroalloc
+// then makes it a check, for CI: it fails (exiting with 2) if any measured frame - every frame after the warmup - allocated.
+//
+// Scripts that fail to compile or run would otherwise only make a graph look fast, so each Script node whose script is failing
+// after the warmup, or after the measured frames, is reported on stderr (and in the JSON), and the bench exits with 3.
+//
+// --trace FILE records the measured frames of the last graph run as a Chrome trace (see FrameTrace).  --perfcounters samples
+// the CPU's hardware counters around each core, where available (see PerfCounters), and reports instructions per cycle and
+// cache and branch misses per thousand instructions, for the graph and for each node.
+//
+// usage: mirael_bench <project.mir> [--frames N] [--warmup N] [--fps N] [--graph ID] [--execmode MODE] [--gcmode MODE]
+//                     [--gcbudget MS] [--luastates N] [--zeroalloc] [--trace FILE] [--perfcounters] [--json]
+
+#include "pch.h"
+
+#include "FrameTrace.h"
+#include "HeadlessGraph.h"
+#include "PerfCounters.h"
+
+using namespace Mirael;
+using Bench::HeadlessGraph;
+using json         = nlohmann::json;
+using benchClock_t = std::chrono::steady_clock;
+
+namespace
+{
+
+struct Options {
+    std::filesystem::path projectPath;
+    uint64_t frames = 1'000;
+    uint64_t warmup = 10;
+    std::optional<float> fps{};
+    std::optional<GraphId> graphId{};
+    std::optional<ExecutionMode> executionMode{};
+    std::optional<LuaGcMode> luaGcMode{};
+    std::optional<float> luaGcBudgetMs{};
+    std::optional<uint32_t> luaStates{};
+    std::optional<std::filesystem::path> tracePath{};
+    bool zeroAlloc    = false;
+    bool perfCounters = false;
+    bool json         = false;
+};
+
+Options parseOptions(int argc, char **argv)
+{
+    Options options;
+    bool havePath = false;
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        auto nextNumber      = [&]() -> uint64_t {
+            if (i + 1 >= argc)
+                throw std::runtime_error(std::format("{} requires a value.", arg));
+            return std::stoull(argv[++i]);
+        };
+
+        if (arg == "--frames")
+            options.frames = nextNumber();
+        else if (arg == "--warmup")
+            options.warmup = nextNumber();
+        else if (arg == "--graph")
+            options.graphId = static_cast<GraphId>(nextNumber());
+        else if (arg == "--execmode") {
+            if (i + 1 >= argc)
+                throw std::runtime_error(std::format("{} requires a value.", arg));
+            std::string_view mode = argv[++i];
+            if (mode == "runall")
+                options.executionMode = ExecutionMode::RunAll;
+            else if (mode == "skipunchanged")
+                options.executionMode = ExecutionMode::SkipUnchanged;
+            else
+                throw std::runtime_error(std::format("Unknown execution mode '{}'.", mode));
+        } else if (arg == "--gcmode") {
+            if (i + 1 >= argc)
+                throw std::runtime_error(std::format("{} requires a value.", arg));
+            std::string_view mode = argv[++i];
+            if (mode == "automatic")
+                options.luaGcMode = LuaGcMode::Automatic;
+            else if (mode == "framestep")
+                options.luaGcMode = LuaGcMode::FrameStep;
+            else if (mode == "idlecollect")
+                options.luaGcMode = LuaGcMode::IdleCollect;
+            else if (mode == "manual")
+                options.luaGcMode = LuaGcMode::Manual;
+            else
+                throw std::runtime_error(std::format("Unknown Lua GC mode '{}'.", mode));
+        } else if (arg == "--gcbudget") {
+            if (i + 1 >= argc)
+                throw std::runtime_error(std::format("{} requires a value.", arg));
+            options.luaGcBudgetMs = std::stof(argv[++i]);
+        } else if (arg == "--fps") {
+            if (i + 1 >= argc)
+                throw std::runtime_error(std::format("{} requires a value.", arg));
+            options.fps = std::stof(argv[++i]);
+        } else if (arg == "--luastates")
+            options.luaStates = static_cast<uint32_t>(nextNumber());
+        else if (arg == "--zeroalloc")
+            options.zeroAlloc = true;
+        else if (arg == "--trace") {
+            if (i + 1 >= argc)
+                throw std::runtime_error(std::format("{} requires a value.", arg));
+            options.tracePath = argv[++i];
+        } else if (arg == "--perfcounters")
+            options.perfCounters = true;
+        else if (arg == "--json")
+            options.json = true;
+        else if (!arg.starts_with("--") && !havePath) {
+            options.projectPath = arg;
+            havePath            = true;
+        } else
+            throw std::runtime_error(std::format("Unexpected argument '{}'.", arg));
+    }
+
+    if (!havePath)
+        throw std::runtime_error("usage: mirael_bench <project.mir> [--frames N] [--warmup N] [--fps N] [--graph ID] "
+                                 "[--execmode MODE] [--gcmode MODE] [--gcbudget MS] [--luastates N] [--zeroalloc] [--trace FILE] "
+                                 "[--perfcounters] [--json]");
+    if (!options.frames)
+        throw std::runtime_error("--frames must be at least 1.");
+    if (options.fps && !(*options.fps > 0.0f))
+        throw std::runtime_error("--fps must be positive.");
+    if (options.zeroAlloc && !AllocationCounter::Enabled)
+        throw std::runtime_error("--zeroalloc requires a build with MIRAEL_COUNT_ALLOCATIONS.");
+    return options;
+}
+
+void merge(FrameStatsBucket &into, const FrameStatsBucket &from) { into.merge(from); }
+void merge(FrameHistogramBucket &into, const FrameHistogramBucket &from) { into.merge(from); }
+
+// Reads every folded bucket once the producer has stopped.  Only buckets reached by a successful release are read, since the
+// bucket read before that has either never been folded or was read by the previous collection.
+template <typename Release, typename Read, typename Flush> void collect(Release &&release, Read &&read, Flush &&flush)
+{
+    while (release())
+        read();
+    flush();
+    while (release())
+        read();
+}
+
+struct ScriptError {
+    size_t node;        // index into HeadlessGraph::getNodes()
+    const char *frames; // "warmup" or "measured", the frames after which it was failing
+    const char *status; // "compile" or "runtime"
+    std::string errorText;
+};
+
+struct GraphResult {
+    FrameHistogramBucket coreExecution{}, runnerOverhead{};
+    FrameStatsBucket executedCores{}, skippedCores{};                            // counts per frame
+    FrameStatsBucket imagePoolHits{}, imagePoolMisses{}, imagePoolResidentBytes{}; // likewise counts (or bytes) per frame
+    FrameHistogramBucket luaGc{};
+    FrameHistogramBucket framePeriod{}, frameLateness{}; // the latter only when paced
+    FrameStatsBucket luaHeapBytes{};
+    FrameStatsBucket allocations{}; // counts per frame
+    ScriptCompiler::CacheStats scriptCache{}; // over the whole run, warmup included
+    ExecutionMode executionMode = ExecutionMode::RunAll;
+    LuaGcMode luaGcMode         = LuaGcMode::Automatic;
+    std::vector<FrameHistogramBucket> nodes;         // parallel to HeadlessGraph::getNodes()
+    std::vector<FrameStatsBucket> nodeAllocations;   // likewise
+    std::vector<PerfCountersBucket> nodeCounters;    // likewise
+    PerfCountersBucket counters{};                   // of every node
+    double wallSeconds = 0.0;
+    std::string initScriptResult; // posted once, when the graph's delta is applied
+    std::vector<ScriptError> scriptErrors;
+};
+
+// Adds the Script nodes whose scripts are failing after the frames just run, as the nodes themselves would show them.
+void collectScriptErrors(HeadlessGraph &graph, const char *frames, std::vector<ScriptError> &errors)
+{
+    using enum HeadlessGraph::ScriptCore::ScriptStatus;
+    graph.updateScriptStatuses();
+    for (size_t i = 0; i < graph.getNodes().size(); i++) {
+        const auto &status = graph.getNodes()[i].scriptStatus;
+        if (status && (status->scriptStatus == CompileError || status->scriptStatus == RuntimeError))
+            errors.push_back({.node      = i,
+                              .frames    = frames,
+                              .status    = status->scriptStatus == CompileError ? "compile" : "runtime",
+                              .errorText = status->errorText});
+    }
+}
+
+// Runs the runner for exactly frameCount frames, and gathers the metrics of just those frames.
+GraphResult runFrames(Runner &runner, HeadlessGraph &graph, uint64_t frameCount, const RunRateSetting &runRate)
+{
+    GraphResult result;
+    result.nodes.resize(graph.getNodes().size());
+    result.nodeAllocations.resize(graph.getNodes().size());
+    result.nodeCounters.resize(graph.getNodes().size());
+    result.executionMode = runRate.executionMode;
+    result.luaGcMode     = runRate.luaGcMode;
+
+    runner.setFrameLimit(frameCount);
+    const auto start = benchClock_t::now();
+    runner.run(runRate);
+    runner.waitUntilFinished();
+    result.wallSeconds = std::chrono::duration<double>(benchClock_t::now() - start).count();
+    runner.stop();
+
+    collect([&]() { return runner.releaseMetricsBuckets(); },
+            [&]() {
+                merge(result.coreExecution, runner.getMetricsBuckets().coreExecution);
+                merge(result.runnerOverhead, runner.getMetricsBuckets().runnerOverhead);
+                merge(result.executedCores, runner.getMetricsBuckets().executedCores);
+                merge(result.skippedCores, runner.getMetricsBuckets().skippedCores);
+                merge(result.imagePoolHits, runner.getMetricsBuckets().imagePoolHits);
+                merge(result.imagePoolMisses, runner.getMetricsBuckets().imagePoolMisses);
+                merge(result.imagePoolResidentBytes, runner.getMetricsBuckets().imagePoolResidentBytes);
+                merge(result.luaGc, runner.getMetricsBuckets().luaGc);
+                merge(result.luaHeapBytes, runner.getMetricsBuckets().luaHeapBytes);
+                merge(result.allocations, runner.getMetricsBuckets().allocations);
+                merge(result.framePeriod, runner.getMetricsBuckets().framePeriod);
+                merge(result.frameLateness, runner.getMetricsBuckets().frameLateness);
+            },
+            [&]() { runner.flushMetricsBuckets(); });
+
+    for (size_t i = 0; i < graph.getNodes().size(); i++) {
+        if (auto &channel = graph.getNodes()[i].internalChannel) {
+            auto &metrics = channel->frameMetrics;
+            collect([&]() { return metrics.releaseReadBucket(); }, [&]() { merge(result.nodes[i], metrics.getReadBucket()); },
+                    [&]() { metrics.flushFoldBucket(); });
+
+            auto &allocations = channel->frameAllocations;
+            collect([&]() { return allocations.releaseReadBucket(); },
+                    [&]() { merge(result.nodeAllocations[i], allocations.getReadBucket()); },
+                    [&]() { allocations.flushFoldBucket(); });
+
+            auto &counters = channel->framePerfCounters;
+            collect([&]() { return counters.releaseReadBucket(); }, [&]() { result.nodeCounters[i].merge(counters.getReadBucket()); },
+                    [&]() { counters.flushFoldBucket(); });
+            result.counters.merge(result.nodeCounters[i]);
+        }
+    }
+
+    return result;
+}
+
+double toUs(uint64_t ns) { return static_cast<double>(ns) / 1000.0; }
+double hitRate(const GraphResult &r)
+{
+    const uint64_t acquisitions = r.imagePoolHits.total + r.imagePoolMisses.total;
+    return acquisitions ? static_cast<double>(r.imagePoolHits.total) / acquisitions : 0.0;
+}
+const char *toString(ExecutionMode mode) { return mode == ExecutionMode::SkipUnchanged ? "skipunchanged" : "runall"; }
+const char *toString(LuaGcMode mode)
+{
+    switch (mode) {
+    case LuaGcMode::FrameStep:
+        return "framestep";
+    case LuaGcMode::IdleCollect:
+        return "idlecollect";
+    case LuaGcMode::Manual:
+        return "manual";
+    default:
+        return "automatic";
+    }
+}
+
+json toJson(const FrameHistogramBucket &m)
+{
+    return {{"frames", m.count},
+            {"avgNs", m.average()},
+            {"minNs", m.minNs},
+            {"maxNs", m.maxNs},
+            {"p50Ns", m.percentile(50)},
+            {"p99Ns", m.percentile(99)},
+            {"p999Ns", m.percentile(99.9)}};
+}
+
+json toJson(const PerfCountersBucket &m) // null if nothing was counted
+{
+    if (!m.count)
+        return json();
+    return {{"frames", m.count},
+            {"cycles", m.total.cycles},
+            {"instructions", m.total.instructions},
+            {"cacheMisses", m.total.cacheMisses},
+            {"branchMisses", m.total.branchMisses},
+            {"instructionsPerCycle", m.instructionsPerCycle()},
+            {"cacheMissesPerKiloInstruction", m.cacheMissesPerKiloInstruction()},
+            {"branchMissesPerKiloInstruction", m.branchMissesPerKiloInstruction()}};
+}
+
+std::string toString(const PerfCountersBucket &m)
+{
+    return std::format("{:.2f} IPC, {:.2f} cache and {:.2f} branch misses per 1k instructions", m.instructionsPerCycle(),
+                       m.cacheMissesPerKiloInstruction(), m.branchMissesPerKiloInstruction());
+}
+
+void printText(const HeadlessGraph &graph, const GraphResult &r)
+{
+    std::cout << std::format("graph {} '{}': {} frames in {:.1f} ms ({:.1f} fps)\n", graph.getId(), graph.getName(),
+                             r.coreExecution.count, r.wallSeconds * 1000.0, r.coreExecution.count / r.wallSeconds);
+    if (!r.initScriptResult.empty())
+        std::cout << std::format("  init script: {}\n", r.initScriptResult);
+
+    std::cout << std::format("  {:<24} {:>10} {:>10} {:>10} {:>10} {:>10} {:>10}\n", "(us per frame)", "avg", "min", "max", "p50",
+                             "p99", "p99.9");
+    auto printRow = [](std::string_view name, const FrameHistogramBucket &m) {
+        std::cout << std::format("  {:<24} {:>10.2f} {:>10.2f} {:>10.2f} {:>10.2f} {:>10.2f} {:>10.2f}\n", name, toUs(m.average()),
+                                 toUs(m.minNs), toUs(m.maxNs), toUs(m.percentile(50)), toUs(m.percentile(99)),
+                                 toUs(m.percentile(99.9)));
+    };
+    printRow("core execution", r.coreExecution);
+    printRow("runner overhead", r.runnerOverhead);
+    printRow(std::format("lua gc ({})", toString(r.luaGcMode)), r.luaGc);
+    if (r.frameLateness.count) {
+        printRow("frame period", r.framePeriod);
+        printRow("start lateness", r.frameLateness);
+    }
+    std::cout << std::format("  cores per frame ({}): {:.1f} executed, {:.1f} skipped\n", toString(r.executionMode),
+                             r.executedCores.average(), r.skippedCores.average());
+    std::cout << std::format("  image pool: {:.1f} acquisitions per frame, {:.1f}% hits, {:.1f} MB resident\n",
+                             r.imagePoolHits.average() + r.imagePoolMisses.average(), 100.0 * hitRate(r),
+                             r.imagePoolResidentBytes.average() / (1024 * 1024));
+    std::cout << std::format("  lua heap ({} states): {:.1f} MB avg, {:.1f} MB max\n", graph.getLuaStateCount(),
+                             r.luaHeapBytes.average() / (1024 * 1024), r.luaHeapBytes.max / (1024.0 * 1024));
+    std::cout << std::format("  script cache: {} hits, {} misses, {} scripts cached\n", r.scriptCache.hits, r.scriptCache.misses,
+                             r.scriptCache.entries);
+    if (AllocationCounter::Enabled)
+        std::cout << std::format("  heap allocations: {:.1f} per frame, {} max\n", r.allocations.average(), r.allocations.max);
+    if (r.counters.count)
+        std::cout << std::format("  hardware counters: {}\n", toString(r.counters));
+
+    // nodes, most expensive first
+    std::vector<size_t> rows;
+    for (size_t i = 0; i < r.nodes.size(); i++)
+        if (r.nodes[i].count)
+            rows.push_back(i);
+    std::ranges::sort(rows, std::greater{}, [&](size_t i) { return r.nodes[i].average(); });
+
+    std::cout << std::format("\n  {:>6} {:<10} {:<24} {:>10} {:>10} {:>10} {:>10} {:>10} {:>7}\n", "node", "type", "label", "avg",
+                             "min", "max", "p50", "p99", "share");
+    const double total = static_cast<double>(std::max<uint64_t>(r.coreExecution.totalNs, 1));
+    for (auto i : rows) {
+        const auto &node = graph.getNodes()[i];
+        const auto &m    = r.nodes[i];
+        std::cout << std::format("  {:>6} {:<10} {:<24.24} {:>10.2f} {:>10.2f} {:>10.2f} {:>10.2f} {:>10.2f} {:>6.1f}%\n", node.id,
+                                 node.type, node.label, toUs(m.average()), toUs(m.minNs), toUs(m.maxNs), toUs(m.percentile(50)),
+                                 toUs(m.percentile(99)), 100.0 * m.totalNs / total);
+    }
+
+    // nodes that allocated, in the order above
+    for (auto i : rows) {
+        if (const auto &m = r.nodeAllocations[i]; m.total) {
+            const auto &node = graph.getNodes()[i];
+            std::cout << std::format("  {:>6} {:<10} {:<24.24} allocates {:.1f} per frame, {} max\n", node.id, node.type, node.label,
+                                     m.average(), m.max);
+        }
+    }
+
+    // and their hardware counters, if sampled
+    for (auto i : rows) {
+        if (const auto &m = r.nodeCounters[i]; m.count) {
+            const auto &node = graph.getNodes()[i];
+            std::cout << std::format("  {:>6} {:<10} {:<24.24} {}\n", node.id, node.type, node.label, toString(m));
+        }
+    }
+    std::cout << "\n";
+}
+
+json toJson(const HeadlessGraph &graph, const GraphResult &r)
+{
+    json nodes = json::array();
+    for (size_t i = 0; i < r.nodes.size(); i++) {
+        if (!r.nodes[i].count)
+            continue;
+        const auto &node = graph.getNodes()[i];
+        auto j           = toJson(r.nodes[i]);
+        j["id"]          = node.id;
+        j["type"]        = node.type;
+        j["label"]       = node.label;
+        if (AllocationCounter::Enabled)
+            j["allocationsPerFrame"] = r.nodeAllocations[i].average();
+        if (r.nodeCounters[i].count)
+            j["perfCounters"] = toJson(r.nodeCounters[i]);
+        nodes.push_back(std::move(j));
+    }
+
+    json scriptErrors = json::array();
+    for (const auto &e : r.scriptErrors) {
+        const auto &node = graph.getNodes()[e.node];
+        scriptErrors.push_back(
+            {{"id", node.id}, {"label", node.label}, {"frames", e.frames}, {"status", e.status}, {"errorText", e.errorText}});
+    }
+
+    return {{"id", graph.getId()},
+            {"name", graph.getName()},
+            {"wallSeconds", r.wallSeconds},
+            {"fps", r.coreExecution.count / r.wallSeconds},
+            {"initScriptResult", r.initScriptResult},
+            {"coreExecution", toJson(r.coreExecution)},
+            {"runnerOverhead", toJson(r.runnerOverhead)},
+            {"luaGc", toJson(r.luaGc)},
+            {"framePeriod", toJson(r.framePeriod)},
+            {"frameLateness", r.frameLateness.count ? toJson(r.frameLateness) : json()}, // null if not paced
+            {"executionMode", toString(r.executionMode)},
+            {"luaGcMode", toString(r.luaGcMode)},
+            {"luaStates", graph.getLuaStateCount()},
+            {"luaHeapBytes", r.luaHeapBytes.average()},
+            {"luaHeapMaxBytes", r.luaHeapBytes.max},
+            {"executedCoresPerFrame", r.executedCores.average()},
+            {"skippedCoresPerFrame", r.skippedCores.average()},
+            {"imagePoolAcquisitionsPerFrame", r.imagePoolHits.average() + r.imagePoolMisses.average()},
+            {"imagePoolHitRate", hitRate(r)},
+            {"imagePoolResidentBytes", r.imagePoolResidentBytes.average()},
+            {"scriptCacheHits", r.scriptCache.hits},
+            {"scriptCacheMisses", r.scriptCache.misses},
+            {"allocationsPerFrame", AllocationCounter::Enabled ? json(r.allocations.average()) : json()}, // null if not counted
+            {"allocationsMax", AllocationCounter::Enabled ? json(r.allocations.max) : json()},
+            {"perfCounters", toJson(r.counters)},
+            {"scriptErrors", std::move(scriptErrors)},
+            {"nodes", std::move(nodes)}};
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    try {
+        const auto options    = parseOptions(argc, argv);
+        const auto benchStart = benchClock_t::now();
+        PerfCounters::setEnabled(options.perfCounters);
+
+        std::ifstream file(options.projectPath);
+        if (!file)
+            throw std::runtime_error(std::format("Could not open '{}'.", options.projectPath.string()));
+        const auto project = json::parse(file);
+
+        json results   = json::array();
+        bool allocated = false; // in a measured frame, for --zeroalloc
+        bool failed    = false; // a script, after the warmup or the measured frames
+        for (const auto &[key, value] : project.at("graphs").items()) {
+            const auto graphId = static_cast<GraphId>(std::stoull(key));
+            if (options.graphId && *options.graphId != graphId)
+                continue;
+
+            auto graph = HeadlessGraph::deserialize(graphId, value);
+            if (graph->isCyclic()) {
+                std::cerr << std::format("graph {} '{}' is cyclic and cannot run - skipped\n", graphId, graph->getName());
+                continue;
+            }
+
+            const RunRateSetting runRate = {.rateMode               = options.fps ? RunRateMode::SetRate : RunRateMode::Unlimited,
+                                            .desiredFramesPerSecond = options.fps.value_or(0.0f),
+                                            .executionMode          = options.executionMode.value_or(graph->getExecutionMode()),
+                                            .luaGcMode              = options.luaGcMode.value_or(graph->getLuaGcMode()),
+                                            .luaGcBudgetMs          = options.luaGcBudgetMs.value_or(graph->getLuaGcBudgetMs())};
+            if (options.luaStates)
+                graph->setLuaStateCount(*options.luaStates);
+
+            Runner runner;
+            graph->postTo(runner);
+            std::vector<ScriptError> scriptErrors;
+            if (options.warmup) {
+                runFrames(runner, *graph, 1, runRate); // has each script core submit its script for compilation
+                runner.waitUntilScriptsCompiled();
+                runFrames(runner, *graph, options.warmup, runRate); // loads scripts and sizes every buffer - discarded
+                collectScriptErrors(*graph, "warmup", scriptErrors);
+            }
+            FrameTrace::setEnabled(options.tracePath.has_value()); // over the measured frames only
+            auto result = runFrames(runner, *graph, options.frames, runRate);
+            FrameTrace::setEnabled(false);
+            if (auto r = runner.tryAcceptInitScriptResult())
+                result.initScriptResult = std::move(*r);
+            result.scriptCache = runner.getScriptCompiler().getCacheStats();
+            collectScriptErrors(*graph, "measured", scriptErrors);
+            for (const auto &e : scriptErrors) {
+                const auto &node = graph->getNodes()[e.node];
+                std::cerr << std::format("graph {} '{}' node {} '{}' has a {} error after the {} frames: {}\n", graphId,
+                                         graph->getName(), node.id, node.label, e.status, e.frames, e.errorText);
+                failed = true;
+            }
+            result.scriptErrors = std::move(scriptErrors);
+            if (options.zeroAlloc && result.allocations.total) {
+                std::cerr << std::format("graph {} '{}' allocated {} times over {} frames\n", graphId, graph->getName(),
+                                         result.allocations.total, result.allocations.count);
+                allocated = true;
+            }
+
+            if (options.json)
+                results.push_back(toJson(*graph, result));
+            else
+                printText(*graph, result);
+        }
+
+        if (options.json)
+            std::cout << results.dump(2) << "\n";
+
+        if (options.perfCounters)
+            if (const char *reason = PerfCounters::getUnavailableReason())
+                std::cerr << std::format("hardware counters unavailable: {}\n", reason);
+
+        if (options.tracePath) {
+            std::ofstream out(*options.tracePath, std::ios::binary);
+            const double seconds = std::chrono::duration<double>(benchClock_t::now() - benchStart).count();
+            const size_t events  = FrameTrace::writeChromeTrace(out, seconds);
+            if (!out)
+                throw std::runtime_error(std::format("Could not write '{}'.", options.tracePath->string()));
+            std::cerr << std::format("traced {} events to '{}'\n", events, options.tracePath->string());
+        }
+        return failed ? 3 : allocated ? 2 : 0;
+    } catch (const std::exception &e) {
+        std::cerr << "mirael_bench: " << e.what() << "\n";
+        return 1;
+    }
+}
@@ -0,0 +1,77 @@
+#include "pch.h"
+
+#include "AllocationCounter.h"
+
+#ifdef MIRAEL_COUNT_ALLOCATIONS
+
+#include <new>
+
+namespace
+{
+
+thread_local uint64_t threadAllocations = 0; // constant-initialized, so safe to reach from operator new on any thread
+
+void *allocate(size_t size, size_t alignment) // alignment 0 for the default
+{
+    threadAllocations++;
+    size = size ? size : 1;
+    while (true) {
+        void *p = nullptr;
+        if (!alignment)
+            p = std::malloc(size);
+        else
+#ifdef _MSC_VER
+            p = _aligned_malloc(size, alignment);
+#else
+            p = std::aligned_alloc(alignment, (size + alignment - 1) & ~(alignment - 1)); // size must be a multiple here
+#endif
+        if (p)
+            return p;
+
+        // as the default operator new, give the new handler the chance to free memory, or to throw
+        auto handler = std::get_new_handler();
+        if (!handler)
+            throw std::bad_alloc();
+        handler();
+    }
+}
+
+} // namespace
+
+namespace Mirael
+{
+
+uint64_t AllocationCounter::getThreadCount() noexcept
+{
+    return threadAllocations;
+}
+
+} // namespace Mirael
+
+// Only these four forms are replaced, as the default array, nothrow and sized forms all forward to them.
+
+void *operator new(size_t size)
+{
+    return allocate(size, 0);
+}
+
+void *operator new(size_t size, std::align_val_t alignment)
+{
+    return allocate(size, static_cast<size_t>(alignment));
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::align_val_t) noexcept
+{
+#ifdef _MSC_VER
+    _aligned_free(p);
+#else
+    std::free(p);
+#endif
+}
+
+#endif
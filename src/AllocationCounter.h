@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace Mirael
+{
+
+/*
+ * Counts the heap allocations each thread makes, for builds configured with MIRAEL_COUNT_ALLOCATIONS, where
+ * AllocationCounter.cpp replaces the global operator new and delete with counting versions.  The Runner uses the counts to
+ * attribute allocations to the core running on the thread, and to each frame as a whole (see doc/GraphExecution.md).
+ *
+ * Only what goes through operator new is counted - Lua allocates through its own allocator, so the allocations of scripts
+ * aren't.  In other builds, nothing is replaced, and every count is 0.
+ */
+class AllocationCounter final
+{
+public:
+#ifdef MIRAEL_COUNT_ALLOCATIONS
+    static constexpr bool Enabled = true;
+    static uint64_t getThreadCount() noexcept; // allocations made so far by the calling thread
+#else
+    static constexpr bool Enabled = false;
+    static uint64_t getThreadCount() noexcept { return 0; }
+#endif
+
+    /// <summary>
+    /// Adds the allocations the calling thread makes over the tally's lifetime to a total shared between threads, if given one.
+    /// </summary>
+    class ScopedTally
+    {
+    public:
+        explicit ScopedTally(std::atomic<uint64_t> *total) noexcept : total_(Enabled ? total : nullptr), start_(getThreadCount()) {}
+        ~ScopedTally()
+        {
+            if (total_)
+                if (const uint64_t count = getThreadCount() - start_)
+                    total_->fetch_add(count, std::memory_order_relaxed);
+        }
+
+        ScopedTally(const ScopedTally &)            = delete;
+        ScopedTally &operator=(const ScopedTally &) = delete;
+
+    private:
+        std::atomic<uint64_t> *total_;
+        uint64_t start_;
+    };
+};
+
+} // namespace Mirael
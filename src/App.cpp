@@ -55,6 +55,9 @@ App::App()
 
 void App::run()
 {
+#ifdef WIN32
+    WindowsOnly::beginFineTimerResolution();
+#endif
     preInitImGui();
     initWindow();
     initVulkan();
@@ -63,6 +66,9 @@ void App::run()
     NfdShim::Init();
     mainLoop();
     cleanup();
+#ifdef WIN32
+    WindowsOnly::endFineTimerResolution();
+#endif
 }
 
 void App::preInitImGui()
@@ -536,6 +542,7 @@ void App::imGuiSettings_WriteAll(ImGuiContext * /*ctx*/, ImGuiSettingsHandler *h
     out_buf->appendf("Diagnostics=%d\n", (int)settings.diagnostics);
     out_buf->appendf("ImGuiDemo=%d\n", (int)settings.demo);
     out_buf->appendf("ImPlotDemo=%d\n", (int)settings.implotDemo);
+    out_buf->appendf("KeepCompiledScripts=%d\n", (int)app.scriptCacheSettings_.keepOnDisk);
     if (settings.lastProjectPath)
         out_buf->appendf("LastProjectPath=%s\n", settings.lastProjectPath->string().c_str());
     if (settings.lastFocusedGraphId)
@@ -554,7 +561,7 @@ void App::imGuiSettings_ReadLine(ImGuiContext * /*ctx*/, ImGuiSettingsHandler *h
     App &app  = *static_cast<App *>(handler->UserData);
     auto &mws = app.mainWindowSettings_;
 
-    int x, y, width, height, maximized, fullscreen, library, properties, settings, diagnostics, demo, implotDemo;
+    int x, y, width, height, maximized, fullscreen, library, properties, settings, diagnostics, demo, implotDemo, keepCompiledScripts;
     uint64_t lastGraphId;
     if (sscanf_s(line, "Pos=%d,%d", &x, &y) == 2) {
         mws.x = x;
@@ -578,6 +585,8 @@ void App::imGuiSettings_ReadLine(ImGuiContext * /*ctx*/, ImGuiSettingsHandler *h
         mws.demo = demo != 0;
     } else if (sscanf_s(line, "ImPlotDemo=%d", &implotDemo) == 1) {
         mws.implotDemo = implotDemo != 0;
+    } else if (sscanf_s(line, "KeepCompiledScripts=%d", &keepCompiledScripts) == 1) {
+        app.scriptCacheSettings_.keepOnDisk = keepCompiledScripts != 0; // read before the last project is reloaded
     } else if (sscanf_s(line, "LastFocusedGraphId=%llu", &lastGraphId) == 1) {
         mws.lastFocusedGraphId = static_cast<GraphId>(lastGraphId);
     } else {
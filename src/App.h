@@ -105,6 +105,12 @@ public:
     };
     ChangeTrackingSettings &getChangeTrackingSettings() { return changeTrackingSettings_; }
 
+    struct ScriptCacheSettings {
+        bool keepOnDisk = false; // as a .mirbc file beside each project, written on save and read on load - opt-in, as the
+                                 // bytecode read back is run as the project's scripts are.  Saved in imgui.ini.
+    };
+    ScriptCacheSettings &getScriptCacheSettings() { return scriptCacheSettings_; }
+
     struct Style {
         struct Values {
             float nodeHeaderIndent = 8.0f;
@@ -144,6 +150,7 @@ private:
     bool closeRequested_ = false;
     bool closeConfirmed_ = false;
     ChangeTrackingSettings changeTrackingSettings_{};
+    ScriptCacheSettings scriptCacheSettings_{};
     std::shared_ptr<GraphSnippet> graphSnippet_{};
 
     // registries
@@ -0,0 +1,458 @@
+#include "pch.h"
+
+#include "ArrayKernels.h"
+#include "SimdSupport.h"
+
+namespace Mirael
+{
+
+namespace
+{
+
+/*
+ * Kernels over n elements of one type.  The wider kernels hand their tails to the narrower.
+ */
+
+template <typename T> struct TypedKernels {
+    void (*add)(T *dst, const T *a, const T *b, size_t n);
+    void (*mul)(T *dst, const T *a, const T *b, size_t n);
+    void (*lerp)(T *dst, const T *a, const T *b, size_t n, double t);
+    void (*affine)(T *dst, const T *a, size_t n, double scale, double offset);
+    double (*sum)(const T *a, size_t n);
+    T (*min)(const T *a, size_t n, T from); // of from and the elements, skipping NaNs
+    T (*max)(const T *a, size_t n, T from);
+};
+
+struct Kernels {
+    const char *instructionSet;
+    TypedKernels<float> f32;
+    TypedKernels<double> f64;
+};
+
+// rounds and saturates for int32, whose arithmetic is otherwise done in double
+template <typename T> T toElement(double d)
+{
+    if constexpr (std::is_integral_v<T>)
+        return std::isnan(d) ? 0 : static_cast<T>(std::clamp(std::nearbyint(d), double{INT32_MIN}, double{INT32_MAX}));
+    else
+        return static_cast<T>(d);
+}
+
+template <typename T> void addScalar(T *dst, const T *a, const T *b, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        if constexpr (std::is_integral_v<T>)
+            dst[i] = static_cast<T>(static_cast<uint32_t>(a[i]) + static_cast<uint32_t>(b[i])); // wrapping
+        else
+            dst[i] = a[i] + b[i];
+}
+
+template <typename T> void mulScalar(T *dst, const T *a, const T *b, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        if constexpr (std::is_integral_v<T>)
+            dst[i] = static_cast<T>(static_cast<uint32_t>(a[i]) * static_cast<uint32_t>(b[i])); // wrapping
+        else
+            dst[i] = a[i] * b[i];
+}
+
+template <typename T> void lerpScalar(T *dst, const T *a, const T *b, size_t n, double t)
+{
+    for (size_t i = 0; i < n; i++)
+        if constexpr (std::is_integral_v<T>)
+            dst[i] = toElement<T>(a[i] + (static_cast<double>(b[i]) - a[i]) * t);
+        else
+            dst[i] = a[i] + (b[i] - a[i]) * static_cast<T>(t);
+}
+
+template <typename T> void affineScalar(T *dst, const T *a, size_t n, double scale, double offset)
+{
+    for (size_t i = 0; i < n; i++)
+        if constexpr (std::is_integral_v<T>)
+            dst[i] = toElement<T>(a[i] * scale + offset);
+        else
+            dst[i] = a[i] * static_cast<T>(scale) + static_cast<T>(offset);
+}
+
+template <typename T> double sumScalar(const T *a, size_t n)
+{
+    double sum = 0;
+    for (size_t i = 0; i < n; i++)
+        sum += a[i];
+    return sum;
+}
+
+template <typename T> T minScalar(const T *a, size_t n, T from)
+{
+    for (size_t i = 0; i < n; i++)
+        from = a[i] < from ? a[i] : from; // so a NaN is skipped, as it compares false
+    return from;
+}
+
+template <typename T> T maxScalar(const T *a, size_t n, T from)
+{
+    for (size_t i = 0; i < n; i++)
+        from = a[i] > from ? a[i] : from;
+    return from;
+}
+
+template <typename T>
+constexpr TypedKernels<T> ScalarTypedKernels = {addScalar<T>, mulScalar<T>, lerpScalar<T>, affineScalar<T>,
+                                                sumScalar<T>, minScalar<T>, maxScalar<T>};
+
+#ifdef MIRAEL_SIMD_X64
+
+/*
+ * Each instruction set's vector of each type, so that the kernels below are written once per instruction set rather than once
+ * per type as well.
+ */
+
+struct Sse2F32 {
+    using T                       = float;
+    using V                       = __m128;
+    static constexpr size_t Width = 4;
+
+    static V load(const T *p) { return _mm_loadu_ps(p); }
+    static void store(T *p, V v) { _mm_storeu_ps(p, v); }
+    static V set1(T x) { return _mm_set1_ps(x); }
+    static V add(V a, V b) { return _mm_add_ps(a, b); }
+    static V sub(V a, V b) { return _mm_sub_ps(a, b); }
+    static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+    static V min(V a, V b) { return _mm_min_ps(a, b); } // b, if either is NaN
+    static V max(V a, V b) { return _mm_max_ps(a, b); }
+};
+
+struct Sse2F64 {
+    using T                       = double;
+    using V                       = __m128d;
+    static constexpr size_t Width = 2;
+
+    static V load(const T *p) { return _mm_loadu_pd(p); }
+    static void store(T *p, V v) { _mm_storeu_pd(p, v); }
+    static V set1(T x) { return _mm_set1_pd(x); }
+    static V add(V a, V b) { return _mm_add_pd(a, b); }
+    static V sub(V a, V b) { return _mm_sub_pd(a, b); }
+    static V mul(V a, V b) { return _mm_mul_pd(a, b); }
+    static V min(V a, V b) { return _mm_min_pd(a, b); }
+    static V max(V a, V b) { return _mm_max_pd(a, b); }
+};
+
+template <typename S> using ElementOf = typename S::T;
+
+// Width elements at a time
+
+template <typename S> void addSse2(ElementOf<S> *dst, const ElementOf<S> *a, const ElementOf<S> *b, size_t n)
+{
+    size_t i = 0;
+    for (; i + S::Width <= n; i += S::Width)
+        S::store(dst + i, S::add(S::load(a + i), S::load(b + i)));
+    addScalar(dst + i, a + i, b + i, n - i);
+}
+
+template <typename S> void mulSse2(ElementOf<S> *dst, const ElementOf<S> *a, const ElementOf<S> *b, size_t n)
+{
+    size_t i = 0;
+    for (; i + S::Width <= n; i += S::Width)
+        S::store(dst + i, S::mul(S::load(a + i), S::load(b + i)));
+    mulScalar(dst + i, a + i, b + i, n - i);
+}
+
+template <typename S> void lerpSse2(ElementOf<S> *dst, const ElementOf<S> *a, const ElementOf<S> *b, size_t n, double t)
+{
+    const auto vt = S::set1(static_cast<ElementOf<S>>(t));
+    size_t i      = 0;
+    for (; i + S::Width <= n; i += S::Width) {
+        const auto va = S::load(a + i);
+        S::store(dst + i, S::add(va, S::mul(S::sub(S::load(b + i), va), vt)));
+    }
+    lerpScalar(dst + i, a + i, b + i, n - i, t);
+}
+
+template <typename S> void affineSse2(ElementOf<S> *dst, const ElementOf<S> *a, size_t n, double scale, double offset)
+{
+    const auto vs = S::set1(static_cast<ElementOf<S>>(scale)), vo = S::set1(static_cast<ElementOf<S>>(offset));
+    size_t i      = 0;
+    for (; i + S::Width <= n; i += S::Width)
+        S::store(dst + i, S::add(S::mul(S::load(a + i), vs), vo));
+    affineScalar(dst + i, a + i, n - i, scale, offset);
+}
+
+template <typename S> double sumSse2(const ElementOf<S> *a, size_t n)
+{
+    auto acc = S::set1(0);
+    size_t i = 0;
+    for (; i + S::Width <= n; i += S::Width)
+        acc = S::add(acc, S::load(a + i));
+    ElementOf<S> lanes[S::Width];
+    S::store(lanes, acc);
+    return sumScalar(lanes, S::Width) + sumScalar(a + i, n - i);
+}
+
+template <typename S> ElementOf<S> minSse2(const ElementOf<S> *a, size_t n, ElementOf<S> from)
+{
+    auto acc = S::set1(from);
+    size_t i = 0;
+    for (; i + S::Width <= n; i += S::Width)
+        acc = S::min(S::load(a + i), acc); // so a NaN is skipped, as for the scalar kernel
+    ElementOf<S> lanes[S::Width];
+    S::store(lanes, acc);
+    return minScalar(a + i, n - i, minScalar(lanes, S::Width, from));
+}
+
+template <typename S> ElementOf<S> maxSse2(const ElementOf<S> *a, size_t n, ElementOf<S> from)
+{
+    auto acc = S::set1(from);
+    size_t i = 0;
+    for (; i + S::Width <= n; i += S::Width)
+        acc = S::max(S::load(a + i), acc);
+    ElementOf<S> lanes[S::Width];
+    S::store(lanes, acc);
+    return maxScalar(a + i, n - i, maxScalar(lanes, S::Width, from));
+}
+
+template <typename S>
+constexpr TypedKernels<ElementOf<S>> Sse2TypedKernels = {addSse2<S>, mulSse2<S>, lerpSse2<S>, affineSse2<S>,
+                                                         sumSse2<S>, minSse2<S>, maxSse2<S>};
+
+constexpr Kernels Sse2Kernels = {"sse2", Sse2TypedKernels<Sse2F32>, Sse2TypedKernels<Sse2F64>};
+
+// twice as wide - and as AVX2 implies AVX, its float arithmetic is available too
+
+struct Avx2F32 {
+    using T                       = float;
+    using V                       = __m256;
+    using Narrower                = Sse2F32;
+    static constexpr size_t Width = 8;
+
+    MIRAEL_TARGET_AVX2 static V load(const T *p) { return _mm256_loadu_ps(p); }
+    MIRAEL_TARGET_AVX2 static void store(T *p, V v) { _mm256_storeu_ps(p, v); }
+    MIRAEL_TARGET_AVX2 static V set1(T x) { return _mm256_set1_ps(x); }
+    MIRAEL_TARGET_AVX2 static V add(V a, V b) { return _mm256_add_ps(a, b); }
+    MIRAEL_TARGET_AVX2 static V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+    MIRAEL_TARGET_AVX2 static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+    MIRAEL_TARGET_AVX2 static V min(V a, V b) { return _mm256_min_ps(a, b); }
+    MIRAEL_TARGET_AVX2 static V max(V a, V b) { return _mm256_max_ps(a, b); }
+};
+
+struct Avx2F64 {
+    using T                       = double;
+    using V                       = __m256d;
+    using Narrower                = Sse2F64;
+    static constexpr size_t Width = 4;
+
+    MIRAEL_TARGET_AVX2 static V load(const T *p) { return _mm256_loadu_pd(p); }
+    MIRAEL_TARGET_AVX2 static void store(T *p, V v) { _mm256_storeu_pd(p, v); }
+    MIRAEL_TARGET_AVX2 static V set1(T x) { return _mm256_set1_pd(x); }
+    MIRAEL_TARGET_AVX2 static V add(V a, V b) { return _mm256_add_pd(a, b); }
+    MIRAEL_TARGET_AVX2 static V sub(V a, V b) { return _mm256_sub_pd(a, b); }
+    MIRAEL_TARGET_AVX2 static V mul(V a, V b) { return _mm256_mul_pd(a, b); }
+    MIRAEL_TARGET_AVX2 static V min(V a, V b) { return _mm256_min_pd(a, b); }
+    MIRAEL_TARGET_AVX2 static V max(V a, V b) { return _mm256_max_pd(a, b); }
+};
+
+template <typename S> MIRAEL_TARGET_AVX2 void addAvx2(ElementOf<S> *dst, const ElementOf<S> *a, const ElementOf<S> *b, size_t n)
+{
+    size_t i = 0;
+    for (; i + S::Width <= n; i += S::Width)
+        S::store(dst + i, S::add(S::load(a + i), S::load(b + i)));
+    addSse2<typename S::Narrower>(dst + i, a + i, b + i, n - i);
+}
+
+template <typename S> MIRAEL_TARGET_AVX2 void mulAvx2(ElementOf<S> *dst, const ElementOf<S> *a, const ElementOf<S> *b, size_t n)
+{
+    size_t i = 0;
+    for (; i + S::Width <= n; i += S::Width)
+        S::store(dst + i, S::mul(S::load(a + i), S::load(b + i)));
+    mulSse2<typename S::Narrower>(dst + i, a + i, b + i, n - i);
+}
+
+template <typename S>
+MIRAEL_TARGET_AVX2 void lerpAvx2(ElementOf<S> *dst, const ElementOf<S> *a, const ElementOf<S> *b, size_t n, double t)
+{
+    const auto vt = S::set1(static_cast<ElementOf<S>>(t));
+    size_t i      = 0;
+    for (; i + S::Width <= n; i += S::Width) {
+        const auto va = S::load(a + i);
+        S::store(dst + i, S::add(va, S::mul(S::sub(S::load(b + i), va), vt)));
+    }
+    lerpSse2<typename S::Narrower>(dst + i, a + i, b + i, n - i, t);
+}
+
+template <typename S>
+MIRAEL_TARGET_AVX2 void affineAvx2(ElementOf<S> *dst, const ElementOf<S> *a, size_t n, double scale, double offset)
+{
+    const auto vs = S::set1(static_cast<ElementOf<S>>(scale)), vo = S::set1(static_cast<ElementOf<S>>(offset));
+    size_t i      = 0;
+    for (; i + S::Width <= n; i += S::Width)
+        S::store(dst + i, S::add(S::mul(S::load(a + i), vs), vo));
+    affineSse2<typename S::Narrower>(dst + i, a + i, n - i, scale, offset);
+}
+
+template <typename S> MIRAEL_TARGET_AVX2 double sumAvx2(const ElementOf<S> *a, size_t n)
+{
+    auto acc = S::set1(0);
+    size_t i = 0;
+    for (; i + S::Width <= n; i += S::Width)
+        acc = S::add(acc, S::load(a + i));
+    ElementOf<S> lanes[S::Width];
+    S::store(lanes, acc);
+    return sumScalar(lanes, S::Width) + sumSse2<typename S::Narrower>(a + i, n - i);
+}
+
+template <typename S> MIRAEL_TARGET_AVX2 ElementOf<S> minAvx2(const ElementOf<S> *a, size_t n, ElementOf<S> from)
+{
+    auto acc = S::set1(from);
+    size_t i = 0;
+    for (; i + S::Width <= n; i += S::Width)
+        acc = S::min(S::load(a + i), acc);
+    ElementOf<S> lanes[S::Width];
+    S::store(lanes, acc);
+    return minSse2<typename S::Narrower>(a + i, n - i, minScalar(lanes, S::Width, from));
+}
+
+template <typename S> MIRAEL_TARGET_AVX2 ElementOf<S> maxAvx2(const ElementOf<S> *a, size_t n, ElementOf<S> from)
+{
+    auto acc = S::set1(from);
+    size_t i = 0;
+    for (; i + S::Width <= n; i += S::Width)
+        acc = S::max(S::load(a + i), acc);
+    ElementOf<S> lanes[S::Width];
+    S::store(lanes, acc);
+    return maxSse2<typename S::Narrower>(a + i, n - i, maxScalar(lanes, S::Width, from));
+}
+
+template <typename S>
+constexpr TypedKernels<ElementOf<S>> Avx2TypedKernels = {addAvx2<S>, mulAvx2<S>, lerpAvx2<S>, affineAvx2<S>,
+                                                         sumAvx2<S>, minAvx2<S>, maxAvx2<S>};
+
+constexpr Kernels Avx2Kernels = {"avx2", Avx2TypedKernels<Avx2F32>, Avx2TypedKernels<Avx2F64>};
+
+#endif // MIRAEL_SIMD_X64
+
+const Kernels &getKernels()
+{
+#ifdef MIRAEL_SIMD_X64
+    static const Kernels &kernels = cpuHasAvx2() ? Avx2Kernels : Sse2Kernels;
+    return kernels;
+#else
+    static constexpr Kernels ScalarKernels = {"scalar", ScalarTypedKernels<float>, ScalarTypedKernels<double>};
+    return ScalarKernels;
+#endif
+}
+
+template <typename T> const TypedKernels<T> &getTypedKernels()
+{
+    if constexpr (std::is_same_v<T, float>)
+        return getKernels().f32;
+    else if constexpr (std::is_same_v<T, double>)
+        return getKernels().f64;
+    else
+        return ScalarTypedKernels<T>;
+}
+
+// calls fn with a value of the array type's element type, for it to take as a template parameter
+template <typename Fn> decltype(auto) visitType(NativeArray::Type type, Fn &&fn)
+{
+    switch (type) {
+    case NativeArray::Type::Float32:
+        return fn(float{});
+    case NativeArray::Type::Int32:
+        return fn(int32_t{});
+    default:
+        return fn(double{});
+    }
+}
+
+// where min() starts from, and max() from its negation
+template <typename T> constexpr T highest()
+{
+    return std::numeric_limits<T>::has_infinity ? std::numeric_limits<T>::infinity() : std::numeric_limits<T>::max();
+}
+
+size_t shortest(const NativeArray &a, const NativeArray &b)
+{
+    return static_cast<size_t>(std::min(a.getCount(), b.getCount()));
+}
+
+size_t shortest(const NativeArray &a, const NativeArray &b, const NativeArray &c)
+{
+    return std::min(shortest(a, b), static_cast<size_t>(c.getCount()));
+}
+
+} // namespace
+
+void ArrayKernels::add(NativeArray &dst, const NativeArray &a, const NativeArray &b)
+{
+    assert(dst.getType() == a.getType() && a.getType() == b.getType());
+    visitType(dst.getType(), [&]<typename T>(T) {
+        getTypedKernels<T>().add(dst.getElements<T>(), a.getElements<T>(), b.getElements<T>(), shortest(dst, a, b));
+    });
+}
+
+void ArrayKernels::mul(NativeArray &dst, const NativeArray &a, const NativeArray &b)
+{
+    assert(dst.getType() == a.getType() && a.getType() == b.getType());
+    visitType(dst.getType(), [&]<typename T>(T) {
+        getTypedKernels<T>().mul(dst.getElements<T>(), a.getElements<T>(), b.getElements<T>(), shortest(dst, a, b));
+    });
+}
+
+void ArrayKernels::lerp(NativeArray &dst, const NativeArray &a, const NativeArray &b, double t)
+{
+    assert(dst.getType() == a.getType() && a.getType() == b.getType());
+    visitType(dst.getType(), [&]<typename T>(T) {
+        getTypedKernels<T>().lerp(dst.getElements<T>(), a.getElements<T>(), b.getElements<T>(), shortest(dst, a, b), t);
+    });
+}
+
+void ArrayKernels::affine(NativeArray &dst, const NativeArray &a, double scale, double offset)
+{
+    assert(dst.getType() == a.getType());
+    visitType(dst.getType(), [&]<typename T>(T) {
+        getTypedKernels<T>().affine(dst.getElements<T>(), a.getElements<T>(), shortest(dst, a), scale, offset);
+    });
+}
+
+void ArrayKernels::convert(NativeArray &dst, const NativeArray &src)
+{
+    // conversions are rare enough, and varied enough, to be left scalar
+    const size_t n = shortest(dst, src);
+    visitType(dst.getType(), [&]<typename D>(D) {
+        visitType(src.getType(), [&]<typename S>(S) {
+            auto *d       = dst.getElements<D>();
+            const auto *s = src.getElements<S>();
+            for (size_t i = 0; i < n; i++)
+                d[i] = toElement<D>(static_cast<double>(s[i]));
+        });
+    });
+}
+
+double ArrayKernels::sum(const NativeArray &a)
+{
+    return visitType(a.getType(), [&]<typename T>(T) { return getTypedKernels<T>().sum(a.getElements<T>(), a.getCount()); });
+}
+
+std::optional<double> ArrayKernels::min(const NativeArray &a)
+{
+    if (!a.getCount())
+        return std::nullopt;
+    return visitType(a.getType(), [&]<typename T>(T) -> double {
+        return getTypedKernels<T>().min(a.getElements<T>(), a.getCount(), highest<T>());
+    });
+}
+
+std::optional<double> ArrayKernels::max(const NativeArray &a)
+{
+    if (!a.getCount())
+        return std::nullopt;
+    return visitType(a.getType(), [&]<typename T>(T) -> double {
+        return getTypedKernels<T>().max(a.getElements<T>(), a.getCount(), -highest<T>());
+    });
+}
+
+const char *ArrayKernels::getInstructionSet()
+{
+    return getKernels().instructionSet;
+}
+
+} // namespace Mirael
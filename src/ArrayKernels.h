@@ -0,0 +1,40 @@
+#pragma once
+
+#include <optional>
+
+#include "NativeArray.h"
+
+namespace Mirael
+{
+
+/*
+ * Whole-array numeric operations over NativeArrays, vectorized with SSE2 or AVX2 (as the CPU allows)
+ * with a scalar fallback, so that bulk numeric work need not touch each element from Lua.  float32
+ * and float64 arrays are vectorized, while int32 arrays - meant for indices and counts - run scalar.
+ *
+ * Each operation takes arrays of one type, and writes a destination of that type, which may be one of
+ * the sources.  Operations between two arrays work over the shorter, so the destination need be no
+ * longer than that.  int32 results wrap where they overflow in add and mul, and otherwise round to the
+ * nearest, saturating.
+ *
+ * The Array node reaches these - see doc/ArrayHandling.md.
+ */
+class ArrayKernels final
+{
+public:
+    static void add(NativeArray &dst, const NativeArray &a, const NativeArray &b); // dst = a + b
+    static void mul(NativeArray &dst, const NativeArray &a, const NativeArray &b); // dst = a * b
+    static void lerp(NativeArray &dst, const NativeArray &a, const NativeArray &b, double t); // dst = a + (b - a) * t
+    static void affine(NativeArray &dst, const NativeArray &a, double scale, double offset);  // dst = a * scale + offset
+
+    // converts each element of src to dst's type, over the shorter of the two
+    static void convert(NativeArray &dst, const NativeArray &src);
+
+    static double sum(const NativeArray &a);
+    static std::optional<double> min(const NativeArray &a); // nullopt if the array is empty
+    static std::optional<double> max(const NativeArray &a); // nullopt if the array is empty
+
+    static const char *getInstructionSet(); // the widest in use: "avx2", "sse2" or "scalar"
+};
+
+} // namespace Mirael
@@ -37,6 +37,15 @@ public:
         return {buckets_[(newState & FoldMask) >> FoldShift], true};
     }
 
+    // producer method, for use only once no further folds will follow (e.g. after the producer's thread has stopped)
+    bool flushFoldBucket() noexcept // makes the last folded bucket readable - returns false if the consumer must release first
+    {
+        auto result = fetchFoldBucket();
+        if (result.isNew)
+            result.bucket = T{}; // never read, since the consumer cannot advance to the bucket being folded
+        return result.isNew;
+    }
+
     // consumer methods
     const T &getReadBucket() const noexcept { return buckets_[readIndex_]; }
     bool releaseReadBucket() noexcept // returns true if the bucket advanced, meaning next read would be a new bucket
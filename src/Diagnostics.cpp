@@ -1,8 +1,13 @@
 #include "pch.h"
 
+#include <fstream>
+
 #include "App.h"
 #include "Diagnostics.h"
+#include "FrameTrace.h"
 #include "ImGuiEx.h"
+#include "NfdShim.h"
+#include "PerfCounters.h"
 
 namespace Mirael
 {
@@ -33,6 +38,33 @@ void Mirael::Diagnostics::show(bool &open)
                 ImGui::TextUnformatted("n/a");
             }
         }
+        if (ImGui::CollapsingHeader("Profiling")) {
+            bool tracing = FrameTrace::isEnabled();
+            if (ImGui::Checkbox("Record Trace", &tracing))
+                FrameTrace::setEnabled(tracing);
+            ImGui::SameLine();
+            ImGuiEx::ToolTipHint("Records when each Runner thread runs its frames, cores, plan updates and frame waits, and "
+                                 "when scripts compile, so that a stutter can be seen on a timeline.");
+
+            ImGui::SetNextItemWidth(ImGui::GetFontSize() * 6);
+            if (ImGui::InputInt("Seconds", &traceSeconds_))
+                traceSeconds_ = std::clamp(traceSeconds_, 1, 60);
+            ImGui::SameLine();
+            if (ImGui::Button("Save Trace..."))
+                saveTrace();
+            ImGui::SameLine();
+            ImGuiEx::ToolTipHint("Saves the latest seconds recorded as a Chrome trace, which chrome://tracing and "
+                                 "ui.perfetto.dev both open.");
+
+            bool counting = PerfCounters::isEnabled();
+            if (ImGui::Checkbox("Sample Hardware Counters", &counting))
+                PerfCounters::setEnabled(counting);
+            ImGui::SameLine();
+            ImGuiEx::ToolTipHint("Samples the CPU's cycles, instructions, and cache and branch misses around each core, for "
+                                 "the selected node's IPC in the graph's metrics.  Linux only, where the kernel permits it.");
+            if (const char *reason = PerfCounters::getUnavailableReason(); reason && counting)
+                ImGui::TextDisabled("Unavailable - %s", reason);
+        }
         if (ImGui::CollapsingHeader("ImGui IO", ImGuiTreeNodeFlags_DefaultOpen)) {
             if (ImGui::BeginTable("##diags", 2, tableFlags)) {
 
@@ -70,4 +102,21 @@ void Mirael::Diagnostics::show(bool &open)
     ImGui::End();
 }
 
+void Diagnostics::saveTrace()
+{
+    NfdShim::SaveArgs args = {.filters = {{"Chrome Traces", "json"}}, .defaultName = "trace.json"};
+    auto results           = NfdShim::getSaveAsFilePath(args);
+    if (results.bad()) {
+        App::get().showError("Unable to choose file path to save the trace as: " + results.errorMessage);
+        return;
+    }
+    if (!results.good())
+        return;
+
+    std::ofstream out(results.filepath, std::ios::binary);
+    FrameTrace::writeChromeTrace(out, traceSeconds_);
+    if (!out)
+        App::get().showError("Unable to write the trace to " + results.filepath.string());
+}
+
 } // namespace Mirael
\ No newline at end of file
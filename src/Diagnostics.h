@@ -6,6 +6,10 @@ class Diagnostics {
 public:
 	static const char *windowName() {return "Diagnostics";}
 	void show(bool &open);
+
+private:
+	int traceSeconds_ = 5; // of the trace saved
+	void saveTrace();
 };
 
 };
\ No newline at end of file
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+namespace Mirael
+{
+
+/// <summary>
+/// A bump allocator for the scratch memory cores need only within a frame, reached through RunContext::arena.
+///
+/// Allocating only advances a pointer, and freeing does nothing - everything allocated is discarded at once when the Runner
+/// resets the arena after the frame.  The first block is made on first use, and a frame that outgrows it adds more; the reset
+/// then replaces them all with a single block of their total size, so the arena soon fits a whole frame in one block and
+/// stops touching the heap.  As a std::pmr::memory_resource, it can back std::pmr containers and strings as well.
+///
+/// Each RunContext has its own arena, and a context is only ever used by one thread at a time, so the arena needn't be
+/// thread-safe.  Nothing allocated may be kept past the frame, nor anything with a destructor that must run.
+/// </summary>
+class FrameArena final : public std::pmr::memory_resource
+{
+public:
+    static constexpr size_t MinBlockSize = 64 * 1024;
+
+    FrameArena() = default;
+
+    // forbid copy/move, as allocations point into the blocks
+    FrameArena(const FrameArena &)            = delete;
+    FrameArena &operator=(const FrameArena &) = delete;
+    FrameArena(FrameArena &&)                 = delete;
+    FrameArena &operator=(FrameArena &&)      = delete;
+
+    /// <summary>
+    /// Allocate uninitialized storage for count objects of type T, which must be trivially destructible.
+    /// </summary>
+    template <typename T> std::span<T> allocateArray(size_t count)
+    {
+        static_assert(std::is_trivially_destructible_v<T>, "The arena never runs destructors.");
+        return {static_cast<T *>(allocate(count * sizeof(T), alignof(T))), count};
+    }
+
+    /// <summary>
+    /// Discard everything allocated since the last reset, coalescing the blocks if more than one was needed.
+    /// </summary>
+    void reset()
+    {
+        if (blocks_.size() > 1) {
+            size_t total = 0;
+            for (const auto &block : blocks_)
+                total += block.size;
+            blocks_.clear();
+            addBlock(total);
+        }
+        used_ = 0;
+    }
+
+    size_t getCapacity() const noexcept
+    {
+        size_t total = 0;
+        for (const auto &block : blocks_)
+            total += block.size;
+        return total;
+    }
+
+private:
+    struct Block {
+        std::unique_ptr<std::byte[]> data;
+        size_t size;
+    };
+    std::vector<Block> blocks_; // only the last has room left
+    size_t used_ = 0;           // of the last block
+
+    void addBlock(size_t size)
+    {
+        blocks_.push_back(Block{.data = std::make_unique_for_overwrite<std::byte[]>(size), .size = size});
+        used_ = 0;
+    }
+
+    void *do_allocate(size_t bytes, size_t alignment) override
+    {
+        if (!blocks_.empty()) {
+            auto &block        = blocks_.back();
+            const auto base    = reinterpret_cast<uintptr_t>(block.data.get());
+            const size_t start = ((base + used_ + alignment - 1) & ~(alignment - 1)) - base;
+            if (start + bytes <= block.size) {
+                used_ = start + bytes;
+                return block.data.get() + start;
+            }
+        }
+
+        // blocks come from new[], so are aligned for anything but over-aligned types - which are padded for here
+        const size_t padding = alignment > alignof(std::max_align_t) ? alignment : 0;
+        addBlock(std::max({MinBlockSize, bytes + padding, blocks_.empty() ? 0 : blocks_.back().size * 2}));
+        return do_allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void *, size_t, size_t) override {} // freed wholesale by reset()
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; }
+};
+
+} // namespace Mirael
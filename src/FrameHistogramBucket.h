@@ -0,0 +1,96 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+
+#include "FrameMetricsBucket.h"
+
+namespace Mirael
+{
+
+/// <summary>
+/// A FrameMetricsBucket that also keeps a histogram of the measurements folded, so that percentiles can be read - a p99
+/// shows the judder an average hides, and that a max overstates when caused by a single frame.
+///
+/// The histogram is log-linear, as an HDR histogram's is: measurements below 2^SubBucketBits ns each count in a bucket of
+/// their own, and each power of two above that is split into 2^SubBucketBits buckets of equal width, so that a percentile
+/// is read to within 1/2^SubBucketBits of its value (6.25%) at any scale.  Measurements from 2^MaxValueBits ns (about a
+/// minute) on are counted in the last bucket.  Folding is a handful of integer ops and no allocation, and buckets of
+/// different threads and times can be merged, so it suits BucketCycle as FrameMetricsBucket does.
+/// </summary>
+struct FrameHistogramBucket : FrameMetricsBucket {
+    static constexpr unsigned SubBucketBits = 4;
+    static constexpr unsigned MaxValueBits  = 36;
+    static constexpr size_t SubBucketCount  = size_t{1} << SubBucketBits;
+    static constexpr size_t BucketCount     = (MaxValueBits - SubBucketBits + 1) * SubBucketCount;
+
+    std::array<uint32_t, BucketCount> counts{};
+
+    void fold(uint64_t frameNs, bool reset) noexcept
+    {
+        if (reset)
+            counts.fill(0);
+        FrameMetricsBucket::fold(frameNs, reset);
+        counts[getIndex(frameNs)]++;
+    }
+
+    void merge(const FrameHistogramBucket &other) noexcept
+    {
+        if (!other.count)
+            return;
+        if (!count) {
+            *this = other;
+            return;
+        }
+        count += other.count;
+        totalNs += other.totalNs;
+        minNs = std::min(minNs, other.minNs);
+        maxNs = std::max(maxNs, other.maxNs);
+        for (size_t i = 0; i < BucketCount; i++)
+            counts[i] += other.counts[i];
+    }
+
+    /// <summary>
+    /// The least measurement at or below which the given percentage (0-100) of those folded fall, as the highest value its
+    /// histogram bucket holds (though never beyond the min or max measured).  0 if nothing has been folded.
+    /// </summary>
+    uint64_t percentile(double percent) const noexcept
+    {
+        if (!count)
+            return 0;
+
+        const double wanted = std::clamp(percent, 0.0, 100.0) / 100.0 * static_cast<double>(count);
+        const uint64_t rank = std::max<uint64_t>(static_cast<uint64_t>(std::ceil(wanted)), 1);
+        uint64_t seen       = 0;
+        for (size_t i = 0; i < BucketCount; i++) {
+            seen += counts[i];
+            if (seen >= rank)
+                return std::clamp(getUpperBound(i) - 1, minNs, maxNs);
+        }
+        return maxNs;
+    }
+
+    static constexpr size_t getIndex(uint64_t value) noexcept
+    {
+        if (value < SubBucketCount)
+            return static_cast<size_t>(value);
+        const unsigned exponent = static_cast<unsigned>(std::bit_width(value)) - 1;
+        if (exponent >= MaxValueBits)
+            return BucketCount - 1;
+        const unsigned shift = exponent - SubBucketBits;
+        return (shift + 1) * SubBucketCount + static_cast<size_t>(value >> shift) - SubBucketCount;
+    }
+
+    static constexpr uint64_t getUpperBound(size_t index) noexcept // exclusive, of the values counted in the bucket
+    {
+        if (index < SubBucketCount)
+            return index + 1;
+        const size_t shift = index / SubBucketCount - 1;
+        return (index % SubBucketCount + SubBucketCount + 1) << shift;
+    }
+};
+
+} // namespace Mirael
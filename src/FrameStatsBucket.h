@@ -0,0 +1,46 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+namespace Mirael
+{
+
+/// <summary>
+/// Captures a per-frame quantity other than a time - a count, or a size in bytes - by folding a single measurement into a
+/// bucket, to enable tracking its running average, min and max as FrameMetricsBucket does for times.  Buckets of different
+/// threads and times can be merged, so it suits BucketCycle as FrameMetricsBucket does.
+/// </summary>
+struct FrameStatsBucket {
+    uint64_t count = 0, total = 0, min = 0, max = 0;
+    void fold(uint64_t value, bool reset) noexcept
+    {
+        if (reset) {
+            count = 1;
+            total = min = max = value;
+        } else {
+            count++;
+            total += value;
+            min = std::min(min, value);
+            max = std::max(max, value);
+        }
+    }
+
+    void merge(const FrameStatsBucket &other) noexcept
+    {
+        if (!other.count)
+            return;
+        if (!count) {
+            *this = other;
+            return;
+        }
+        count += other.count;
+        total += other.total;
+        min = std::min(min, other.min);
+        max = std::max(max, other.max);
+    }
+
+    double average() const noexcept { return count ? static_cast<double>(total) / count : 0.0; }
+};
+
+} // namespace Mirael
\ No newline at end of file
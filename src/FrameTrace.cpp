@@ -0,0 +1,172 @@
+#include "pch.h"
+
+#include <mutex>
+
+#include "FrameTrace.h"
+
+namespace Mirael
+{
+
+namespace
+{
+
+/*
+ * Each ring has a single writer - the thread holding it - and is read by writeChromeTrace() without stopping it, as a
+ * seqlock would be: the writer claims each slot before overwriting it, and the reader drops whatever it read from slots
+ * claimed meanwhile.  The events' fields are relaxed atomics, so that reading a slot being overwritten isn't a data race.
+ */
+
+struct Event {
+    std::atomic<const char *> name;
+    std::atomic<int64_t> startNs, endNs;
+    std::atomic<uint64_t> id;
+};
+
+struct Ring {
+    std::unique_ptr<Event[]> events{new Event[FrameTrace::RingCapacity]};
+    std::atomic<uint64_t> claimed{0}, written{0}; // events ever claimed and written - slot is count % RingCapacity
+
+    // guarded by Registry::mutex
+    std::string threadName;
+    bool held = false; // by a live thread - released rings are taken by new threads, keeping their events
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Ring>> rings; // never freed, as each thread's ring is reached without the lock
+};
+
+Registry &getRegistry()
+{
+    static Registry registry;
+    return registry;
+}
+
+struct ThreadState {
+    Ring *ring = nullptr;
+    std::string name;
+
+    ~ThreadState()
+    {
+        if (!ring)
+            return;
+        auto &registry = getRegistry();
+        std::lock_guard lock(registry.mutex);
+        ring->held = false;
+    }
+
+    Ring *getRing() noexcept
+    {
+        if (ring)
+            return ring;
+
+        try {
+            auto &registry = getRegistry();
+            std::lock_guard lock(registry.mutex);
+            auto found = std::ranges::find_if(registry.rings, [](const auto &r) { return !r->held; });
+            if (found == registry.rings.end())
+                found = registry.rings.insert(found, std::make_unique<Ring>());
+            ring             = found->get();
+            ring->held       = true;
+            ring->threadName = name;
+        } catch (...) {
+            return nullptr; // out of memory - the event just isn't traced
+        }
+        return ring;
+    }
+};
+
+thread_local ThreadState threadState;
+
+} // namespace
+
+void FrameTrace::setThreadName(std::string name)
+{
+    threadState.name = std::move(name);
+    if (threadState.ring) {
+        std::lock_guard lock(getRegistry().mutex);
+        threadState.ring->threadName = threadState.name;
+    }
+}
+
+void FrameTrace::record(const char *name, int64_t startNs, int64_t endNs, uint64_t id) noexcept
+{
+    auto *ring = threadState.getRing();
+    if (!ring)
+        return;
+
+    const uint64_t index = ring->written.load(std::memory_order_relaxed);
+    ring->claimed.store(index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release); // the claim is seen before any of the stores below
+
+    auto &event = ring->events[index % RingCapacity];
+    event.name.store(name, std::memory_order_relaxed);
+    event.startNs.store(startNs, std::memory_order_relaxed);
+    event.endNs.store(endNs, std::memory_order_relaxed);
+    event.id.store(id, std::memory_order_relaxed);
+    ring->written.store(index + 1, std::memory_order_release);
+}
+
+size_t FrameTrace::writeChromeTrace(std::ostream &out, double lastSeconds)
+{
+    struct Copy {
+        size_t tid;
+        const char *name;
+        int64_t startNs, endNs;
+        uint64_t id;
+    };
+    std::vector<Copy> copies;
+    std::vector<std::pair<size_t, std::string>> threadNames;
+
+    const int64_t cutoffNs = now() - static_cast<int64_t>(lastSeconds * 1e9);
+    {
+        auto &registry = getRegistry();
+        std::lock_guard lock(registry.mutex); // only keeps rings from changing hands - their threads record on regardless
+        for (size_t tid = 0; tid < registry.rings.size(); tid++) {
+            auto &ring = *registry.rings[tid];
+            threadNames.emplace_back(tid, ring.threadName);
+
+            const size_t begin    = copies.size();
+            const uint64_t end    = ring.written.load(std::memory_order_acquire);
+            const uint64_t oldest = end > RingCapacity ? end - RingCapacity : 0;
+            for (uint64_t i = oldest; i < end; i++) {
+                const auto &event = ring.events[i % RingCapacity];
+                copies.push_back({.tid     = tid,
+                                  .name    = event.name.load(std::memory_order_relaxed),
+                                  .startNs = event.startNs.load(std::memory_order_relaxed),
+                                  .endNs   = event.endNs.load(std::memory_order_relaxed),
+                                  .id      = event.id.load(std::memory_order_relaxed)});
+            }
+
+            // drop the copies of slots the writer claimed since, which may be torn, and those that ended too long ago
+            std::atomic_thread_fence(std::memory_order_acquire);
+            const uint64_t claimed = ring.claimed.load(std::memory_order_relaxed);
+            const uint64_t torn    = std::min(end - oldest, claimed > oldest + RingCapacity ? claimed - RingCapacity - oldest : 0);
+            copies.erase(copies.begin() + begin, copies.begin() + begin + static_cast<size_t>(torn));
+            auto expired = [cutoffNs](const Copy &c) { return c.endNs < cutoffNs; };
+            copies.erase(std::remove_if(copies.begin() + begin, copies.end(), expired), copies.end());
+        }
+    }
+
+    // timestamps are in microseconds, from the earliest event written
+    int64_t originNs = copies.empty() ? 0 : copies.front().startNs;
+    for (const auto &c : copies)
+        originNs = std::min(originNs, c.startNs);
+    auto toUs = [originNs](int64_t ns) { return static_cast<double>(ns - originNs) / 1000.0; };
+
+    // names come from the code, so need no escaping
+    out << R"({"displayTimeUnit":"ms","traceEvents":[)" "\n";
+    out << R"({"name":"process_name","ph":"M","pid":1,"args":{"name":"Mirael"}})";
+    for (const auto &[tid, name] : threadNames)
+        if (!name.empty())
+            out << std::format(",\n" R"({{"name":"thread_name","ph":"M","pid":1,"tid":{},"args":{{"name":"{}"}}}})", tid, name);
+    for (const auto &c : copies) {
+        const auto name = c.id != NoId ? std::format("{} {}", c.name, c.id) : std::string(c.name);
+        out << std::format(",\n" R"({{"name":"{}","ph":"X","pid":1,"tid":{},"ts":{:.3f},"dur":{:.3f}}})", name, c.tid,
+                           toUs(c.startNs), toUs(c.endNs) - toUs(c.startNs));
+    }
+    out << "\n]}\n";
+    return copies.size();
+}
+
+} // namespace Mirael
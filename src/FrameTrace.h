@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+namespace Mirael
+{
+
+/// <summary>
+/// Opt-in tracing of what the Runner's threads do and when - its frames, plan updates, frame waits, each core's onFrame()
+/// and the like - for viewing as a timeline.  While enabled, each traced scope records one event, with its start and end,
+/// into a ring of its thread's own, so recording is lock-free and never waits on the other threads; the oldest events are
+/// overwritten once the ring fills.  writeChromeTrace() then writes the latest few seconds of every thread as a Chrome trace
+/// (JSON), which chrome://tracing and ui.perfetto.dev both open.
+///
+/// While disabled, a traced scope costs a relaxed load and a well-predicted branch on entering, and a branch on leaving -
+/// nothing is recorded, and no ring is made.
+/// </summary>
+class FrameTrace final
+{
+public:
+    static constexpr size_t RingCapacity = size_t{1} << 16; // events kept per thread
+    static constexpr uint64_t NoId       = ~uint64_t{0};
+
+    static bool isEnabled() noexcept { return enabled_.load(std::memory_order_relaxed); }
+    static void setEnabled(bool enabled) noexcept { enabled_.store(enabled, std::memory_order_relaxed); }
+
+    static int64_t now() noexcept
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // names the calling thread in the traces written - its events are traced without a name, too
+    static void setThreadName(std::string name);
+
+    // records an event of the calling thread - name must be a string literal (or otherwise outlive every trace written), and
+    // id (e.g. a NodeId) is shown alongside it if given
+    static void record(const char *name, int64_t startNs, int64_t endNs, uint64_t id = NoId) noexcept;
+
+    // writes every thread's events that ended within the last given seconds, returning the number written
+    static size_t writeChromeTrace(std::ostream &out, double lastSeconds);
+
+    /// <summary>
+    /// Traces the scope it lives in as one event, if tracing is enabled as it's entered.
+    /// </summary>
+    class Scope
+    {
+    public:
+        explicit Scope(const char *name, uint64_t id = NoId) noexcept : name_(name), id_(id), startNs_(isEnabled() ? now() : 0) {}
+        ~Scope()
+        {
+            if (startNs_)
+                record(name_, startNs_, now(), id_);
+        }
+
+        Scope(const Scope &)            = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        const char *name_;
+        uint64_t id_;
+        int64_t startNs_; // 0 if not traced
+    };
+
+private:
+    static inline std::atomic<bool> enabled_ = false;
+};
+
+} // namespace Mirael
@@ -11,6 +11,7 @@
 #include "Graph.h"
 #include "ImGuiEx.h"
 #include "NodeTypeRegistry.h"
+#include "PerfCounters.h"
 
 namespace ne = ax::NodeEditor;
 using json   = nlohmann::json;
@@ -38,8 +39,21 @@ void Graph::serialize(nlohmann::json &j) const
     j["ratemode"] = to_string(runRate_.rateMode);
     j["fps"]      = runRate_.desiredFramesPerSecond;
 
+    // the settings since added only where changed, as luastates below, so that saving leaves other projects' files as they were
+    const RunRateSetting defaults{};
+    if (runRate_.executionMode != defaults.executionMode)
+        j["execmode"] = to_string(runRate_.executionMode);
+    if (runRate_.luaGcMode != defaults.luaGcMode)
+        j["gcmode"] = to_string(runRate_.luaGcMode);
+    if (runRate_.luaGcBudgetMs != defaults.luaGcBudgetMs)
+        j["gcbudget"] = runRate_.luaGcBudgetMs;
+    if (runRate_.uiLeadMs != defaults.uiLeadMs)
+        j["uilead"] = runRate_.uiLeadMs;
+
     if (!luaEnvInitScript_.empty())
         j["initlua"] = luaEnvInitScript_;
+    if (luaStateCount_ > 1)
+        j["luastates"] = luaStateCount_;
 
     j["nodes"] = json::object();
     for (const auto &[nodeId, node] : nodes_) {
@@ -81,11 +95,36 @@ std::unique_ptr<Graph> Graph::deserialize(GraphId id, std::string_view uid, cons
         graph->runRate_.desiredFramesPerSecond = j["fps"].get<float>();
     }
 
+    if (j.contains("execmode")) {
+        auto executionModeString = j["execmode"].get<std::string>();
+        if (!try_parse(executionModeString, graph->runRate_.executionMode))
+            throw std::runtime_error(std::format("Graph json parsing error: unknown execmode string: {}", executionModeString));
+    }
+
+    if (j.contains("gcmode")) {
+        auto luaGcModeString = j["gcmode"].get<std::string>();
+        if (!try_parse(luaGcModeString, graph->runRate_.luaGcMode))
+            throw std::runtime_error(std::format("Graph json parsing error: unknown gcmode string: {}", luaGcModeString));
+    }
+
+    if (j.contains("gcbudget")) {
+        graph->runRate_.luaGcBudgetMs = j["gcbudget"].get<float>();
+    }
+
+    if (j.contains("uilead")) {
+        graph->runRate_.uiLeadMs = j["uilead"].get<float>();
+    }
+
+    if (j.contains("luastates")) {
+        graph->luaStateCount_ = std::clamp(j["luastates"].get<int>(), 1, static_cast<int>(Runner::MaxLuaStates));
+    }
+
     if (j.contains("initlua")) {
         auto s                   = j["initlua"].get<std::string>();
         graph->luaEnvInitScript_ = s;
-        graph->sendInitScript();
     }
+    if (!graph->luaEnvInitScript_.empty() || graph->luaStateCount_ > 1)
+        graph->sendInitScript();
 
     const auto &nodesObj = j.at("nodes");
     if (!nodesObj.is_object())
@@ -165,6 +204,8 @@ void Graph::activate()
 
 void Graph::showView()
 {
+    runner_.onNewUIFrame(); // whether or not we're visible, as the Runner paces UIRate by it
+
     if (!visible_) {
         updateExecutionPlan();
         return;
@@ -254,6 +295,46 @@ void Graph::userCreateNode(const char *nodeTypeName)
     raiseModified(ChangeImpact::AddNode);
 }
 
+void Graph::readTimings()
+{
+    while (runner_.releaseMetricsBuckets()) {
+        runnerMetrics_ = runner_.getMetricsBuckets();
+        timingWindow_.coreExecution.merge(runnerMetrics_.coreExecution);
+        timingWindow_.runnerOverhead.merge(runnerMetrics_.runnerOverhead);
+        timingWindow_.framePeriod.merge(runnerMetrics_.framePeriod);
+        timingWindow_.frameLateness.merge(runnerMetrics_.frameLateness);
+    }
+
+    // the Graph is the only reader of its cores' timings, so only the selected node's are read, and those it had before
+    // being selected are dropped
+    auto node = selectedNodeId_ ? nodes_.find(*selectedNodeId_) : nodes_.end();
+    if (timedNodeId_ != selectedNodeId_) {
+        timingWindow_.selectedNode         = lastTimingWindow_.selectedNode = {};
+        timingWindow_.selectedNodeCounters = lastTimingWindow_.selectedNodeCounters = {};
+        if (node != nodes_.end() && node->second->internalChannel_) {
+            while (node->second->internalChannel_->frameMetrics.releaseReadBucket())
+                continue;
+            while (node->second->internalChannel_->framePerfCounters.releaseReadBucket())
+                continue;
+        }
+        timedNodeId_ = selectedNodeId_;
+    } else if (node != nodes_.end() && node->second->internalChannel_) {
+        auto &metrics = node->second->internalChannel_->frameMetrics;
+        while (metrics.releaseReadBucket())
+            timingWindow_.selectedNode.merge(metrics.getReadBucket());
+        auto &counters = node->second->internalChannel_->framePerfCounters;
+        while (counters.releaseReadBucket())
+            timingWindow_.selectedNodeCounters.merge(counters.getReadBucket());
+    }
+
+    const double now = ImGui::GetTime();
+    if (now - timingWindowStart_ >= 1.0) {
+        lastTimingWindow_  = timingWindow_;
+        timingWindow_      = {};
+        timingWindowStart_ = now;
+    }
+}
+
 void Graph::showDiagnosticRows()
 {
     ImGuiEx::RowLabel("ID");
@@ -307,6 +388,87 @@ void Graph::showDiagnosticRows()
 
     ImGuiEx::RowLabel("Execution Plan Version");
     ImGui::Text("%llu", currentPlanVersion_);
+
+    readTimings();
+
+    auto showPercentiles = [](const FrameHistogramBucket &m) {
+        if (m.count)
+            ImGui::Text("%.1f / %.1f / %.1f us", m.percentile(50) / 1000.0, m.percentile(99) / 1000.0, m.percentile(99.9) / 1000.0);
+        else
+            ImGui::TextDisabled("n/a");
+    };
+    ImGuiEx::RowLabel("Core Execution p50 / p99 / p99.9", "Percentiles of the time spent executing cores per frame, over the "
+                                                          "frames of the last second.");
+    showPercentiles(lastTimingWindow_.coreExecution);
+
+    ImGuiEx::RowLabel("Runner Overhead p50 / p99 / p99.9", "Likewise, of the Runner's own time per frame.");
+    showPercentiles(lastTimingWindow_.runnerOverhead);
+
+    const auto &period = lastTimingWindow_.framePeriod;
+    ImGuiEx::RowLabel("Achieved Rate", "Frames per second, from the average time between frame starts over the last second.");
+    if (period.count && period.totalNs)
+        ImGui::Text("%.2f fps", 1e9 * period.count / period.totalNs);
+    else
+        ImGui::TextDisabled("n/a");
+
+    ImGuiEx::RowLabel("Start Lateness p50 / p99 / p99.9", "How late each frame started after it was due - the pacing's jitter.  "
+                                                          "Only at a Set Rate or UI Rate.");
+    showPercentiles(lastTimingWindow_.frameLateness);
+
+    ImGuiEx::RowLabel("Selected Node p50 / p99 / p99.9", "Likewise, of the selected node's core's execution time.");
+    showPercentiles(lastTimingWindow_.selectedNode);
+
+    if (PerfCounters::isEnabled()) {
+        ImGuiEx::RowLabel("Selected Node IPC", "Instructions per cycle of the selected node's core, and its last level cache "
+                                               "and branch misses per thousand instructions, over the last second.  Low IPC "
+                                               "with many cache misses marks a memory-bound core.");
+        const auto &counters = lastTimingWindow_.selectedNodeCounters;
+        if (counters.count)
+            ImGui::Text("%.2f (%.2f cache, %.2f branch misses / 1k)", counters.instructionsPerCycle(),
+                        counters.cacheMissesPerKiloInstruction(), counters.branchMissesPerKiloInstruction());
+        else if (const char *reason = PerfCounters::getUnavailableReason())
+            ImGui::TextDisabled("unavailable - %s", reason);
+        else
+            ImGui::TextDisabled("n/a");
+    }
+
+    // averaged over the frames of the latest bucket - skipped cores are pure ones whose inputs didn't change
+    ImGuiEx::RowLabel("Cores Executed / Frame");
+    ImGui::Text("%.1f", runnerMetrics_.executedCores.average());
+
+    ImGuiEx::RowLabel("Cores Skipped / Frame");
+    ImGui::Text("%.1f", runnerMetrics_.skippedCores.average());
+
+    const uint64_t poolHits         = runnerMetrics_.imagePoolHits.total;
+    const uint64_t poolAcquisitions = poolHits + runnerMetrics_.imagePoolMisses.total;
+    ImGuiEx::RowLabel("Image Pool Hit Rate");
+    if (poolAcquisitions)
+        ImGui::Text("%.1f%%", 100.0 * poolHits / poolAcquisitions);
+    else
+        ImGui::TextUnformatted("-");
+
+    ImGuiEx::RowLabel("Image Pool Resident");
+    ImGui::Text("%.1f MB", runnerMetrics_.imagePoolResidentBytes.average() / (1024 * 1024));
+
+    ImGuiEx::RowLabel("Lua GC / Frame", "Average and max time spent stepping the Lua collector, as the GC Mode has the Runner do.  "
+                                        "Under Automatic, collection happens within scripts, so counts as their execution.");
+    ImGui::Text("%.1f / %.1f us", runnerMetrics_.luaGc.average() / 1000.0, runnerMetrics_.luaGc.maxNs / 1000.0);
+
+    ImGuiEx::RowLabel("Lua Heap");
+    ImGui::Text("%.1f MB", runnerMetrics_.luaHeapBytes.average() / (1024 * 1024));
+
+    if (AllocationCounter::Enabled) {
+        ImGuiEx::RowLabel("Heap Allocations / Frame", "Average and max, over every thread of the Runner.  Lua's own allocations "
+                                                      "aren't counted.");
+        ImGui::Text("%.1f / %llu", runnerMetrics_.allocations.average(), runnerMetrics_.allocations.max);
+    }
+
+    const auto scriptCache = runner_.getScriptCompiler().getCacheStats();
+    ImGuiEx::RowLabel("Script Cache Hits / Misses", "Scripts served by the bytecode cache, and those compiled.");
+    ImGui::Text("%llu / %llu", scriptCache.hits, scriptCache.misses);
+
+    ImGuiEx::RowLabel("Script Cache Size");
+    ImGui::Text("%zu scripts, %.1f KB", scriptCache.entries, scriptCache.bytes / 1024.0);
 }
 
 ImVec2 Graph::getCanvasViewCenter() const
@@ -334,8 +496,8 @@ void Graph::showProperties()
     } else if (ImGui::CollapsingHeader("Graph", ImGuiTreeNodeFlags_DefaultOpen)) {
 
         RunRateMode priorMode                = runRate_.rateMode;
-        static constexpr RunRateMode modes[] = {RunRateMode::Disabled, RunRateMode::SetRate,
-                                                RunRateMode::Unlimited}; // don't support UIRate yet
+        static constexpr RunRateMode modes[] = {RunRateMode::Disabled, RunRateMode::SetRate, RunRateMode::UIRate,
+                                                RunRateMode::Unlimited};
         if (ImGui::BeginCombo("Run Rate Mode", to_display_string(runRate_.rateMode), ImGuiComboFlags_WidthFitPreview)) {
             for (auto mode : modes) {
                 bool selected = mode == runRate_.rateMode;
@@ -363,7 +525,89 @@ void Graph::showProperties()
         ImGui::SameLine();
         ImGuiEx::ToolTipHint("Only used if Run Rate Mode = Set Rate.");
 
+        const float priorUILead = runRate_.uiLeadMs;
+        ImGui::InputFloat("UI Lead (ms)", &runRate_.uiLeadMs, 0.0f, 0.0f, "%.3g");
+        runRate_.uiLeadMs = std::clamp(runRate_.uiLeadMs, 0.0f, 100.0f);
+        if (fabs(priorUILead - runRate_.uiLeadMs) > 1e-9f && RunRateMode::UIRate == runRate_.rateMode) {
+            raiseModified(ChangeImpact::GraphRunRate);
+            runner_.adjustRunRate(runRate_);
+        }
+        ImGui::SameLine();
+        ImGuiEx::ToolTipHint("Only used if Run Rate Mode = UI Rate, which runs a frame for each of the UI's, timed to finish "
+                             "just before the UI's next frame shows it.  Each frame starts as early as the longest of the "
+                             "graph's recent frames took, plus this margin.");
+
+        ExecutionMode priorExecutionMode                = runRate_.executionMode;
+        static constexpr ExecutionMode executionModes[] = {ExecutionMode::RunAll, ExecutionMode::SkipUnchanged};
+        if (ImGui::BeginCombo("Execution Mode", to_display_string(runRate_.executionMode), ImGuiComboFlags_WidthFitPreview)) {
+            for (auto mode : executionModes) {
+                bool selected = mode == runRate_.executionMode;
+                if (ImGui::Selectable(to_display_string(mode), selected)) {
+                    runRate_.executionMode = mode;
+                }
+                if (selected) {
+                    ImGui::SetItemDefaultFocus();
+                }
+            }
+            ImGui::EndCombo();
+        }
+        if (runRate_.executionMode != priorExecutionMode) {
+            raiseModified(ChangeImpact::GraphRunRate);
+            runner_.adjustRunRate(runRate_);
+        }
+        ImGui::SameLine();
+        ImGuiEx::ToolTipHint("Skip Unchanged skips pure nodes (e.g. Value, Switch, Display, and Scripts marked Pure) whose "
+                             "inputs haven't changed since they last ran.");
+
         ImGui::SeparatorText("Lua Environment");
+
+        LuaGcMode priorLuaGcMode                = runRate_.luaGcMode;
+        static constexpr LuaGcMode luaGcModes[] = {LuaGcMode::Automatic, LuaGcMode::FrameStep, LuaGcMode::IdleCollect,
+                                                   LuaGcMode::Manual};
+        if (ImGui::BeginCombo("GC Mode", to_display_string(runRate_.luaGcMode), ImGuiComboFlags_WidthFitPreview)) {
+            for (auto mode : luaGcModes) {
+                bool selected = mode == runRate_.luaGcMode;
+                if (ImGui::Selectable(to_display_string(mode), selected)) {
+                    runRate_.luaGcMode = mode;
+                }
+                if (selected) {
+                    ImGui::SetItemDefaultFocus();
+                }
+            }
+            ImGui::EndCombo();
+        }
+        if (runRate_.luaGcMode != priorLuaGcMode) {
+            raiseModified(ChangeImpact::GraphRunRate);
+            runner_.adjustRunRate(runRate_);
+        }
+        ImGui::SameLine();
+        ImGuiEx::ToolTipHint("Automatic lets the Lua garbage collector run whenever allocation triggers it, often mid-frame.  "
+                             "Frame Step runs it only after each frame, for up to the GC Budget.  Idle Collect runs it only "
+                             "while waiting for the next frame (or as Frame Step, at an Unlimited rate).  Manual leaves it to "
+                             "scripts calling collectgarbage().");
+
+        const float priorLuaGcBudget = runRate_.luaGcBudgetMs;
+        ImGui::InputFloat("GC Budget (ms)", &runRate_.luaGcBudgetMs, 0.0f, 0.0f, "%.3g");
+        runRate_.luaGcBudgetMs = std::clamp(runRate_.luaGcBudgetMs, 0.0f, 1000.0f);
+        if (fabs(priorLuaGcBudget - runRate_.luaGcBudgetMs) > 1e-9f) {
+            raiseModified(ChangeImpact::GraphRunRate);
+            runner_.adjustRunRate(runRate_);
+        }
+        ImGui::SameLine();
+        ImGuiEx::ToolTipHint("Per frame, under Frame Step (and Idle Collect at an Unlimited rate).  Collection the budget can't "
+                             "keep up with carries over to later frames, though only so far before it is done regardless.");
+
+        if (ImGui::InputInt("Lua States", &luaStateCount_, 1, 1, ImGuiInputTextFlags_EnterReturnsTrue)) {
+            luaStateCount_ = std::clamp(luaStateCount_, 1, static_cast<int>(Runner::MaxLuaStates));
+            raiseModified(ChangeImpact::GraphRunRate);
+            sendInitScript();
+        }
+        ImGui::SameLine();
+        ImGuiEx::ToolTipHint("Script nodes are spread across this many Lua states, each with the init script applied, so that "
+                             "scripts of the same dependency level can run in parallel.  Tables and functions don't cross "
+                             "between states - a script reading one from another state's script sees nil - though numbers, "
+                             "strings and images do.  Changing it resets the Lua environment.");
+
         if (ImGui::Button("Reset"))
             sendInitScript();
         if (auto r = runner_.tryAcceptInitScriptResult())
@@ -417,6 +661,9 @@ void Graph::onPinAdded(NodeId nodeId, PinId pinId, PinConfig pinConfig)
         establishDelta();
         pendingDelta_->addedOutputs.push_back(pinId);
     }
+
+    planEditedNodes_.insert(nodeId);
+    planDirty_ = true; // the plan carries each node's pin list
 }
 
 void Graph::onPinRemoved(NodeId nodeId, PinId pinId)
@@ -440,6 +687,9 @@ void Graph::onPinRemoved(NodeId nodeId, PinId pinId)
         establishDelta();
         pendingDelta_->deletedOutputs.push_back(pinId);
     }
+
+    planEditedNodes_.insert(nodeId);
+    planDirty_ = true;
 }
 
 const char *Graph::to_display_string(RunRateMode mode)
@@ -476,6 +726,44 @@ const char *Graph::to_string(RunRateMode mode)
     }
 }
 
+const char *Graph::to_display_string(ExecutionMode mode)
+{
+    switch (mode) {
+        using enum ExecutionMode;
+    case RunAll:
+        return "Run All";
+    case SkipUnchanged:
+        return "Skip Unchanged";
+    default:
+        return "(unknown)";
+    }
+}
+
+const char *Graph::to_string(ExecutionMode mode)
+{
+    switch (mode) {
+        using enum ExecutionMode;
+    case RunAll:
+        return "runall";
+    case SkipUnchanged:
+        return "skipunchanged";
+    default:
+        throw std::runtime_error(std::format("Unknown Graph::ExecutionMode enum value: {}", static_cast<int>(mode)));
+    }
+}
+
+bool Graph::try_parse(std::string_view s, ExecutionMode &out)
+{
+    if (s == "runall") {
+        out = ExecutionMode::RunAll;
+        return true;
+    } else if (s == "skipunchanged") {
+        out = ExecutionMode::SkipUnchanged;
+        return true;
+    } else
+        return false;
+}
+
 bool Graph::try_parse(std::string_view s, RunRateMode &out)
 {
     if (s == "disabled") {
@@ -494,6 +782,58 @@ bool Graph::try_parse(std::string_view s, RunRateMode &out)
         return false;
 }
 
+const char *Graph::to_display_string(LuaGcMode mode)
+{
+    switch (mode) {
+        using enum LuaGcMode;
+    case Automatic:
+        return "Automatic";
+    case FrameStep:
+        return "Frame Step";
+    case IdleCollect:
+        return "Idle Collect";
+    case Manual:
+        return "Manual";
+    default:
+        return "(unknown)";
+    }
+}
+
+const char *Graph::to_string(LuaGcMode mode)
+{
+    switch (mode) {
+        using enum LuaGcMode;
+    case Automatic:
+        return "automatic";
+    case FrameStep:
+        return "framestep";
+    case IdleCollect:
+        return "idlecollect";
+    case Manual:
+        return "manual";
+    default:
+        throw std::runtime_error(std::format("Unknown Graph::LuaGcMode enum value: {}", static_cast<int>(mode)));
+    }
+}
+
+bool Graph::try_parse(std::string_view s, LuaGcMode &out)
+{
+    if (s == "automatic") {
+        out = LuaGcMode::Automatic;
+        return true;
+    } else if (s == "framestep") {
+        out = LuaGcMode::FrameStep;
+        return true;
+    } else if (s == "idlecollect") {
+        out = LuaGcMode::IdleCollect;
+        return true;
+    } else if (s == "manual") {
+        out = LuaGcMode::Manual;
+        return true;
+    } else
+        return false;
+}
+
 void Graph::initRunner()
 {
     updateExecutionPlan();
@@ -504,6 +844,7 @@ void Graph::sendInitScript()
 {
     establishDelta();
     pendingDelta_->luaEnvInitScript = luaEnvInitScript_;
+    pendingDelta_->luaStateCount    = static_cast<uint32_t>(luaStateCount_);
     planDirty_                      = true;
 }
 
@@ -515,59 +856,21 @@ void Graph::establishDelta()
     }
 }
 
-std::vector<NodeId> Graph::toposort(bool &cycleDetected)
-{
-    std::vector<NodeId> result;
-    std::unordered_map<NodeId, int> inDegree;
-    std::unordered_map<NodeId, std::vector<NodeId>> downstream;
-    std::vector<NodeId> queue;
-
-    const auto nodeCount = nodes_.size();
-    result.reserve(nodeCount);
-    inDegree.reserve(nodeCount);
-    downstream.reserve(nodeCount);
-    queue.reserve(nodeCount);
-
-    for (auto &[id, node] : nodes_) {
-        inDegree.try_emplace(id, 0);
-        downstream.try_emplace(id);
-    }
-
-    for (auto &[id, link] : links_) {
-        inDegree.at(link.b.node)++;
-        downstream.at(link.a.node).push_back(link.b.node);
-    }
-
-    for (auto &[id, degree] : inDegree)
-        if (degree == 0)
-            queue.push_back(id);
-
-    while (!queue.empty()) {
-        auto id = queue.back();
-        queue.pop_back();
-        result.push_back(id);
-        for (auto next : downstream.at(id))
-            if (!--inDegree.at(next))
-                queue.push_back(next);
-    }
-
-    cycleDetected = result.size() != nodes_.size();
-    return result;
-}
-
 void Graph::updateExecutionPlan()
 {
     if (!planDirty_)
         return;
     planDirty_ = false;
 
-    auto sortedNodes = toposort(cycleDetected_);
+    // only the edits since the last plan are applied to the order, rather than sorting the whole graph again
+    topoOrder_.update();
+    cycleDetected_ = topoOrder_.hasCycle();
 
     // TODO: if cycle detected, flag newly added links as potentially cyclic
     // TODO: if no cycle detected, clear all such flags
 
     if (cycleDetected_)
-        return;
+        return; // the edits stay recorded, and level changes stay with the order, until a plan can be sent
 
     auto plan     = std::make_unique<ExecutionPlan>();
     plan->version = pendingDelta_ ? pendingDelta_->version : nextPlanVersion_++;
@@ -576,16 +879,77 @@ void Graph::updateExecutionPlan()
         runner_.queueDelta(std::move(pendingDelta_));
     assert(!pendingDelta_); // the move should clear this ptr
 
-    plan->nodeExecutionOrder = std::move(sortedNodes);
+    // a patch is only worthwhile while it lists a small part of the graph, and is only possible if the levels are known to have
+    // changed only where the order reports (i.e. it hasn't sorted everything again)
+    const bool levelsTracked = topoOrder_.takeLevelChanges(levelChanges_);
+    const size_t patchSize   = planEditedNodes_.size() + levelChanges_.size() + planEditedInputs_.size();
+    if (fullPlanSent_ && levelsTracked && patchSize * PlanPatchLimitDivisor <= nodes_.size())
+        buildPlanPatch(*plan);
+    else
+        buildFullPlan(*plan);
 
-    auto &valueLinks = plan->valueLinks;
-    for (auto &[id, link] : links_)
-        valueLinks.push_back(ExecutionPlan::Link{.output = link.a.pin, .input = link.b.pin});
+    planEditedNodes_.clear();
+    planEditedInputs_.clear();
+    fullPlanSent_ = true;
 
     currentPlanVersion_ = plan->version;
     runner_.postPlan(std::move(plan));
 }
 
+void Graph::buildFullPlan(ExecutionPlan &plan)
+{
+    plan.setOrder(topoOrder_, [this](NodeId nodeId, ExecutionPlan::NodePins &pins) { getPlanPins(*nodes_.at(nodeId), pins); });
+
+    auto &valueLinks = plan.valueLinks;
+    valueLinks.reserve(links_.size());
+    for (auto &[id, link] : links_)
+        valueLinks.push_back(ExecutionPlan::Link{.output = link.a.pin, .input = link.b.pin});
+}
+
+void Graph::buildPlanPatch(ExecutionPlan &plan)
+{
+    plan.isPatch = true;
+
+    // each edited node is listed with its current state, or as removed - so the order of edits doesn't matter
+    planEditedNodes_.insert(levelChanges_.begin(), levelChanges_.end());
+    for (auto nodeId : planEditedNodes_) {
+        auto it = nodes_.find(nodeId);
+        if (it == nodes_.end()) {
+            plan.removedNodes.push_back(nodeId);
+            continue;
+        }
+        auto &update = plan.updatedNodes.emplace_back(
+            ExecutionPlan::NodeUpdate{.nodeId = nodeId, .level = topoOrder_.getLevel(nodeId), .pins = {}});
+        getPlanPins(*it->second, update.pins);
+    }
+
+    // likewise each edited input, with the output now linked to it if any
+    for (auto pinId : planEditedInputs_) {
+        auto it = pinLinks_.find(pinId);
+        if (it == pinLinks_.end() || it->second.empty())
+            plan.unlinkedInputs.push_back(pinId);
+        else
+            plan.linkedInputs.push_back(ExecutionPlan::Link{.output = links_.at(*it->second.begin()).a.pin, .input = pinId});
+    }
+}
+
+void Graph::getPlanPins(Node &node, ExecutionPlan::NodePins &pins)
+{
+    // each node's pins, in the node's pin order, become its input and output slots in the Runner
+    auto addPin = [&](PinId pinId, PinDirection direction) {
+        (direction == PinDirection::Input ? pins.inputs : pins.outputs).push_back(pinId);
+    };
+
+    node.updatePinOrder();
+    if (!node.pinOrder_.empty()) {
+        for (auto pinId : node.pinOrder_)
+            addPin(pinId, node.pinIdToConfig_.at(pinId).direction);
+    } else {
+        for (auto &[pinId, config] : node.pinIdToConfig_)
+            addPin(pinId, config.direction);
+    }
+}
+
 void Graph::rebuildWindowName() { windowName_ = std::format("{}###graph-{}", name_, uid_); }
 
 void Graph::initEditorContext()
@@ -615,6 +979,9 @@ void Graph::addLinkWithId(Link &&link, LinkId linkId)
     assert(inserted);
     pinLinks_.at(pinA).insert(linkId);
     pinLinks_.at(pinB).insert(linkId);
+    topoOrder_.addEdge(it->second.a.node, it->second.b.node);
+    planEditedInputs_.insert(pinB);
+    planEditedNodes_.insert(it->second.b.node); // the Runner rebinds an input by rescheduling its node
     planDirty_ = true;
 }
 
@@ -626,6 +993,9 @@ void Graph::removeLink(LinkId linkId)
     const auto &link = it->second;
     pinLinks_.at(link.a.pin).erase(linkId);
     pinLinks_.at(link.b.pin).erase(linkId);
+    topoOrder_.removeEdge(link.a.node, link.b.node);
+    planEditedInputs_.insert(link.b.pin);
+    planEditedNodes_.insert(link.b.node);
     links_.erase(it);
     planDirty_ = true;
 }
@@ -814,8 +1184,10 @@ void Graph::removeNode(NodeId nodeId)
     if (it == nodes_.end())
         return;
 
-    it->second->removeAllPins();
+    it->second->removeAllPins(); // also removes every link to or from the node
     nodes_.erase(it);
+    topoOrder_.removeNode(nodeId);
+    planEditedNodes_.insert(nodeId);
 
     establishDelta();
     pendingDelta_->deletedCores.push_back(nodeId);
@@ -824,6 +1196,9 @@ void Graph::removeNode(NodeId nodeId)
 
 void Graph::onNodeAdded(Node *node)
 {
+    topoOrder_.addNode(node->id_); // every node takes part in the order, with or without a core
+    planEditedNodes_.insert(node->id_);
+
     auto core = node->createCore();
     if (!core)
         return;
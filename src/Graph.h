@@ -12,6 +12,7 @@
 #include "GraphSnippet.h"
 #include "Node.h"
 #include "Runner.h"
+#include "TopoOrder.h"
 
 namespace ax::NodeEditor
 {
@@ -82,9 +83,16 @@ public:
     static const char *to_display_string(RunRateMode mode);
     static const char *to_string(RunRateMode mode);
     static bool try_parse(std::string_view s, RunRateMode &mode);
+    static const char *to_display_string(ExecutionMode mode);
+    static const char *to_string(ExecutionMode mode);
+    static bool try_parse(std::string_view s, ExecutionMode &mode);
+    static const char *to_display_string(LuaGcMode mode);
+    static const char *to_string(LuaGcMode mode);
+    static bool try_parse(std::string_view s, LuaGcMode &mode);
 
     void initRunner();
     void stopRunner() { runner_.stop(); }
+    ScriptCompiler &getScriptCompiler() { return runner_.getScriptCompiler(); }
 
 private:
     GraphId id_;
@@ -93,19 +101,43 @@ private:
     bool visible_           = true;
     RunRateSetting runRate_ = {.rateMode = RunRateMode::SetRate, .desiredFramesPerSecond = 60.0f};
     Runner runner_;
+    Runner::RunnerMetricsBuckets runnerMetrics_{}; // as last read, for diagnostics
+
+    // for diagnostics, timings merged over about a second of frames, as each bucket read holds too few for percentiles
+    struct TimingWindow {
+        FrameHistogramBucket coreExecution, runnerOverhead, framePeriod, frameLateness, selectedNode;
+        PerfCountersBucket selectedNodeCounters;
+    };
+    TimingWindow timingWindow_{}, lastTimingWindow_{}; // filling, and as last filled
+    double timingWindowStart_ = 0.0;                   // ImGui time
+    std::optional<NodeId> timedNodeId_;                // the node whose core's timings fill selectedNode
+    void readTimings();
     PlanVersion nextPlanVersion_    = 1;
     PlanVersion currentPlanVersion_ = 0;
     std::unique_ptr<ResourceDelta> pendingDelta_{nullptr};
     bool planDirty_     = true;
     bool cycleDetected_ = false;
+    TopoOrder topoOrder_; // kept up to date with every node and link add/remove
     std::string luaEnvInitScript_;
     std::string initScriptResult_;
+    int luaStateCount_ = 1; // sent with the init script
+
+    // edits since the last plan was sent, from which the next is built as a patch where possible (see updateExecutionPlan())
+    bool fullPlanSent_ = false;
+    std::unordered_set<NodeId> planEditedNodes_; // added, removed, or whose pins or links changed
+    std::unordered_set<PinId> planEditedInputs_; // linked, unlinked, or removed
+    std::vector<NodeId> levelChanges_;           // updateExecutionPlan() scratch
+
+    // a full plan is sent instead of a patch that would list more than 1 in this many nodes
+    static constexpr size_t PlanPatchLimitDivisor = 4;
 
     void sendInitScript(); // causes a reset of the runner's lua environment
 
     void establishDelta();
-    std::vector<NodeId> toposort(bool &cycleDetected);
     void updateExecutionPlan();
+    void buildFullPlan(ExecutionPlan &plan);
+    void buildPlanPatch(ExecutionPlan &plan);
+    void getPlanPins(Node &node, ExecutionPlan::NodePins &pins);
 
     std::string windowName_; // derived from id and name, but cached so it doesn't reallocate every frame
     void rebuildWindowName();
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "NativeImage.h"
+
+namespace Mirael
+{
+
+/// <summary>
+/// Recycles the storage of NativeImages, keyed by dimensions and format, so that scripts creating new images every frame
+/// reuse the storage of those discarded in earlier frames rather than going to the heap.
+///
+/// Storage returns to the pool once no ValueBuffer or Lua view references its image.  Idle storage of dimensions that go
+/// unused for IdleFrameLimit frames is freed, as is any storage recycled beyond MaxIdleBytes.  The pool must outlive every
+/// image it provides.
+///
+/// A pool serves one lua state, so only one thread acquires from it at once (and none while it ends a frame) and it takes no
+/// lock.  Images may be released on any thread, so their storage is handed back through a lock-free list, which the acquiring
+/// thread takes back into the buckets once it finds a bucket empty, and which is emptied as each frame ends.
+/// </summary>
+class ImagePool final : public NativeImage::Recycler
+{
+public:
+    static constexpr uint64_t IdleFrameLimit = 120;
+    static constexpr size_t MaxIdleBytes     = size_t{256} << 20;
+
+    struct FrameStats {
+        uint32_t hits = 0, misses = 0; // acquisitions served by recycled storage, and by new storage
+        uint64_t residentBytes = 0;    // all storage owned by the pool - in use or idle - at the end of the frame
+    };
+
+    ImagePool() = default;
+    ~ImagePool()
+    {
+        takeReturned();
+        assert(!liveCount_); // every image must have been released
+        for (auto &[key, bucket] : buckets_)
+            for (auto *image : bucket.idle)
+                image->destroy();
+    }
+
+    // forbid copy/move
+    ImagePool(const ImagePool &)            = delete;
+    ImagePool &operator=(const ImagePool &) = delete;
+    ImagePool(ImagePool &&)                 = delete;
+    ImagePool &operator=(ImagePool &&)      = delete;
+
+    /// <summary>
+    /// Provides an image of the given dimensions, holding one ref for the caller.  Its pixels are left as they were.
+    /// </summary>
+    /// <returns>The image, or nullptr if the dimensions are out of range.</returns>
+    NativeImage *acquire(int32_t width, int32_t height, NativeImage::Format format = NativeImage::Format::RGBA8)
+    {
+        if (!NativeImage::isValidSize(width, height))
+            return nullptr;
+
+        auto &bucket    = buckets_[makeKey(width, height, format)];
+        bucket.lastUsed = frame_;
+        if (bucket.idle.empty() && returned_.load(std::memory_order_relaxed))
+            takeReturned();
+        if (!bucket.idle.empty()) {
+            auto *image = bucket.idle.back();
+            bucket.idle.pop_back();
+            idleBytes_ -= image->getByteSize();
+            image->refCount_.store(1, std::memory_order_relaxed);
+            stats_.hits++;
+            liveCount_++;
+            return image;
+        }
+
+        auto *image      = NativeImage::allocate(width, height, format);
+        image->recycler_ = this;
+        residentBytes_ += image->getByteSize();
+        stats_.misses++;
+        liveCount_++;
+        return image;
+    }
+
+    void recycle(NativeImage *image) noexcept override
+    {
+        auto *head = returned_.load(std::memory_order_relaxed);
+        do
+            image->nextReturned_ = head;
+        while (!returned_.compare_exchange_weak(head, image, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    /// <summary>
+    /// Frees storage left idle for too long, then ends the frame.
+    /// </summary>
+    /// <param name="stats">Has the frame's stats added to it.</param>
+    void endFrame(FrameStats &stats)
+    {
+        takeReturned();
+
+        for (auto it = buckets_.begin(); it != buckets_.end();) {
+            auto &bucket = it->second;
+            if (frame_ - bucket.lastUsed < IdleFrameLimit) {
+                ++it;
+                continue;
+            }
+            for (auto *image : bucket.idle) {
+                idleBytes_ -= image->getByteSize();
+                free(image);
+            }
+            it = buckets_.erase(it); // any images of these dimensions still in use are freed on release
+        }
+        frame_++;
+
+        stats.hits += stats_.hits;
+        stats.misses += stats_.misses;
+        stats.residentBytes += residentBytes_;
+        stats_ = {};
+    }
+
+private:
+    struct Bucket {
+        std::vector<NativeImage *> idle;
+        uint64_t lastUsed = 0; // the frame of the latest acquisition
+    };
+
+    std::atomic<NativeImage *> returned_ = nullptr; // storage released since last taken, linked through nextReturned_
+    std::unordered_map<uint64_t, Bucket> buckets_;
+    uint64_t frame_       = 0;
+    size_t idleBytes_     = 0;
+    size_t residentBytes_ = 0;
+    size_t liveCount_     = 0;
+    FrameStats stats_{};
+
+    static uint64_t makeKey(int32_t width, int32_t height, NativeImage::Format format)
+    {
+        return static_cast<uint32_t>(width) | static_cast<uint64_t>(static_cast<uint32_t>(height)) << 16 |
+               static_cast<uint64_t>(format) << 32; // dimensions are at most NativeImage::MaxDimension
+    }
+
+    // takes back all returned storage, into the buckets - or to the heap, if its bucket has gone or too much is idle
+    void takeReturned() noexcept
+    {
+        for (auto *image = returned_.exchange(nullptr, std::memory_order_acquire); image;) {
+            auto *next = image->nextReturned_;
+            liveCount_--;
+
+            const size_t size = image->getByteSize();
+            auto it           = buckets_.find(makeKey(image->getWidth(), image->getHeight(), image->getFormat()));
+            if (it == buckets_.end() || idleBytes_ + size > MaxIdleBytes) {
+                free(image);
+            } else {
+                it->second.idle.push_back(image);
+                idleBytes_ += size;
+            }
+            image = next;
+        }
+    }
+
+    void free(NativeImage *image) noexcept
+    {
+        residentBytes_ -= image->getByteSize();
+        image->destroy();
+    }
+};
+
+} // namespace Mirael
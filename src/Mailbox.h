@@ -46,6 +46,11 @@ public:
         return std::unique_ptr<T>{taken};
     }
 
+    /// <summary>
+    /// Check whether a value is waiting, without accepting it.  Only a hint, as the producer may post at any time.
+    /// </summary>
+    bool hasPending() const noexcept { return pending_.load(std::memory_order_relaxed) != nullptr; }
+
 private:
     std::atomic<T *> pending_{nullptr};
 };
@@ -0,0 +1,175 @@
+#include "pch.h"
+
+#include "NativeArray.h"
+
+#include "ScriptEnv.h"
+
+namespace Mirael
+{
+
+namespace
+{
+
+constexpr int LuaTypeCData = 10; // LuaJIT's type for FFI cdata, which lua.h doesn't name
+
+constexpr const char *TypeNames[] = {"float32", "float64", "int32", nullptr}; // in NativeArray::Type order
+
+// the addresses of these serve as registry keys
+char viewsKey    = 0; // a table mapping each array (as light userdata) to its live view, and each view back to its array
+char makeViewKey = 0; // the function below that makes a new view
+
+// run once per lua state, given the views' finalizer - returns a function making a view of an array given as light userdata
+constexpr std::string_view ViewScript = R"lua(
+local releaseView = ...
+local ffi = require('ffi')
+ffi.cdef[[
+typedef struct mirael_array {
+    const int32_t n, type;
+    union { float *const f32; double *const f64; int32_t *const i32; };
+} mirael_array;
+]]
+local cast, gc = ffi.cast, ffi.gc
+local finalizer = cast('void (*)(mirael_array *)', releaseView)
+return function(array) return gc(cast('mirael_array *', array), finalizer) end
+)lua";
+
+} // namespace
+
+const char *NativeArray::getTypeName(Type type) noexcept
+{
+    return TypeNames[static_cast<int32_t>(type)];
+}
+
+bool NativeArray::parseTypeName(const char *name, Type &type) noexcept
+{
+    for (int32_t i = 0; TypeNames[i]; i++) {
+        if (!std::strcmp(name, TypeNames[i])) {
+            type = static_cast<Type>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+double NativeArray::getElement(int32_t index) const noexcept
+{
+    switch (layout_.type) {
+    case Type::Float32:
+        return getElements<float>()[index];
+    case Type::Int32:
+        return getElements<int32_t>()[index];
+    default:
+        return getElements<double>()[index];
+    }
+}
+
+void NativeArray::establishLuaBindings(lua_State *L)
+{
+    lua_pushlightuserdata(L, &viewsKey);
+    lua_newtable(L);
+    lua_newtable(L); // the views table's metatable
+    lua_pushstring(L, "kv");
+    lua_setfield(L, -2, "__mode"); // weak both ways, so each view lives only as long as Lua references it
+    lua_setmetatable(L, -2);
+    lua_rawset(L, LUA_REGISTRYINDEX);
+
+    lua_pushlightuserdata(L, &makeViewKey);
+    if (luaL_loadbuffer(L, ViewScript.data(), ViewScript.size(), "arrayViews") != LUA_OK)
+        throw std::runtime_error(std::format("Unable to define array views: {}", lua_tostring(L, -1)));
+    lua_pushlightuserdata(L, reinterpret_cast<void *>(&releaseView));
+    if (lua_pcall(L, 1, 1, 0) != LUA_OK)
+        throw std::runtime_error(std::format("Unable to define array views: {}", lua_tostring(L, -1)));
+    lua_rawset(L, LUA_REGISTRYINDEX);
+
+    lua_pushcfunction(L, l_newArray);
+    lua_setglobal(L, "newarray");
+    lua_pushcfunction(L, l_copyArray);
+    lua_setglobal(L, "copyarray");
+}
+
+void NativeArray::pushLuaView(lua_State *L, NativeArray *array)
+{
+    lua_pushlightuserdata(L, &viewsKey);
+    lua_rawget(L, LUA_REGISTRYINDEX); // [views]
+    lua_pushlightuserdata(L, array);
+    lua_rawget(L, -2); // [views, view or nil]
+    if (!lua_isnil(L, -1)) {
+        lua_remove(L, -2); // [view]
+        return;
+    }
+    lua_pop(L, 1); // [views]
+
+    lua_pushlightuserdata(L, &makeViewKey);
+    lua_rawget(L, LUA_REGISTRYINDEX);
+    lua_pushlightuserdata(L, array);
+    lua_call(L, 1, 1); // [views, view]
+    array->retain();   // for the view, until its finalizer runs
+
+    lua_pushlightuserdata(L, array);
+    lua_pushvalue(L, -2);
+    lua_rawset(L, -4); // views[array] = view
+    lua_pushvalue(L, -1);
+    lua_pushlightuserdata(L, array);
+    lua_rawset(L, -4); // views[view] = array
+
+    lua_remove(L, -2); // [view]
+}
+
+NativeArray *NativeArray::toNativeArray(lua_State *L, int index)
+{
+    if (lua_type(L, index) != LuaTypeCData)
+        return nullptr;
+
+    lua_pushvalue(L, index);
+    lua_pushlightuserdata(L, &viewsKey);
+    lua_rawget(L, LUA_REGISTRYINDEX); // [value, views]
+    lua_insert(L, -2);                // [views, value]
+    lua_rawget(L, -2);                // [views, array or nil] - only views we made are listed
+    auto *array = static_cast<NativeArray *>(lua_touserdata(L, -1));
+    lua_pop(L, 2);
+    return array;
+}
+
+int NativeArray::l_newArray(lua_State *L)
+{
+    // newarray(n [, type='float64']) returns a new array of n zeroes, or nil if n is out of range
+    const double count = luaL_checknumber(L, 1);
+    const auto type    = static_cast<Type>(luaL_checkoption(L, 2, "float64", TypeNames));
+
+    auto *array = count >= 0 && count <= MaxCount ? create(static_cast<int32_t>(count), type) : nullptr;
+    if (!array) {
+        lua_pushnil(L);
+        return 1;
+    }
+    pushNewLuaView(L, array);
+    return 1;
+}
+
+int NativeArray::l_copyArray(lua_State *L)
+{
+    // copyarray(array) returns a new copy of the array, or nil if given anything else
+    const auto *src = toNativeArray(L, 1);
+    if (!src) {
+        lua_pushnil(L);
+        return 1;
+    }
+    pushNewLuaView(L, src->clone());
+    return 1;
+}
+
+void NativeArray::pushNewLuaView(lua_State *L, NativeArray *array)
+{
+    pushLuaView(L, array);
+    array->release(); // now held only by the view
+
+    // the elements live outside the lua heap, so the collector is charged for them as though they were allocated within it (as
+    // for images)
+    ScriptEnv::chargeExternalBytes(L, array->getByteSize());
+}
+
+void NativeArray::releaseView(void *view) noexcept
+{
+    static_cast<NativeArray *>(view)->release(); // a view points at the array's layout, which is at its very start
+}
+
+} // namespace Mirael
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <type_traits>
+
+#include "lua.hpp"
+
+namespace Mirael
+{
+
+/*
+ * A NativeArray is a refcounted array of numbers of one type, which a ValueBuffer can hold directly so
+ * that cores pass bulk numeric data between them without any Lua at all.
+ *
+ * As with NativeImage, the header and elements share one allocation, with the elements aligned for
+ * SIMD, and the count and type are fixed at creation.  Arrays are copy-on-write for cores: a core
+ * only writes an array in place while it holds the sole ref (see ValueBuffer::setWritableArray()),
+ * and otherwise writes a new one - so its readers never see an array change under them.
+ *
+ * Lua sees an array as an FFI cdata view of type `mirael_array *`, with the fields n, type, and f32,
+ * f64 and i32 (pointers to the elements, as whichever type they are).  As for images, each view holds
+ * a ref, and pushing the same array again yields the same view for as long as that view lives.
+ */
+class NativeArray final
+{
+public:
+    enum class Type : int32_t {
+        Float32 = 0,
+        Float64,
+        Int32,
+    };
+
+    struct Layout { // mirrored by the mirael_array cdef in NativeArray.cpp, so the two must match
+        int32_t count = 0;
+        Type type     = Type::Float64;
+        void *data    = nullptr;
+    };
+
+    static constexpr int32_t MaxCount        = 1 << 24; // a sanity limit, of 64 MB of float64
+    static constexpr size_t ElementAlignment = 64;
+
+    static bool isValidCount(int32_t count) noexcept { return count >= 0 && count <= MaxCount; }
+    static size_t getElementSize(Type type) noexcept { return type == Type::Float64 ? 8 : 4; }
+    static const char *getTypeName(Type type) noexcept;               // as Lua names it: "float32", "float64" or "int32"
+    static bool parseTypeName(const char *name, Type &type) noexcept; // false if it names no type
+
+    // returns a new array of zeroes, holding one ref for the caller, or nullptr if the count is out of range
+    static NativeArray *create(int32_t count, Type type = Type::Float64)
+    {
+        auto *array = allocate(count, type);
+        if (array)
+            std::memset(array->getData(), 0, array->getByteSize());
+        return array;
+    }
+
+    // returns a copy of the array, holding one ref for the caller
+    NativeArray *clone() const
+    {
+        auto *array = allocate(layout_.count, layout_.type);
+        std::memcpy(array->getData(), getData(), getByteSize());
+        return array;
+    }
+
+    void retain() noexcept { refCount_.fetch_add(1, std::memory_order_relaxed); }
+
+    void release() noexcept
+    {
+        if (refCount_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            destroy();
+    }
+
+    // true while the caller's is the only ref, so that no one else can see a write
+    bool isUnique() const noexcept { return refCount_.load(std::memory_order_acquire) == 1; }
+
+    int32_t getCount() const noexcept { return layout_.count; }
+    Type getType() const noexcept { return layout_.type; }
+    void *getData() noexcept { return layout_.data; }
+    const void *getData() const noexcept { return layout_.data; }
+    size_t getByteSize() const noexcept { return static_cast<size_t>(layout_.count) * getElementSize(layout_.type); }
+
+    template <typename T> T *getElements() noexcept { return static_cast<T *>(layout_.data); }
+    template <typename T> const T *getElements() const noexcept { return static_cast<const T *>(layout_.data); }
+
+    double getElement(int32_t index) const noexcept; // as a double, whatever the type
+
+    // Lua bindings, alongside the type as for NativeImage
+    static void establishLuaBindings(lua_State *L);             // defines the view type, and the newarray/copyarray globals
+    static void pushLuaView(lua_State *L, NativeArray *array);  // pushes the array's view, creating it if needed
+    static NativeArray *toNativeArray(lua_State *L, int index); // the array viewed by the value at index, or nullptr
+
+private:
+    NativeArray(int32_t count, Type type, void *data) : layout_{.count = count, .type = type, .data = data} {}
+    ~NativeArray() = default;
+
+    static NativeArray *allocate(int32_t count, Type type)
+    {
+        if (!isValidCount(count))
+            return nullptr;
+
+        const auto size = static_cast<size_t>(count) * getElementSize(type);
+        void *block     = ::operator new(HeaderSize + size, std::align_val_t{ElementAlignment});
+        return new (block) NativeArray(count, type, static_cast<uint8_t *>(block) + HeaderSize);
+    }
+
+    void destroy() noexcept
+    {
+        this->~NativeArray();
+        ::operator delete(static_cast<void *>(this), std::align_val_t{ElementAlignment});
+    }
+
+    Layout layout_{}; // must stay first, as a view points at it
+    std::atomic<uint32_t> refCount_ = 1;
+
+    static constexpr size_t HeaderSize = ElementAlignment; // the elements follow the header in the same allocation
+
+    static int l_newArray(lua_State *L);
+    static int l_copyArray(lua_State *L);
+    static void pushNewLuaView(lua_State *L, NativeArray *array); // of a new array, taking over the caller's ref
+    static void releaseView(void *view) noexcept;                 // the views' finalizer, called through the FFI
+};
+
+static_assert(offsetof(NativeArray::Layout, data) == 8, "NativeArray::Layout must match the mirael_array cdef.");
+static_assert(sizeof(NativeArray) <= NativeArray::ElementAlignment, "The NativeArray header must fit ahead of its elements.");
+static_assert(std::is_standard_layout_v<NativeArray>, "A view must be able to point at a NativeArray as at its Layout.");
+
+} // namespace Mirael
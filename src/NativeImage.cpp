@@ -0,0 +1,162 @@
+#include "pch.h"
+
+#include "NativeImage.h"
+
+#include "ImagePool.h"
+#include "ScriptEnv.h"
+
+namespace Mirael
+{
+
+namespace
+{
+
+constexpr int LuaTypeCData = 10; // LuaJIT's type for FFI cdata, which lua.h doesn't name
+
+// the addresses of these serve as registry keys
+char viewsKey    = 0; // a table mapping each image (as light userdata) to its live view, and each view back to its image
+char makeViewKey = 0; // the function below that makes a new view
+
+// run once per lua state, given the views' finalizer - returns a function making a view of an image given as light userdata
+constexpr std::string_view ViewScript = R"lua(
+local releaseView = ...
+local ffi = require('ffi')
+ffi.cdef[[
+typedef struct mirael_image { const int32_t w, h, stride, format; uint32_t *const buf; } mirael_image;
+]]
+local cast, gc = ffi.cast, ffi.gc
+local finalizer = cast('void (*)(mirael_image *)', releaseView)
+return function(image) return gc(cast('mirael_image *', image), finalizer) end
+)lua";
+
+} // namespace
+
+void NativeImage::establishLuaBindings(lua_State *L, ImagePool *pool)
+{
+    lua_pushlightuserdata(L, &viewsKey);
+    lua_newtable(L);
+    lua_newtable(L); // the views table's metatable
+    lua_pushstring(L, "kv");
+    lua_setfield(L, -2, "__mode"); // weak both ways, so each view lives only as long as Lua references it
+    lua_setmetatable(L, -2);
+    lua_rawset(L, LUA_REGISTRYINDEX);
+
+    lua_pushlightuserdata(L, &makeViewKey);
+    if (luaL_loadbuffer(L, ViewScript.data(), ViewScript.size(), "imageViews") != LUA_OK)
+        throw std::runtime_error(std::format("Unable to define image views: {}", lua_tostring(L, -1)));
+    lua_pushlightuserdata(L, reinterpret_cast<void *>(&releaseView));
+    if (lua_pcall(L, 1, 1, 0) != LUA_OK)
+        throw std::runtime_error(std::format("Unable to define image views: {}", lua_tostring(L, -1)));
+    lua_rawset(L, LUA_REGISTRYINDEX);
+
+    lua_pushlightuserdata(L, pool);
+    lua_pushcclosure(L, l_newImage, 1);
+    lua_setglobal(L, "newimage");
+    lua_pushlightuserdata(L, pool);
+    lua_pushcclosure(L, l_copyImage, 1);
+    lua_setglobal(L, "copyimage");
+}
+
+void NativeImage::pushLuaView(lua_State *L, NativeImage *image)
+{
+    lua_pushlightuserdata(L, &viewsKey);
+    lua_rawget(L, LUA_REGISTRYINDEX); // [views]
+    lua_pushlightuserdata(L, image);
+    lua_rawget(L, -2); // [views, view or nil]
+    if (!lua_isnil(L, -1)) {
+        lua_remove(L, -2); // [view]
+        return;
+    }
+    lua_pop(L, 1); // [views]
+
+    lua_pushlightuserdata(L, &makeViewKey);
+    lua_rawget(L, LUA_REGISTRYINDEX);
+    lua_pushlightuserdata(L, image);
+    lua_call(L, 1, 1); // [views, view]
+    image->retain();   // for the view, until its finalizer runs
+
+    lua_pushlightuserdata(L, image);
+    lua_pushvalue(L, -2);
+    lua_rawset(L, -4); // views[image] = view
+    lua_pushvalue(L, -1);
+    lua_pushlightuserdata(L, image);
+    lua_rawset(L, -4); // views[view] = image
+
+    lua_remove(L, -2); // [view]
+}
+
+NativeImage *NativeImage::toNativeImage(lua_State *L, int index)
+{
+    if (lua_type(L, index) != LuaTypeCData)
+        return nullptr;
+
+    lua_pushvalue(L, index);
+    lua_pushlightuserdata(L, &viewsKey);
+    lua_rawget(L, LUA_REGISTRYINDEX); // [value, views]
+    lua_insert(L, -2);                // [views, value]
+    lua_rawget(L, -2);                // [views, image or nil] - only views we made are listed
+    auto *image = static_cast<NativeImage *>(lua_touserdata(L, -1));
+    lua_pop(L, 2);
+    return image;
+}
+
+void NativeImage::chargeCollector(lua_State *L, const NativeImage &image)
+{
+    // the pixels live outside the lua heap, so the collector is charged for them as though they were allocated within it -
+    // otherwise it would rarely run for the small views alone, and discarded images would pile up between its cycles
+    ScriptEnv::chargeExternalBytes(L, image.getByteSize());
+}
+
+int NativeImage::l_newImage(lua_State *L)
+{
+    // newimage(w, h [, zeroed=true]) returns a new image, or nil if either dimension is out of range.  Its pixels are zeroed
+    // unless zeroed is false, which leaves them as they were in recycled storage - for images about to be wholly overwritten
+    auto toDimension = [L](int arg) {
+        const double d = luaL_checknumber(L, arg);
+        return d >= 1 && d <= MaxDimension ? static_cast<int32_t>(d) : 0;
+    };
+    const int32_t width = toDimension(1), height = toDimension(2);
+
+    auto *image = acquire(L, width, height, Format::RGBA8);
+    if (!image) {
+        lua_pushnil(L);
+        return 1;
+    }
+    if (lua_isnoneornil(L, 3) || lua_toboolean(L, 3))
+        std::memset(image->getPixels(), 0, image->getByteSize());
+
+    pushLuaView(L, image);
+    image->release(); // now held only by the view
+    chargeCollector(L, *image);
+    return 1;
+}
+
+int NativeImage::l_copyImage(lua_State *L)
+{
+    // copyimage(image) returns a new copy of the image, or nil if given anything else
+    const auto *src = toNativeImage(L, 1);
+    if (!src) {
+        lua_pushnil(L);
+        return 1;
+    }
+
+    auto *image = acquire(L, src->getWidth(), src->getHeight(), src->getFormat());
+    std::memcpy(image->getPixels(), src->getPixels(), src->getByteSize());
+    pushLuaView(L, image);
+    image->release(); // now held only by the view
+    chargeCollector(L, *image);
+    return 1;
+}
+
+NativeImage *NativeImage::acquire(lua_State *L, int32_t width, int32_t height, Format format)
+{
+    auto *pool = static_cast<ImagePool *>(lua_touserdata(L, lua_upvalueindex(1)));
+    return pool ? pool->acquire(width, height, format) : allocate(width, height, format);
+}
+
+void NativeImage::releaseView(void *view) noexcept
+{
+    static_cast<NativeImage *>(view)->release(); // a view points at the image's layout, which is at its very start
+}
+
+} // namespace Mirael
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <type_traits>
+
+#include "lua.hpp"
+
+namespace Mirael
+{
+
+class ImagePool;
+
+/*
+ * A NativeImage is a refcounted block of pixels, which a ValueBuffer can hold directly so that cores
+ * consume images without any Lua stack traffic.
+ *
+ * The header and pixels share one allocation, with the pixels aligned for SIMD.  Dimensions and
+ * format are fixed at creation, while the pixels themselves may be written by whoever holds a ref.
+ * Rows are currently packed (stride is width * 4), so Lua can index pixels linearly as before.
+ *
+ * Storage may come from an ImagePool, in which case it returns there rather than to the heap once
+ * the last ref is released.
+ *
+ * Lua sees an image as an FFI cdata view of type `mirael_image *`, with the fields w, h, stride,
+ * format and buf (a uint32_t pointer to the pixels).  Each view holds a ref, released by its
+ * finalizer, and pushing the same image again yields the same view for as long as that view lives.
+ */
+class NativeImage final
+{
+public:
+    enum class Format : int32_t {
+        RGBA8 = 0, // one uint32_t per pixel, with r in the low byte
+    };
+
+    struct Layout { // mirrored by the mirael_image cdef in NativeImage.cpp, so the two must match
+        int32_t width  = 0;
+        int32_t height = 0;
+        int32_t stride = 0; // in bytes
+        Format format  = Format::RGBA8;
+        void *pixels   = nullptr;
+    };
+
+    static constexpr int32_t MaxDimension  = 2000; // a sanity limit, matching that of the Display core
+    static constexpr size_t PixelAlignment = 64;
+
+    static bool isValidSize(int32_t width, int32_t height) noexcept
+    {
+        return width > 0 && height > 0 && width <= MaxDimension && height <= MaxDimension;
+    }
+
+    // takes back the storage of images it provided, once they are no longer referenced
+    class Recycler
+    {
+    public:
+        virtual void recycle(NativeImage *image) noexcept = 0;
+
+    protected:
+        ~Recycler() = default;
+    };
+
+    // returns a new image with zeroed pixels, holding one ref for the caller, or nullptr if the dimensions are out of range
+    static NativeImage *create(int32_t width, int32_t height, Format format = Format::RGBA8)
+    {
+        auto *image = allocate(width, height, format);
+        if (image)
+            std::memset(image->getPixels(), 0, image->getByteSize());
+        return image;
+    }
+
+    // returns a copy of the image, holding one ref for the caller
+    NativeImage *clone() const
+    {
+        auto *image = allocate(layout_.width, layout_.height, layout_.format);
+        std::memcpy(image->getPixels(), getPixels(), getByteSize());
+        return image;
+    }
+
+    void retain() noexcept { refCount_.fetch_add(1, std::memory_order_relaxed); }
+
+    void release() noexcept
+    {
+        if (refCount_.fetch_sub(1, std::memory_order_acq_rel) != 1)
+            return;
+        if (recycler_)
+            recycler_->recycle(this);
+        else
+            destroy();
+    }
+
+    int32_t getWidth() const noexcept { return layout_.width; }
+    int32_t getHeight() const noexcept { return layout_.height; }
+    int32_t getStride() const noexcept { return layout_.stride; }
+    Format getFormat() const noexcept { return layout_.format; }
+    void *getPixels() noexcept { return layout_.pixels; }
+    const void *getPixels() const noexcept { return layout_.pixels; }
+    size_t getByteSize() const noexcept { return static_cast<size_t>(layout_.stride) * layout_.height; }
+
+    // Lua bindings, which live alongside the type rather than in ScriptEnv so that ValueBuffer can reach them
+    static void establishLuaBindings(lua_State *L, ImagePool *pool); // defines the view type, and the newimage/copyimage globals
+    static void pushLuaView(lua_State *L, NativeImage *image);       // pushes the image's view, creating it if needed
+    static NativeImage *toNativeImage(lua_State *L, int index);      // the image viewed by the value at index, or nullptr
+
+private:
+    NativeImage(int32_t width, int32_t height, Format format, void *pixels)
+        : layout_{.width = width, .height = height, .stride = width * 4, .format = format, .pixels = pixels}
+    {
+    }
+    ~NativeImage() = default;
+
+    static NativeImage *allocate(int32_t width, int32_t height, Format format)
+    {
+        if (!isValidSize(width, height))
+            return nullptr;
+
+        const auto size = static_cast<size_t>(width) * height * 4;
+        void *block     = ::operator new(HeaderSize + size, std::align_val_t{PixelAlignment});
+        return new (block) NativeImage(width, height, format, static_cast<uint8_t *>(block) + HeaderSize);
+    }
+
+    void destroy() noexcept
+    {
+        this->~NativeImage();
+        ::operator delete(static_cast<void *>(this), std::align_val_t{PixelAlignment});
+    }
+
+    Layout layout_{}; // must stay first, as a view points at it
+    std::atomic<uint32_t> refCount_ = 1;
+    Recycler *recycler_             = nullptr; // or the heap
+    NativeImage *nextReturned_      = nullptr; // while handed back to an ImagePool, and not yet taken back
+
+    static constexpr size_t HeaderSize = PixelAlignment; // the pixels follow the header in the same allocation
+
+    static void chargeCollector(lua_State *L, const NativeImage &image);
+    static int l_newImage(lua_State *L);
+    static int l_copyImage(lua_State *L);
+    static NativeImage *acquire(lua_State *L, int32_t width, int32_t height, Format format); // from the closure's pool, if any
+    static void releaseView(void *view) noexcept; // the views' finalizer, called through the FFI
+
+    friend ImagePool;
+};
+
+static_assert(offsetof(NativeImage::Layout, pixels) == 16, "NativeImage::Layout must match the mirael_image cdef.");
+static_assert(sizeof(NativeImage) <= NativeImage::PixelAlignment, "The NativeImage header must fit ahead of its pixels.");
+static_assert(std::is_standard_layout_v<NativeImage>, "A view must be able to point at a NativeImage as at its Layout.");
+
+} // namespace Mirael
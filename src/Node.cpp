@@ -63,6 +63,41 @@ void Node::removePin(std::string_view key)
     }
 }
 
+NodePins Node::addPins(const NodePinKeys &keys)
+{
+    NodePins pins;
+    for (const auto &key : keys.inputs)
+        pins.inputs.push_back(addPin(key, {.direction = PinDirection::Input}));
+    for (const auto &key : keys.outputs)
+        pins.outputs.push_back(addPin(key, {.direction = PinDirection::Output}));
+    return pins;
+}
+
+NodePins Node::getPinIds(const NodePinKeys &keys) const
+{
+    auto getPinId = [this](const std::string &key) {
+        auto it = pinKeyToId_.find(key);
+        if (it == pinKeyToId_.end())
+            throw std::runtime_error(std::format("Node (id={}, type={}) has no pin (key={}).", id_, typeName_, key));
+        return it->second;
+    };
+
+    NodePins pins;
+    pins.inputs.reserve(keys.inputs.size());
+    for (const auto &key : keys.inputs)
+        pins.inputs.push_back(getPinId(key));
+    pins.outputs.reserve(keys.outputs.size());
+    for (const auto &key : keys.outputs)
+        pins.outputs.push_back(getPinId(key));
+    return pins;
+}
+
+void Node::orderPins(const NodePins &pins, std::vector<PinId> &pinOrder)
+{
+    pinOrder.assign(pins.inputs.begin(), pins.inputs.end());
+    pinOrder.insert(pinOrder.end(), pins.outputs.begin(), pins.outputs.end());
+}
+
 GraphElementId Node::getMaxElementId() const
 {
     if (pinKeyToId_.empty())
@@ -94,15 +129,20 @@ void Node::init(Graph &owner, NodeId id, std::string_view nodeTypeName)
 
 void Node::show()
 {
-    if (pinOrderDirty_) {
-        onOrderPins(pinOrder_);
-        assert(pinOrder_.empty() || pinOrder_.size() == pinIdToConfig_.size());
-        pinOrderDirty_ = false;
-    }
-
+    updatePinOrder();
     onShow();
 }
 
+void Node::updatePinOrder()
+{
+    if (!pinOrderDirty_)
+        return;
+
+    onOrderPins(pinOrder_);
+    assert(pinOrder_.empty() || pinOrder_.size() == pinIdToConfig_.size());
+    pinOrderDirty_ = false;
+}
+
 void Node::serialize(nlohmann::json &j) const
 {
     j["type"] = typeName_;
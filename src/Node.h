@@ -51,6 +51,11 @@ protected:
     PinId addPin(std::string_view key, PinConfig config);
     void removePin(std::string_view key);
 
+    // for pins by the keys their core type gives (see NodePinKeys) - adding them all, or finding those already added
+    NodePins addPins(const NodePinKeys &keys);
+    NodePins getPinIds(const NodePinKeys &keys) const;
+    static void orderPins(const NodePins &pins, std::vector<PinId> &pinOrder); // inputs, then outputs
+
     GraphElementId getMaxElementId() const;
     void raiseModified(ChangeImpact impact);
 
@@ -69,6 +74,7 @@ private:
 
     void init(Graph &owner, NodeId id, std::string_view nodeTypeName);
     void show();
+    void updatePinOrder();
 
     void serialize(nlohmann::json &j) const;
     static std::unique_ptr<Node> deserialize(Graph &owner, NodeId id, const nlohmann::json &j);
@@ -1,13 +1,18 @@
 #pragma once
 
+#include <optional>
 #include <span>
-#include <unordered_map>
+#include <string>
+#include <vector>
 
 #include "lua.hpp"
 
 #include "BucketCycle.h"
 #include "data.h"
-#include "FrameMetricsBucket.h"
+#include "FrameArena.h"
+#include "FrameHistogramBucket.h"
+#include "FrameStatsBucket.h"
+#include "PerfCountersBucket.h"
 #include "ValueBuffer.h"
 
 namespace Mirael
@@ -15,10 +20,42 @@ namespace Mirael
 
 class Graph;
 class Runner;
+class ScriptCompiler;
 class ScriptEnv;
+namespace Bench
+{
+class HeadlessGraph;
+}
+
+/*
+ * Determines which threads may execute a core's onFrame().  Cores default to LuaThread, which pins them to the Runner's own
+ * thread.  A core may only declare Any if it never touches lua - neither through the RunContext nor through a ValueBuffer
+ * holding a lua ref - so that it can run concurrently with other cores of its dependency level on the Runner's worker pool.
+ *
+ * A core may declare AnyLuaState if it reaches lua only through its RunContext, so that it can run in any of the Runner's lua
+ * states - on whichever thread is running that state's cores.  Cores linked to one another, directly or through cores that
+ * forward their values (see forwardsLuaValues()), share a state, as the tables and functions they may pass can't cross between
+ * states.  A core keeps its state, as it may keep lua refs there, until the states are reset - or until a new link joins it to
+ * cores in another, when it moves to theirs (see onLuaStateMoved()).  Whatever their affinity, cores reading lua values from
+ * their inputs must pass their context's L, as those buffers may belong to other states (see ValueBuffer).
+ */
+enum class CoreAffinity { LuaThread, Any, AnyLuaState };
+
+/*
+ * A node's pins, each in the node's pin order, which defines its slots.  Each core type gives its node's pin keys (the keys its
+ * pins are saved under) from the node's config, so that a Node and a headless graph loading the same project agree on them.
+ */
+struct NodePinKeys {
+    std::vector<std::string> inputs, outputs;
+};
+struct NodePins {
+    std::vector<PinId> inputs, outputs;
+};
 
 struct CoreInternalChannel {
-    BucketCycle<FrameMetricsBucket> frameMetrics;
+    BucketCycle<FrameHistogramBucket> frameMetrics;    // execution time per frame
+    BucketCycle<FrameStatsBucket> frameAllocations;    // counts per frame, folded only if AllocationCounter::Enabled
+    BucketCycle<PerfCountersBucket> framePerfCounters; // hardware counts, folded only while PerfCounters are enabled and available
 };
 
 class NodeCore
@@ -29,40 +66,62 @@ public:
 protected:
     struct RunContext {
         NodeId nodeId;
-        std::unordered_map<PinId, std::span<const ValueBuffer *>> inputs; // input PinId -> linked output pin value buffers
-        std::unordered_map<PinId, ValueBuffer *> outputs;                 // output PinId -> output value buffer for that pin
-        lua_State *L   = nullptr;
-        ScriptEnv *env = nullptr;
+        std::span<const PinId> inputPins;           // the node's input pins, in its pin order
+        std::span<const ValueBuffer *const> inputs; // parallel to inputPins - the linked output's buffer, or nullptr if unlinked
+        std::span<const PinId> outputPins;          // the node's output pins, in its pin order
+        std::span<ValueBuffer *const> outputs;      // parallel to outputPins - nullptr until the Runner has its buffer
+        lua_State *L             = nullptr;
+        ScriptEnv *env           = nullptr;
+        ScriptCompiler *compiler = nullptr; // compiles scripts to bytecode off the Runner's thread
+        FrameArena *arena        = nullptr; // scratch memory, discarded after each frame (see FrameArena)
 
+        // slot access, where a slot is a pin's 0-based position in the node's pin order for its direction
+        const ValueBuffer *getInputAt(size_t slot) const { return slot < inputs.size() ? inputs[slot] : nullptr; }
+        ValueBuffer *getOutputAt(size_t slot) const { return slot < outputs.size() ? outputs[slot] : nullptr; }
+
+        // pin access - a linear scan, but only over the node's own few pins
         const ValueBuffer *getFirstInput(PinId inputPinId) const
         {
-            auto it = inputs.find(inputPinId);
-            if (it == inputs.end() || it->second.empty())
-                return nullptr;
-            else
-                return it->second.front();
+            for (size_t i = 0; i < inputPins.size(); i++)
+                if (inputPins[i] == inputPinId)
+                    return inputs[i];
+            return nullptr;
         }
 
         ValueBuffer *getOutput(PinId outputPinId) const
         {
-            auto it = outputs.find(outputPinId);
-            if (it == outputs.end())
-                return nullptr;
-            else
-                return it->second;
+            for (size_t i = 0; i < outputPins.size(); i++)
+                if (outputPins[i] == outputPinId)
+                    return outputs[i];
+            return nullptr;
         }
     };
 
     virtual void onFrame(const RunContext &context) = 0;
 
+    virtual CoreAffinity getAffinity() const { return CoreAffinity::LuaThread; } // queried only when a plan is adopted
+
+    // A pure core's outputs depend only on its input values and on changes it reports by hasPendingChanges() (e.g. a config
+    // posted by its node), so under ExecutionMode::SkipUnchanged the Runner skips it for frames in which neither changed.  Both
+    // are queried every such frame, on the thread about to run the core.
+    virtual bool isPure() const { return false; }
+    virtual bool hasPendingChanges() const { return false; }
+
     virtual void onLuaStateReset() {}; // any lua refs kept by the core must be discarded (not released) when this is called
+    virtual void onLuaStateMoved() {}; // likewise, but released, as the state the core leaves is still live (and not running)
+
+    // whether the core's outputs may carry its input values as they are (as a Switch's do), so that the scripts on either side
+    // of it must share its lua state - queried only when a plan is adopted
+    virtual bool forwardsLuaValues() const { return false; }
 
 private:
     std::shared_ptr<CoreInternalChannel> internalChannel_{};
+    std::optional<uint32_t> luaShard_{}; // the Runner's lua state given to an AnyLuaState core, once it has been given one
 
     friend Graph;
     friend Runner;
     friend ScriptEnv;
+    friend Bench::HeadlessGraph;
 };
 
 } // namespace Mirael
\ No newline at end of file
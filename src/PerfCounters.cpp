@@ -0,0 +1,138 @@
+#include "pch.h"
+
+#include "PerfCounters.h"
+
+#ifdef __linux__
+#include <cerrno>
+
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace Mirael
+{
+
+#ifdef __linux__
+
+namespace
+{
+
+/*
+ * The counters are opened as one group, led by the cycle counter, so that they're scheduled onto the PMU together and a
+ * single read() returns them all.  When the PMU is shared with other perf users, the kernel multiplexes the groups, and
+ * Scope::stop() scales the counts up by the share of the time measured the group was actually counting.
+ */
+
+constexpr uint64_t EventConfigs[] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES,
+                                     PERF_COUNT_HW_BRANCH_MISSES};
+constexpr size_t EventCount       = std::size(EventConfigs);
+
+struct GroupReading { // as laid out by PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING
+    uint64_t count, enabledNs, runningNs;
+    uint64_t values[EventCount];
+};
+
+struct ThreadCounters {
+    enum class State { Unopened, Open, Failed };
+    State state = State::Unopened;
+    int fds[EventCount]{};
+
+    ~ThreadCounters()
+    {
+        if (state == State::Open)
+            for (int fd : fds)
+                close(fd);
+    }
+
+    const char *open() noexcept // returns why not, if the counters couldn't be opened
+    {
+        for (size_t i = 0; i < EventCount; i++) {
+            perf_event_attr attr{};
+            attr.size           = sizeof(attr);
+            attr.type           = PERF_TYPE_HARDWARE;
+            attr.config         = EventConfigs[i];
+            attr.exclude_kernel = 1;
+            attr.exclude_hv     = 1;
+            attr.read_format    = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+            // of this thread, on whichever cpu it runs
+            const int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, i ? fds[0] : -1, PERF_FLAG_FD_CLOEXEC));
+            if (fd < 0) {
+                const int error = errno;
+                for (size_t opened = 0; opened < i; opened++)
+                    close(fds[opened]);
+                if (error == EACCES || error == EPERM)
+                    return "Not permitted - see /proc/sys/kernel/perf_event_paranoid.";
+                if (error == ENOENT || error == ENODEV || error == EOPNOTSUPP)
+                    return i ? "The CPU doesn't count every event sampled." : "No hardware counters are exposed (as in most VMs).";
+                return "perf_event_open() failed.";
+            }
+            fds[i] = fd;
+        }
+        return nullptr;
+    }
+};
+
+thread_local ThreadCounters threadCounters;
+
+} // namespace
+
+bool PerfCounters::Scope::read(Reading &reading) noexcept
+{
+    if (threadCounters.state == ThreadCounters::State::Unopened) {
+        const char *reason   = threadCounters.open();
+        threadCounters.state = reason ? ThreadCounters::State::Failed : ThreadCounters::State::Open;
+        if (reason)
+            unavailableReason_.store(reason, std::memory_order_relaxed);
+    }
+    if (threadCounters.state != ThreadCounters::State::Open)
+        return false;
+
+    GroupReading group;
+    if (::read(threadCounters.fds[0], &group, sizeof(group)) != static_cast<ssize_t>(sizeof(group)) || group.count != EventCount)
+        return false;
+    reading = {.enabledNs = group.enabledNs,
+               .runningNs = group.runningNs,
+               .counts    = {.cycles       = group.values[0],
+                             .instructions = group.values[1],
+                             .cacheMisses  = group.values[2],
+                             .branchMisses = group.values[3]}};
+    return true;
+}
+
+bool PerfCounters::Scope::stop(Sample &counted) noexcept
+{
+    Reading end;
+    if (!started_ || !read(end))
+        return false;
+
+    const uint64_t runningNs = end.runningNs - start_.runningNs;
+    if (!runningNs)
+        return false; // the group wasn't scheduled at all meanwhile
+    const double scale = static_cast<double>(end.enabledNs - start_.enabledNs) / static_cast<double>(runningNs);
+    auto delta         = [scale](uint64_t from, uint64_t to) { return static_cast<uint64_t>(static_cast<double>(to - from) * scale); };
+
+    counted = {.cycles       = delta(start_.counts.cycles, end.counts.cycles),
+               .instructions = delta(start_.counts.instructions, end.counts.instructions),
+               .cacheMisses  = delta(start_.counts.cacheMisses, end.counts.cacheMisses),
+               .branchMisses = delta(start_.counts.branchMisses, end.counts.branchMisses)};
+    return true;
+}
+
+#else
+
+bool PerfCounters::Scope::read(Reading &) noexcept
+{
+    unavailableReason_.store("Only supported on Linux.", std::memory_order_relaxed);
+    return false;
+}
+
+bool PerfCounters::Scope::stop(Sample &) noexcept
+{
+    return false;
+}
+
+#endif
+
+} // namespace Mirael
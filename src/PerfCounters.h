@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace Mirael
+{
+
+/// <summary>
+/// Opt-in sampling of the CPU's hardware performance counters - cycles, instructions retired, last level cache misses and
+/// branch misses - around each core's onFrame(), so that a slow core can be told memory-bound (many cache misses, low
+/// instructions per cycle) from compute-bound.  Only supported on Linux, through perf_event_open(), and only where the
+/// kernel exposes a PMU and permits it (see /proc/sys/kernel/perf_event_paranoid); elsewhere nothing is counted, and
+/// getUnavailableReason() says why.
+///
+/// Each thread opens its own counters on first measuring something while enabled, counting in user space only, so a core's
+/// page faults and syscalls aren't counted.  Reading them is a syscall, so a measured core costs about a microsecond more
+/// while enabled.  While disabled, a Scope costs a relaxed load and a branch.
+/// </summary>
+class PerfCounters final
+{
+public:
+    struct Sample {
+        uint64_t cycles = 0, instructions = 0, cacheMisses = 0, branchMisses = 0;
+    };
+
+    static bool isEnabled() noexcept { return enabled_.load(std::memory_order_relaxed); }
+    static void setEnabled(bool enabled) noexcept { enabled_.store(enabled, std::memory_order_relaxed); }
+
+    // why the counters of some thread couldn't be opened, or nullptr if none has failed (or tried) yet
+    static const char *getUnavailableReason() noexcept { return unavailableReason_.load(std::memory_order_relaxed); }
+
+    /// <summary>
+    /// Measures the calling thread's counters from construction to stop(), if enabled and available as constructed.
+    /// </summary>
+    class Scope
+    {
+    public:
+        Scope() noexcept : started_(isEnabled() && read(start_)) {}
+
+        // false if nothing was measured - the counts are then left as they were
+        bool stop(Sample &counted) noexcept;
+
+        Scope(const Scope &)            = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        struct Reading {
+            uint64_t enabledNs = 0, runningNs = 0; // the time the counters were enabled, and actually counting
+            Sample counts;
+        };
+        Reading start_;
+        bool started_;
+
+        static bool read(Reading &reading) noexcept;
+    };
+
+private:
+    static inline std::atomic<bool> enabled_                   = false;
+    static inline std::atomic<const char *> unavailableReason_ = nullptr;
+};
+
+} // namespace Mirael
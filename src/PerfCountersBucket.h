@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+
+#include "PerfCounters.h"
+
+namespace Mirael
+{
+
+/// <summary>
+/// Totals the hardware counters sampled over a number of frames, for use with BucketCycle as FrameMetricsBucket is, and
+/// derives the ratios that tell where a core's time goes: instructions per cycle, and cache and branch misses per thousand
+/// instructions.  The ratios are of the totals, so that a few short frames don't skew them.
+/// </summary>
+struct PerfCountersBucket {
+    uint64_t count = 0; // frames sampled
+    PerfCounters::Sample total;
+
+    void fold(const PerfCounters::Sample &sample, bool reset) noexcept
+    {
+        if (reset)
+            *this = {};
+        count++;
+        total.cycles += sample.cycles;
+        total.instructions += sample.instructions;
+        total.cacheMisses += sample.cacheMisses;
+        total.branchMisses += sample.branchMisses;
+    }
+
+    void merge(const PerfCountersBucket &other) noexcept
+    {
+        count += other.count;
+        total.cycles += other.total.cycles;
+        total.instructions += other.total.instructions;
+        total.cacheMisses += other.total.cacheMisses;
+        total.branchMisses += other.total.branchMisses;
+    }
+
+    double instructionsPerCycle() const noexcept
+    {
+        return total.cycles ? static_cast<double>(total.instructions) / total.cycles : 0.0;
+    }
+    double cacheMissesPerKiloInstruction() const noexcept { return perKiloInstruction(total.cacheMisses); }
+    double branchMissesPerKiloInstruction() const noexcept { return perKiloInstruction(total.branchMisses); }
+
+private:
+    double perKiloInstruction(uint64_t events) const noexcept
+    {
+        return total.instructions ? 1000.0 * static_cast<double>(events) / total.instructions : 0.0;
+    }
+};
+
+} // namespace Mirael
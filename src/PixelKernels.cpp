@@ -0,0 +1,579 @@
+#include "pch.h"
+
+#include "PixelKernels.h"
+#include "SimdSupport.h"
+
+namespace Mirael
+{
+
+namespace
+{
+
+constexpr size_t PaletteSize = 256;
+
+char sizeofKey = 0; // the address serves as the registry key of the function below
+
+// run once per lua state - returns a function giving the size of cdata in bytes, or nil for anything else
+constexpr std::string_view SizeofScript = R"lua(
+local sizeof = require('ffi').sizeof
+return function(value) if type(value) == 'cdata' then return sizeof(value) end end
+)lua";
+
+/*
+ * Row kernels, each over n packed pixels.  The wider kernels hand their tails to the narrower.
+ */
+
+struct RowKernels {
+    const char *instructionSet;
+    void (*fill)(uint32_t *dst, size_t n, uint32_t color);
+    void (*addBlend)(uint32_t *dst, const uint32_t *src, size_t n);     // saturating
+    void (*addBlendWrap)(uint32_t *dst, const uint32_t *src, size_t n); // wrapping
+    void (*lookup)(uint32_t *dst, const uint32_t *src, size_t n, const uint32_t *palette, int shift);
+    void (*extract)(uint32_t *dst, const uint32_t *src, size_t n, int shift);
+    void (*addChannels)(uint32_t *dst, size_t n, uint32_t addends);                       // a byte per channel
+    void (*mulChannels)(uint32_t *dst, size_t n, const std::array<uint16_t, 4> &factors); // 8.8 fixed point
+};
+
+void fillScalar(uint32_t *dst, size_t n, uint32_t color)
+{
+    std::fill_n(dst, n, color);
+}
+
+void addBlendScalar(uint32_t *dst, const uint32_t *src, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        uint32_t result = 0;
+        for (int shift = 0; shift < 32; shift += 8)
+            result |= std::min<uint32_t>(((dst[i] >> shift) & 255) + ((src[i] >> shift) & 255), 255) << shift;
+        dst[i] = result;
+    }
+}
+
+// adds the low 7 bits of each byte, then sets the top bit of each without carrying it
+uint32_t addBytes(uint32_t a, uint32_t b)
+{
+    return ((a & 0x7f7f7f7fu) + (b & 0x7f7f7f7fu)) ^ ((a ^ b) & 0x80808080u);
+}
+
+void addBlendWrapScalar(uint32_t *dst, const uint32_t *src, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        dst[i] = addBytes(dst[i], src[i]);
+}
+
+void lookupScalar(uint32_t *dst, const uint32_t *src, size_t n, const uint32_t *palette, int shift)
+{
+    for (size_t i = 0; i < n; i++)
+        dst[i] = palette[(src[i] >> shift) & 255];
+}
+
+void extractScalar(uint32_t *dst, const uint32_t *src, size_t n, int shift)
+{
+    for (size_t i = 0; i < n; i++)
+        dst[i] = ((src[i] >> shift) & 255) * 0x010101u | 0xff000000u;
+}
+
+void addChannelsScalar(uint32_t *dst, size_t n, uint32_t addends)
+{
+    for (size_t i = 0; i < n; i++)
+        dst[i] = addBytes(dst[i], addends);
+}
+
+void mulChannelsScalar(uint32_t *dst, size_t n, const std::array<uint16_t, 4> &factors)
+{
+    for (size_t i = 0; i < n; i++) {
+        uint32_t result = 0;
+        for (int c = 0; c < 4; c++)
+            result |= std::min<uint32_t>((((dst[i] >> (c * 8)) & 255) * factors[c]) >> 8, 255) << (c * 8);
+        dst[i] = result;
+    }
+}
+
+#ifdef MIRAEL_SIMD_X64
+
+// 4 pixels at a time
+
+void fillSse2(uint32_t *dst, size_t n, uint32_t color)
+{
+    const __m128i v = _mm_set1_epi32(static_cast<int>(color));
+    size_t i        = 0;
+    for (; i + 4 <= n; i += 4)
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), v);
+    fillScalar(dst + i, n - i, color);
+}
+
+void addBlendSse2(uint32_t *dst, const uint32_t *src, size_t n)
+{
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + i));
+        const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_adds_epu8(d, s));
+    }
+    addBlendScalar(dst + i, src + i, n - i);
+}
+
+void addBlendWrapSse2(uint32_t *dst, const uint32_t *src, size_t n)
+{
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + i));
+        const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_add_epi8(d, s));
+    }
+    addBlendWrapScalar(dst + i, src + i, n - i);
+}
+
+void extractSse2(uint32_t *dst, const uint32_t *src, size_t n, int shift)
+{
+    const __m128i count = _mm_cvtsi32_si128(shift);
+    const __m128i mask  = _mm_set1_epi32(255);
+    const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xff000000u));
+    size_t i            = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128i c    = _mm_and_si128(_mm_srl_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i)), count), mask);
+        const __m128i grey = _mm_or_si128(_mm_or_si128(c, _mm_slli_epi32(c, 8)), _mm_or_si128(_mm_slli_epi32(c, 16), alpha));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), grey);
+    }
+    extractScalar(dst + i, src + i, n - i, shift);
+}
+
+void addChannelsSse2(uint32_t *dst, size_t n, uint32_t addends)
+{
+    const __m128i a = _mm_set1_epi32(static_cast<int>(addends));
+    size_t i        = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_add_epi8(d, a));
+    }
+    addChannelsScalar(dst + i, n - i, addends);
+}
+
+// multiplies 16-bit channels (each at most 255) by 8.8 factors, saturating at 255
+inline __m128i mulChannels16(__m128i c, __m128i factors, __m128i max)
+{
+    const __m128i product = _mm_mulhi_epu16(_mm_slli_epi16(c, 8), factors); // (c << 8) * f >> 16, so c * f >> 8
+    return _mm_sub_epi16(product, _mm_subs_epu16(product, max));              // min(product, max), lacking SSE4.1
+}
+
+void mulChannelsSse2(uint32_t *dst, size_t n, const std::array<uint16_t, 4> &factors)
+{
+    const auto [r, g, b, a] = factors;
+    const __m128i f         = _mm_setr_epi16(r, g, b, a, r, g, b, a); // short's range is fine, as the multiply is unsigned
+    const __m128i zero      = _mm_setzero_si128();
+    const __m128i max       = _mm_set1_epi16(255);
+    size_t i                = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128i d  = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + i));
+        const __m128i lo = mulChannels16(_mm_unpacklo_epi8(d, zero), f, max);
+        const __m128i hi = mulChannels16(_mm_unpackhi_epi8(d, zero), f, max);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packus_epi16(lo, hi));
+    }
+    mulChannelsScalar(dst + i, n - i, factors);
+}
+
+// SSE2 has no gather, so lookups stay scalar
+constexpr RowKernels Sse2Kernels = {"sse2",       fillSse2,        addBlendSse2,   addBlendWrapSse2, lookupScalar,
+                                    extractSse2, addChannelsSse2, mulChannelsSse2};
+
+// 8 pixels at a time
+
+MIRAEL_TARGET_AVX2 void fillAvx2(uint32_t *dst, size_t n, uint32_t color)
+{
+    const __m256i v = _mm256_set1_epi32(static_cast<int>(color));
+    size_t i        = 0;
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), v);
+    fillSse2(dst + i, n - i, color);
+}
+
+MIRAEL_TARGET_AVX2 void addBlendAvx2(uint32_t *dst, const uint32_t *src, size_t n)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dst + i));
+        const __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_adds_epu8(d, s));
+    }
+    addBlendSse2(dst + i, src + i, n - i);
+}
+
+MIRAEL_TARGET_AVX2 void addBlendWrapAvx2(uint32_t *dst, const uint32_t *src, size_t n)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dst + i));
+        const __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_add_epi8(d, s));
+    }
+    addBlendWrapSse2(dst + i, src + i, n - i);
+}
+
+MIRAEL_TARGET_AVX2 void lookupAvx2(uint32_t *dst, const uint32_t *src, size_t n, const uint32_t *palette, int shift)
+{
+    const __m128i count = _mm_cvtsi32_si128(shift);
+    const __m256i mask  = _mm256_set1_epi32(255);
+    const auto *base    = reinterpret_cast<const int *>(palette);
+    size_t i            = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256i s     = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+        const __m256i index = _mm256_and_si256(_mm256_srl_epi32(s, count), mask);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_i32gather_epi32(base, index, 4));
+    }
+    lookupScalar(dst + i, src + i, n - i, palette, shift);
+}
+
+MIRAEL_TARGET_AVX2 void extractAvx2(uint32_t *dst, const uint32_t *src, size_t n, int shift)
+{
+    const __m128i count = _mm_cvtsi32_si128(shift);
+    const __m256i mask  = _mm256_set1_epi32(255);
+    const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xff000000u));
+    size_t i            = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256i s    = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+        const __m256i c    = _mm256_and_si256(_mm256_srl_epi32(s, count), mask);
+        const __m256i grey = _mm256_or_si256(_mm256_or_si256(c, _mm256_slli_epi32(c, 8)),
+                                             _mm256_or_si256(_mm256_slli_epi32(c, 16), alpha));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), grey);
+    }
+    extractSse2(dst + i, src + i, n - i, shift);
+}
+
+MIRAEL_TARGET_AVX2 void addChannelsAvx2(uint32_t *dst, size_t n, uint32_t addends)
+{
+    const __m256i a = _mm256_set1_epi32(static_cast<int>(addends));
+    size_t i        = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dst + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_add_epi8(d, a));
+    }
+    addChannelsSse2(dst + i, n - i, addends);
+}
+
+MIRAEL_TARGET_AVX2 void mulChannelsAvx2(uint32_t *dst, size_t n, const std::array<uint16_t, 4> &factors)
+{
+    const auto [r, g, b, a] = factors;
+    const __m256i f         = _mm256_setr_epi16(r, g, b, a, r, g, b, a, r, g, b, a, r, g, b, a);
+    const __m256i zero      = _mm256_setzero_si256();
+    const __m256i max       = _mm256_set1_epi16(255);
+    size_t i                = 0;
+    for (; i + 8 <= n; i += 8) { // unpacking and packing both work within each 128-bit lane, so pixels keep their places
+        const __m256i d      = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dst + i));
+        const __m256i lo     = _mm256_mulhi_epu16(_mm256_slli_epi16(_mm256_unpacklo_epi8(d, zero), 8), f);
+        const __m256i hi     = _mm256_mulhi_epu16(_mm256_slli_epi16(_mm256_unpackhi_epi8(d, zero), 8), f);
+        const __m256i packed = _mm256_packus_epi16(_mm256_min_epu16(lo, max), _mm256_min_epu16(hi, max));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), packed);
+    }
+    mulChannelsSse2(dst + i, n - i, factors);
+}
+
+constexpr RowKernels Avx2Kernels = {"avx2",      fillAvx2,        addBlendAvx2,   addBlendWrapAvx2, lookupAvx2,
+                                    extractAvx2, addChannelsAvx2, mulChannelsAvx2};
+
+#endif // MIRAEL_SIMD_X64
+
+const RowKernels &getRowKernels()
+{
+#ifdef MIRAEL_SIMD_X64
+    static const RowKernels &kernels = cpuHasAvx2() ? Avx2Kernels : Sse2Kernels;
+    return kernels;
+#else
+    static constexpr RowKernels ScalarKernels = {"scalar",      fillScalar,        addBlendScalar,   addBlendWrapScalar, lookupScalar,
+                                                 extractScalar, addChannelsScalar, mulChannelsScalar};
+    return ScalarKernels;
+#endif
+}
+
+/*
+ * Image geometry
+ */
+
+uint32_t *rowAt(NativeImage &image, int32_t x, int32_t y)
+{
+    return static_cast<uint32_t *>(image.getPixels()) + static_cast<size_t>(y) * (image.getStride() / 4) + x;
+}
+
+const uint32_t *rowAt(const NativeImage &image, int32_t x, int32_t y)
+{
+    return static_cast<const uint32_t *>(image.getPixels()) + static_cast<size_t>(y) * (image.getStride() / 4) + x;
+}
+
+// calls rowFn(dstRow, srcRow, n) over the overlap of dst and src placed at (x, y), as a single row where the rows are contiguous
+template <typename RowFn>
+void forEachOverlappingRow(NativeImage &dst, const NativeImage &src, int32_t x, int32_t y, RowFn &&rowFn)
+{
+    const int32_t dstX   = std::max(x, 0), dstY = std::max(y, 0);
+    const int32_t srcX   = dstX - x, srcY = dstY - y;
+    const int32_t width  = std::min(dst.getWidth() - dstX, src.getWidth() - srcX);
+    const int32_t height = std::min(dst.getHeight() - dstY, src.getHeight() - srcY);
+    if (width <= 0 || height <= 0)
+        return;
+
+    const auto rowBytes = static_cast<int32_t>(width * sizeof(uint32_t));
+    if (dst.getStride() == rowBytes && src.getStride() == rowBytes) {
+        rowFn(rowAt(dst, dstX, dstY), rowAt(src, srcX, srcY), static_cast<size_t>(width) * height);
+        return;
+    }
+    for (int32_t row = 0; row < height; row++)
+        rowFn(rowAt(dst, dstX, dstY + row), rowAt(src, srcX, srcY + row), static_cast<size_t>(width));
+}
+
+int toShift(PixelKernels::Channel channel)
+{
+    return static_cast<int>(channel) * 8;
+}
+
+/*
+ * Lua argument handling
+ */
+
+NativeImage &checkImage(lua_State *L, int arg)
+{
+    auto *image = NativeImage::toNativeImage(L, arg);
+    if (!image)
+        luaL_typerror(L, arg, "image");
+    return *image;
+}
+
+int32_t checkOffset(lua_State *L, int arg)
+{
+    // anything further out than this overlaps nothing anyway
+    constexpr lua_Integer Limit = NativeImage::MaxDimension;
+    return static_cast<int32_t>(std::clamp<lua_Integer>(luaL_optinteger(L, arg, 0), -Limit, Limit));
+}
+
+PixelKernels::Channel checkChannel(lua_State *L, int arg)
+{
+    static constexpr const char *ChannelNames[] = {"r", "g", "b", "a", nullptr};
+    return static_cast<PixelKernels::Channel>(luaL_checkoption(L, arg, "r", ChannelNames));
+}
+
+// the four channel arguments from arg onward, the last (alpha) being optional
+template <typename T>
+std::array<T, 4> checkChannelArgs(lua_State *L, int arg, T alphaDefault, T (*check)(lua_State *, int))
+{
+    return {check(L, arg), check(L, arg + 1), check(L, arg + 2), lua_isnoneornil(L, arg + 3) ? alphaDefault : check(L, arg + 3)};
+}
+
+int32_t checkInt(lua_State *L, int arg)
+{
+    return static_cast<int32_t>(std::clamp<lua_Number>(luaL_checknumber(L, arg), INT32_MIN, INT32_MAX));
+}
+
+double checkDouble(lua_State *L, int arg)
+{
+    return luaL_checknumber(L, arg);
+}
+
+// copied out, as the palette may be unaligned, or be the very image being written
+std::array<uint32_t, PaletteSize> checkPalette(lua_State *L, int arg)
+{
+    std::array<uint32_t, PaletteSize> palette;
+    const void *data = nullptr;
+    if (auto *image = NativeImage::toNativeImage(L, arg)) {
+        if (image->getByteSize() >= sizeof(palette))
+            data = image->getPixels();
+    } else {
+        lua_pushlightuserdata(L, &sizeofKey);
+        lua_rawget(L, LUA_REGISTRYINDEX);
+        lua_pushvalue(L, arg);
+        lua_call(L, 1, 1);
+        if (lua_tointeger(L, -1) >= static_cast<lua_Integer>(sizeof(palette)))
+            data = lua_topointer(L, arg); // the address of cdata's contents
+        lua_pop(L, 1);
+    }
+    if (!data)
+        luaL_argerror(L, arg, "palette of 256 colors expected");
+    std::memcpy(palette.data(), data, sizeof(palette));
+    return palette;
+}
+
+uint8_t toByte(lua_Number value)
+{
+    return static_cast<uint8_t>(std::clamp<lua_Number>(value, 0, 255));
+}
+
+} // namespace
+
+void PixelKernels::fill(NativeImage &dst, uint32_t color)
+{
+    getRowKernels().fill(rowAt(dst, 0, 0), static_cast<size_t>(dst.getStride() / 4) * dst.getHeight(), color);
+}
+
+void PixelKernels::blit(NativeImage &dst, const NativeImage &src, int32_t x, int32_t y)
+{
+    if (&dst == &src) {
+        if (x || y) { // the rows would overlap, so go through a copy
+            auto *copy = src.clone();
+            blit(dst, *copy, x, y);
+            copy->release();
+        }
+        return;
+    }
+    // memcpy already runs at memory bandwidth
+    forEachOverlappingRow(dst, src, x, y, [](uint32_t *d, const uint32_t *s, size_t n) { std::memcpy(d, s, n * sizeof(uint32_t)); });
+}
+
+void PixelKernels::addBlend(NativeImage &dst, const NativeImage &src, int32_t x, int32_t y, bool wrap)
+{
+    if (&dst == &src && (x || y)) {
+        auto *copy = src.clone();
+        addBlend(dst, *copy, x, y, wrap);
+        copy->release();
+        return;
+    }
+    forEachOverlappingRow(dst, src, x, y, wrap ? getRowKernels().addBlendWrap : getRowKernels().addBlend);
+}
+
+void PixelKernels::lookup(NativeImage &dst, const NativeImage &src, const uint32_t *palette, Channel channel)
+{
+    const auto &kernels = getRowKernels();
+    forEachOverlappingRow(dst, src, 0, 0,
+                          [&](uint32_t *d, const uint32_t *s, size_t n) { kernels.lookup(d, s, n, palette, toShift(channel)); });
+}
+
+void PixelKernels::extract(NativeImage &dst, const NativeImage &src, Channel channel)
+{
+    const auto &kernels = getRowKernels();
+    forEachOverlappingRow(dst, src, 0, 0,
+                          [&](uint32_t *d, const uint32_t *s, size_t n) { kernels.extract(d, s, n, toShift(channel)); });
+}
+
+void PixelKernels::addChannels(NativeImage &dst, std::array<int32_t, 4> addends)
+{
+    uint32_t packed = 0;
+    for (int c = 0; c < 4; c++)
+        packed |= static_cast<uint32_t>(static_cast<uint8_t>(addends[c])) << (c * 8); // two's complement, so negatives subtract
+    getRowKernels().addChannels(rowAt(dst, 0, 0), static_cast<size_t>(dst.getStride() / 4) * dst.getHeight(), packed);
+}
+
+void PixelKernels::mulChannels(NativeImage &dst, std::array<double, 4> factors)
+{
+    std::array<uint16_t, 4> fixed;
+    for (int c = 0; c < 4; c++)
+        fixed[c] = static_cast<uint16_t>(std::clamp(std::lround(factors[c] * 256), 0L, 65535L));
+    getRowKernels().mulChannels(rowAt(dst, 0, 0), static_cast<size_t>(dst.getStride() / 4) * dst.getHeight(), fixed);
+}
+
+void PixelKernels::modChannels(NativeImage &dst, std::array<int32_t, 4> divisors)
+{
+    // no instruction set divides bytes, so this maps each channel through a table of its own instead
+    std::array<std::array<uint8_t, 256>, 4> tables;
+    for (int c = 0; c < 4; c++)
+        for (int v = 0; v < 256; v++)
+            tables[c][v] = static_cast<uint8_t>(v % std::clamp(divisors[c], 1, 256));
+
+    auto *p = rowAt(dst, 0, 0);
+    for (size_t i = 0, n = static_cast<size_t>(dst.getStride() / 4) * dst.getHeight(); i < n; i++)
+        p[i] = tables[0][p[i] & 255] | tables[1][(p[i] >> 8) & 255] << 8 | tables[2][(p[i] >> 16) & 255] << 16 |
+               static_cast<uint32_t>(tables[3][p[i] >> 24]) << 24;
+}
+
+const char *PixelKernels::getInstructionSet()
+{
+    return getRowKernels().instructionSet;
+}
+
+void PixelKernels::establishLuaBindings(lua_State *L)
+{
+    lua_pushlightuserdata(L, &sizeofKey);
+    if (luaL_loadbuffer(L, SizeofScript.data(), SizeofScript.size(), "pixels") != LUA_OK)
+        throw std::runtime_error(std::format("Unable to define pixels: {}", lua_tostring(L, -1)));
+    if (lua_pcall(L, 0, 1, 0) != LUA_OK)
+        throw std::runtime_error(std::format("Unable to define pixels: {}", lua_tostring(L, -1)));
+    lua_rawset(L, LUA_REGISTRYINDEX);
+
+    // each takes its destination image first, and returns it
+    static constexpr luaL_Reg Functions[] = {
+        {"fill", l_fill}, {"copy", l_copy}, {"blit", l_blit}, {"addblend", l_addBlend}, {"lut", l_lookup}, {"extract", l_extract},
+        {"add", l_add},   {"mul", l_mul},   {"mod", l_mod},   {nullptr, nullptr},
+    };
+    lua_newtable(L);
+    luaL_register(L, nullptr, Functions);
+    lua_pushstring(L, getInstructionSet());
+    lua_setfield(L, -2, "simd");
+    lua_setglobal(L, "pixels");
+}
+
+int PixelKernels::l_fill(lua_State *L)
+{
+    // pixels.fill(dst, r, g, b [, a=255])
+    auto &dst       = checkImage(L, 1);
+    const auto rgba = checkChannelArgs<double>(L, 2, 255, checkDouble);
+    fill(dst, toByte(rgba[0]) | toByte(rgba[1]) << 8 | toByte(rgba[2]) << 16 | static_cast<uint32_t>(toByte(rgba[3])) << 24);
+    lua_settop(L, 1);
+    return 1;
+}
+
+int PixelKernels::l_copy(lua_State *L)
+{
+    // pixels.copy(dst, src) - as blit, at the top left
+    blit(checkImage(L, 1), checkImage(L, 2), 0, 0);
+    lua_settop(L, 1);
+    return 1;
+}
+
+int PixelKernels::l_blit(lua_State *L)
+{
+    // pixels.blit(dst, src [, x=0, y=0])
+    blit(checkImage(L, 1), checkImage(L, 2), checkOffset(L, 3), checkOffset(L, 4));
+    lua_settop(L, 1);
+    return 1;
+}
+
+int PixelKernels::l_addBlend(lua_State *L)
+{
+    // pixels.addblend(dst, src [, x=0, y=0, wrap=false])
+    addBlend(checkImage(L, 1), checkImage(L, 2), checkOffset(L, 3), checkOffset(L, 4), lua_toboolean(L, 5));
+    lua_settop(L, 1);
+    return 1;
+}
+
+int PixelKernels::l_lookup(lua_State *L)
+{
+    // pixels.lut(dst, src, palette [, channel='r']) - the palette is an image or cdata of at least 256 colors
+    auto &dst          = checkImage(L, 1);
+    const auto &src    = checkImage(L, 2);
+    const auto palette = checkPalette(L, 3);
+    lookup(dst, src, palette.data(), checkChannel(L, 4));
+    lua_settop(L, 1);
+    return 1;
+}
+
+int PixelKernels::l_extract(lua_State *L)
+{
+    // pixels.extract(dst, src [, channel='r'])
+    extract(checkImage(L, 1), checkImage(L, 2), checkChannel(L, 3));
+    lua_settop(L, 1);
+    return 1;
+}
+
+int PixelKernels::l_add(lua_State *L)
+{
+    // pixels.add(dst, r, g, b [, a=0])
+    addChannels(checkImage(L, 1), checkChannelArgs<int32_t>(L, 2, 0, checkInt));
+    lua_settop(L, 1);
+    return 1;
+}
+
+int PixelKernels::l_mul(lua_State *L)
+{
+    // pixels.mul(dst, r, g, b [, a=1])
+    mulChannels(checkImage(L, 1), checkChannelArgs<double>(L, 2, 1, checkDouble));
+    lua_settop(L, 1);
+    return 1;
+}
+
+int PixelKernels::l_mod(lua_State *L)
+{
+    // pixels.mod(dst, r, g, b [, a=256])
+    auto &dst           = checkImage(L, 1);
+    const auto divisors = checkChannelArgs<int32_t>(L, 2, 256, checkInt);
+    for (int c = 0; c < 4; c++)
+        luaL_argcheck(L, divisors[c] >= 1 && divisors[c] <= 256, 2 + c, "divisor must be from 1 to 256");
+    modChannels(dst, divisors);
+    lua_settop(L, 1);
+    return 1;
+}
+
+} // namespace Mirael
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "lua.hpp"
+
+#include "NativeImage.h"
+
+namespace Mirael
+{
+
+/*
+ * Whole-image pixel operations over RGBA8 NativeImages, vectorized with SSE2 or AVX2 (as the CPU
+ * allows) with a scalar fallback, so that scripts need not touch each pixel from Lua.
+ *
+ * Operations between two images work over the overlap of the destination and the source (placed at
+ * an offset, where given), so they clip rather than fail.  The destination may be the source.
+ *
+ * Scripts reach these through the `pixels` global table - see doc/ImageHandling.md.
+ */
+class PixelKernels final
+{
+public:
+    enum class Channel : int { R = 0, G, B, A }; // by byte, from the lowest
+
+    static void fill(NativeImage &dst, uint32_t color);
+
+    // copies src onto dst at (x, y)
+    static void blit(NativeImage &dst, const NativeImage &src, int32_t x, int32_t y);
+
+    // adds src onto dst at (x, y), each channel saturating at 255, or else wrapping as if mod 256
+    static void addBlend(NativeImage &dst, const NativeImage &src, int32_t x, int32_t y, bool wrap = false);
+
+    // maps one channel of each src pixel through a palette of 256 colors
+    static void lookup(NativeImage &dst, const NativeImage &src, const uint32_t *palette, Channel channel);
+
+    // writes one channel of each src pixel as opaque grey
+    static void extract(NativeImage &dst, const NativeImage &src, Channel channel);
+
+    // per-channel operations, in place
+    static void addChannels(NativeImage &dst, std::array<int32_t, 4> addends);  // wrapping, as if mod 256
+    static void mulChannels(NativeImage &dst, std::array<double, 4> factors);   // saturating at 255
+    static void modChannels(NativeImage &dst, std::array<int32_t, 4> divisors); // each divisor from 1 to 256
+
+    static const char *getInstructionSet(); // the widest in use: "avx2", "sse2" or "scalar"
+
+    static void establishLuaBindings(lua_State *L); // defines the pixels global table
+
+private:
+    static int l_fill(lua_State *L);
+    static int l_copy(lua_State *L);
+    static int l_blit(lua_State *L);
+    static int l_addBlend(lua_State *L);
+    static int l_lookup(lua_State *L);
+    static int l_extract(lua_State *L);
+    static int l_add(lua_State *L);
+    static int l_mul(lua_State *L);
+    static int l_mod(lua_State *L);
+};
+
+} // namespace Mirael
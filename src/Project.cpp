@@ -124,6 +124,7 @@ void Project::save(const std::filesystem::path &filepath)
         throw std::runtime_error("Failed to write data to: " + filepath.string());
     isModifiedFlag_ = false;
     storeFilepath(filepath);
+    writeBytecodeCache(filepath);
 }
 
 [[nodiscard]] std::unique_ptr<Project> Project::load(const std::filesystem::path &filepath)
@@ -136,6 +137,7 @@ void Project::save(const std::filesystem::path &filepath)
     // TODO: catch parse errors and fail gracefully with user notice
     auto project = deserialize(j);
     project->storeFilepath(filepath);
+    project->readBytecodeCache(filepath); // before the runners start, so that their first frame finds it
 
     for (auto &[id, graph] : project->graphMap_)
         graph->initRunner();
@@ -160,6 +162,31 @@ void Project::storeFilepath(std::filesystem::path filepath)
     fileName_     = filepath.filename().string();
 }
 
+void Project::readBytecodeCache(const std::filesystem::path &filepath)
+{
+    if (!App::get().getScriptCacheSettings().keepOnDisk)
+        return;
+
+    // the file holds each graph's cache in turn, and each graph reads them all, as their scripts may match
+    std::ifstream i(std::filesystem::path(filepath).replace_extension(".mirbc"), std::ios::binary);
+    for (auto &[id, graph] : graphMap_) {
+        i.clear();
+        i.seekg(0);
+        graph->getScriptCompiler().readCache(i);
+    }
+}
+
+void Project::writeBytecodeCache(const std::filesystem::path &filepath) const
+{
+    if (!App::get().getScriptCacheSettings().keepOnDisk)
+        return;
+
+    // only a cache, so failing to write it fails nothing else
+    std::ofstream o(std::filesystem::path(filepath).replace_extension(".mirbc"), std::ios::binary | std::ios::trunc);
+    for (const auto &[id, graph] : graphMap_)
+        graph->getScriptCompiler().writeCache(o);
+}
+
 void Project::serialize(nlohmann::json &j) const
 {
     j["graphs"] = json::object();
@@ -70,6 +70,8 @@ private:
     std::optional<std::filesystem::path> lastFilepath_;
     std::string fileName_ = "unnamed project";
     void storeFilepath(std::filesystem::path filepath);
+    void readBytecodeCache(const std::filesystem::path &filepath);        // if kept on disk - see App::ScriptCacheSettings
+    void writeBytecodeCache(const std::filesystem::path &filepath) const; // likewise
     void serialize(nlohmann::json &j) const;
     [[nodiscard]] static std::unique_ptr<Project> deserialize(const nlohmann::json &j);
 
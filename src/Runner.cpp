@@ -2,45 +2,110 @@
 
 #include <cmath>
 #include <memory>
+#include <tuple>
 
+#include "FrameTrace.h"
+#include "PerfCounters.h"
 #include "Runner.h"
 
 namespace Mirael
 {
 
-Runner::Runner() { scriptEnv_.emplace(runContext_); }
+Runner::Runner()
+{
+    addLuaShard();
+    outputBuffers_.onNewLuaState(luaShards_.front()->env->L);
+}
 
 Runner::~Runner()
 {
     stop();
+    workerPool_.stop();
 
-    for (auto &[pinId, buf] : outputPinBuffers_)
-        buf->clear();
+    clearOutputBuffers();
 
-    scriptEnv_.reset();
+    luaShards_.clear();
 
-    // the above is required before the lua state autodestructs
+    // the above is required before the lua states autodestruct
 }
 
 void Runner::onNewUIFrame()
 {
-    // TODO: impl - will be needed when runRate_.rateMode == UIRate
+    // only the UI thread stores these, so reads them back relaxed
+    const int64_t nowNs  = toNs(frameClock_t::now());
+    const int64_t lastNs = uiFrameNs_.load(std::memory_order_relaxed);
+    if (lastNs) {
+        // intervals well over the period are the UI's hitches, and are ignored unless they persist (as when its window moves
+        // to a monitor of a lower refresh rate)
+        const int64_t intervalNs = nowNs - lastNs;
+        int64_t periodNs         = uiFramePeriodNs_.load(std::memory_order_relaxed);
+        const bool isLong        = periodNs && intervalNs > periodNs * 3 / 2;
+        uiLongIntervals_         = isLong ? uiLongIntervals_ + 1 : 0;
+        if (!periodNs || uiLongIntervals_ >= UIRateStalePeriods) {
+            periodNs         = intervalNs;
+            uiLongIntervals_ = 0;
+        } else if (!isLong)
+            periodNs += (intervalNs - periodNs) / 8;
+        uiFramePeriodNs_.store(periodNs, std::memory_order_relaxed);
+    }
+    uiFrameNs_.store(nowNs, std::memory_order_release);
+}
+
+std::optional<int64_t> Runner::getUIRateTargetNs() const
+{
+    const int64_t lastNs   = uiFrameNs_.load(std::memory_order_acquire);
+    const int64_t periodNs = uiFramePeriodNs_.load(std::memory_order_relaxed);
+    const int64_t nowNs    = toNs(frameClock_t::now());
+    if (!lastNs || periodNs <= 0 || nowNs - lastNs > UIRateStalePeriods * periodNs)
+        return std::nullopt;
+
+    // the UI's first predicted frame that we can still finish ahead of, and that our latest frame didn't already
+    const int64_t earliestNs = std::max(nowNs + getUIRateLeadNs(), uiFrameTargetedNs_ + periodNs / 2);
+    int64_t targetNs         = lastNs + periodNs;
+    if (targetNs < earliestNs)
+        targetNs += (earliestNs - targetNs + periodNs - 1) / periodNs * periodNs;
+    return targetNs;
+}
+
+int64_t Runner::getUIRateLeadNs() const
+{
+    const size_t count      = std::min(recentFrameCount_, UIRateRecentFrames);
+    const int64_t longestNs = count ? *std::max_element(recentFrameNs_.begin(), recentFrameNs_.begin() + count) : 0;
+    return longestNs + static_cast<int64_t>(std::max(runRate_.uiLeadMs, 0.0f) * 1e6f);
 }
 
 void Runner::mainLoop(std::stop_token st)
 {
+    FrameTrace::setThreadName("Runner");
     updatePlan();
+    runnerAllocationsSeen_ = AllocationCounter::getThreadCount(); // so that the first frame doesn't count the plan's setup
+    frameDeadline_.reset(); // as left by a previous run
+    lastFrameStart_.reset();
 
+    uint64_t framesRun = 0;
     while (!st.stop_requested()) {
         // start a frame and remember when we started it
-        const auto frameStart          = frameClock_t::now();
+        const auto frameStart = frameClock_t::now();
+        auto nsSince          = [frameStart](frameClock_t::time_point t) -> uint64_t { return toNs(frameStart) - toNs(t); };
+        framePeriodNs_        = lastFrameStart_ ? std::optional(nsSince(*lastFrameStart_)) : std::nullopt;
+        frameLatenessNs_      = frameDeadline_ ? std::optional(nsSince(*frameDeadline_)) : std::nullopt; // never before it
+        lastFrameStart_       = frameStart;
+
         frameCoreTotalExecutionTimeNs_ = 0;
+        frameExecutedCores_            = 0;
+        frameSkippedCores_             = 0;
+        frameLuaGcNs_                  = 0;
 
         executeFrame(st);
+        resetFrameArenas();
 
         const auto t1                = frameClock_t::now();
         std::chrono::nanoseconds dur = t1 - frameStart;
 
+        recentFrameNs_[recentFrameCount_++ % UIRateRecentFrames] = dur.count(); // for UIRate's lead
+
+        collectLuaGarbageAfterFrame(); // timed apart from the runner overhead
+
         // enter next frame wait loop
         do {
             const auto t2 = frameClock_t::now();
@@ -58,21 +123,30 @@ void Runner::mainLoop(std::stop_token st)
         } while (!waitForNextFrame(frameStart));
 
         foldFrameMetrics(frameCoreTotalExecutionTimeNs_, dur.count() - frameCoreTotalExecutionTimeNs_);
+
+        if (frameLimit_ && ++framesRun >= frameLimit_) {
+            finished_.store(true, std::memory_order_release);
+            finished_.notify_all();
+            return;
+        }
     }
 }
 
 bool Runner::waitForNextFrame(frameClock_t::time_point frameStart)
 {
     std::optional<float> fps;
+    std::optional<int64_t> uiFrameTargetNs; // under UIRate
 
     auto waitForeverOrUntilWokenUp = [this]() {
-        std::unique_lock lock(frameWaitMutex_);
-        frameWaitCV_.wait(lock, [this]() { return frameWaitWakeUp_; });
-        frameWaitWakeUp_ = false;
+        collectLuaGarbageUntil(frameClock_t::time_point::max());
+        waitUntilWokenUp();
+        frameDeadline_.reset();
+        lastFrameStart_.reset(); // the wait isn't a frame period
     };
 
     switch (runRate_.rateMode) {
     case RunRateMode::Unlimited:
+        frameDeadline_.reset();
         return true; // no delay, immediately run next frame
 
     case RunRateMode::Disabled: {
@@ -82,11 +156,18 @@ bool Runner::waitForNextFrame(frameClock_t::time_point frameStart)
 
     default:
         assert(false); // unknown rate mode
-        fps = 60.0f;   // we'll handle it like UI Rate in the unlikely case this happens in release
+        fps = 60.0f;   // we'll handle it like a Set Rate of 60 in the unlikely case this happens in release
         break;
 
     case RunRateMode::UIRate:
-        fps = 60.0f; // TODO: a future update will synchronize this more closely with the actual UI frame present timing
+        uiFrameTargetNs = getUIRateTargetNs();
+        if (!uiFrameTargetNs) {
+            // the UI isn't running frames (or hasn't signalled enough yet) - look again shortly, as its signals don't wake us
+            waitUntil(frameClock_t::now() + UIRatePollInterval, false);
+            frameDeadline_.reset();
+            lastFrameStart_.reset();
+            return false;
+        }
         break;
 
     case RunRateMode::SetRate:
@@ -94,33 +175,200 @@ bool Runner::waitForNextFrame(frameClock_t::time_point frameStart)
         break;
     }
 
-    assert(fps); // frame rate should always be set by this point
+    frameClock_t::time_point waitpoint;
+    if (uiFrameTargetNs) {
+        // start so as to finish ahead of the UI frame targeted
+        const std::chrono::nanoseconds startNs(*uiFrameTargetNs - getUIRateLeadNs());
+        waitpoint = frameClock_t::time_point(std::chrono::duration_cast<frameClock_t::duration>(startNs));
+    } else {
+        assert(fps); // frame rate should always be set by this point
 
-    // if the framerate is degenerate (negative, too small, or not finite) wait forever or until woken (to allow setting change)
-    if (!std::isfinite(*fps) || *fps <= 1e-8f) {
-        waitForeverOrUntilWokenUp();
+        // if the framerate is degenerate (negative, too small, or not finite) wait forever or until woken (to allow setting
+        // change)
+        if (!std::isfinite(*fps) || *fps <= 1e-8f) {
+            waitForeverOrUntilWokenUp();
+            return false;
+        }
+
+        // each deadline is a period after the last, rather than after the frame's actual start, so that waking late doesn't
+        // accumulate as drift - though once more than a period behind, the frames missed are dropped rather than rushed
+        const auto period = std::chrono::duration_cast<frameClock_t::duration>(std::chrono::duration<double>(1.0 / *fps));
+        waitpoint         = frameDeadline_.value_or(frameStart) + period;
+        if (const auto now = frameClock_t::now(); now - waitpoint > period)
+            waitpoint = now;
+    }
+
+    // wait for it, unless woken first (e.g. to take a new plan or setting)
+    collectLuaGarbageUntil(waitpoint);
+    waitUntil(waitpoint, true);
+
+    // only signal we're ready for the next frame if we actually passed the waitpoint
+    if (frameClock_t::now() < waitpoint)
         return false;
+    frameDeadline_ = waitpoint;
+    if (uiFrameTargetNs)
+        uiFrameTargetedNs_ = *uiFrameTargetNs;
+    return true;
+}
+
+bool Runner::waitUntil(frameClock_t::time_point deadline, bool precise)
+{
+    FrameTrace::Scope trace("wait");
+
+    // sleep until only the spin is left, learning how late the OS wakes us so as to spin no longer than needed - the spin
+    // follows the oversleep's recent peak, decaying by 1/64 a wait
+    const auto sleepDeadline = precise ? deadline - frameWaitSpin_ : deadline;
+    if (frameClock_t::now() < sleepDeadline) {
+        if (frameWaitSemaphore_.try_acquire_until(sleepDeadline)) {
+            frameWaitWakeUp_.store(false, std::memory_order_release);
+            return true;
+        }
+        if (precise) {
+            const frameClock_t::duration spin = frameClock_t::now() - sleepDeadline + MinFrameWaitSpin;
+            frameWaitSpin_ = std::clamp<frameClock_t::duration>(std::max(frameWaitSpin_ - frameWaitSpin_ / 64, spin),
+                                                                MinFrameWaitSpin, MaxFrameWaitSpin);
+        }
     }
 
-    // otherwise, we do a proper framerate wait
-    auto waitpoint = frameStart + std::chrono::duration_cast<frameClock_t::duration>(std::chrono::duration<float>(1.0f / *fps));
-    {
-        std::unique_lock lock(frameWaitMutex_);
-        frameWaitCV_.wait_until(lock, waitpoint, [this]() { return frameWaitWakeUp_; });
-        frameWaitWakeUp_ = false;
+    // then spin the rest of the way, yielding to any thread that's ready
+    while (frameClock_t::now() < deadline) {
+        if (takeWakeUp())
+            return true;
+        std::this_thread::yield();
     }
+    return false;
+}
 
-    // only signal we're ready for the next frame if we actually passed the waitpoint
-    return frameClock_t::now() >= waitpoint;
+void Runner::waitUntilWokenUp()
+{
+    FrameTrace::Scope trace("wait");
+    frameWaitSemaphore_.acquire();
+    frameWaitWakeUp_.store(false, std::memory_order_release);
+}
+
+bool Runner::takeWakeUp()
+{
+    if (!frameWaitWakeUp_.load(std::memory_order_acquire))
+        return false;
+    frameWaitSemaphore_.acquire(); // released just after the flag was set, if not already
+    frameWaitWakeUp_.store(false, std::memory_order_release);
+    return true;
+}
+
+void Runner::collectLuaGarbageAfterFrame()
+{
+    const auto mode = runRate_.luaGcMode;
+    if (mode == LuaGcMode::Automatic || mode == LuaGcMode::Manual) {
+        for (auto &shard : luaShards_) {
+            shard->env->holdCollector(mode != LuaGcMode::Automatic);
+            shard->env->takeExternalBytes(); // Manual never pays for them, and Automatic steps for them as they're charged
+            shard->gc.leftBytes = shard->env->getHeapBytes();
+        }
+        return;
+    }
+
+    // each shard steps its own state, so with several they step side by side
+    FrameTrace::Scope trace("lua gc");
+    const auto start = frameClock_t::now();
+    runOnLuaShards(&Runner::collectLuaGarbageAfterFrame);
+    std::chrono::nanoseconds dur = frameClock_t::now() - start;
+    frameLuaGcNs_ += dur.count();
+}
+
+void Runner::collectLuaGarbageUntil(frameClock_t::time_point idleUntil)
+{
+    if (runRate_.luaGcMode != LuaGcMode::IdleCollect)
+        return;
+
+    FrameTrace::Scope trace("lua gc");
+    const auto start = frameClock_t::now();
+    luaGcUntil_      = idleUntil;
+    runOnLuaShards(&Runner::collectLuaGarbageUntil);
+    std::chrono::nanoseconds dur = frameClock_t::now() - start;
+    frameLuaGcNs_ += dur.count();
+}
+
+void Runner::collectLuaGarbageAfterFrame(LuaShard &shard)
+{
+    auto &gc = shard.gc;
+    shard.env->holdCollector(true);
+
+    // the collector was held through the frame, so nothing was freed, and LuaJIT would have stepped for all it allocated - as
+    // well as for the bytes charged for images and arrays, which count towards a cycle coming due as the heap's growth does
+    const size_t heapBytes     = shard.env->getHeapBytes();
+    const size_t externalBytes = shard.env->takeExternalBytes();
+    gc.externalBytes += externalBytes;
+    const size_t allocatedBytes = (heapBytes > gc.leftBytes ? heapBytes - gc.leftBytes : 0) + externalBytes;
+    if (gc.cycleOpen || heapBytes + gc.externalBytes >= LuaGcPauseFactor * gc.baseBytes)
+        gc.debtBytes += allocatedBytes;
+
+    // with no idle time to collect in, IdleCollect steps within the budget as FrameStep does
+    if (runRate_.luaGcMode == LuaGcMode::FrameStep || runRate_.rateMode == RunRateMode::Unlimited) {
+        const auto budget = std::chrono::duration<float, std::milli>(std::max(runRate_.luaGcBudgetMs, 0.0f));
+        stepLuaGc(shard, frameClock_t::now() + std::chrono::duration_cast<frameClock_t::duration>(budget), 0);
+    }
+
+    // debt the budget can't keep up with is paid down regardless, so that the heap grows no further than under Automatic
+    const size_t maxDebtBytes = LuaGcMaxDebtFactor * std::max(gc.baseBytes, allocatedBytes);
+    if (gc.debtBytes > maxDebtBytes)
+        stepLuaGc(shard, frameClock_t::time_point::max(), maxDebtBytes);
+    gc.leftBytes = shard.env->getHeapBytes();
+}
+
+void Runner::collectLuaGarbageUntil(LuaShard &shard)
+{
+    // idle time is otherwise wasted, so a cycle is begun sooner than it would be due - though not for nothing, every frame
+    const auto &gc = shard.gc;
+    if (gc.cycleOpen || shard.env->getHeapBytes() + gc.externalBytes > gc.baseBytes + gc.baseBytes / LuaGcIdleDivisor)
+        stepLuaGc(shard, luaGcUntil_, std::nullopt);
+}
+
+void Runner::stepLuaGc(LuaShard &shard, frameClock_t::time_point until, std::optional<size_t> payDownToBytes)
+{
+    auto &gc = shard.gc;
+    for (auto now = frameClock_t::now(); now < until && (!payDownToBytes || gc.debtBytes > *payDownToBytes);) {
+        gc.cycleOpen = !shard.env->stepCollector();
+        now          = frameClock_t::now();
+        gc.debtBytes -= std::min(gc.debtBytes, LuaGcStepBytes);
+        if (!gc.cycleOpen) {
+            gc.baseBytes     = shard.env->getHeapBytes();
+            gc.debtBytes     = 0; // as the next cycle isn't due until the heap grows again
+            gc.externalBytes = 0;
+            break;
+        }
+    }
+    gc.leftBytes = shard.env->getHeapBytes();
+}
+
+void Runner::runOnLuaShards(LuaShardFn fn)
+{
+    if (luaShards_.size() == 1 || !workerPool_.isRunning()) {
+        for (auto &shard : luaShards_)
+            (this->*fn)(*shard);
+        return;
+    }
+
+    luaShardJob_ = fn;
+    workerPool_.beginBatch(&Runner::runLuaShardJob, this, luaShards_.size());
+    workerPool_.finishBatch();
+    luaShardJob_ = nullptr;
+}
+
+void Runner::runLuaShardJob(void *runner, size_t jobIndex, size_t workerSlot)
+{
+    auto *self = static_cast<Runner *>(runner);
+    AllocationCounter::ScopedTally tally(workerSlot ? &self->workerAllocations_ : nullptr); // slot 0 is the runner thread
+    (self->*self->luaShardJob_)(*self->luaShards_[jobIndex]);
 }
 
 void Runner::updatePlan()
 {
-    if (!try_acceptLatestPlan())
+    if (!try_acceptPlans())
         return;
-    assert(currentPlan_); // we'll always have a plan from this point forward
+    assert(planVersion_); // we'll always have a plan from this point forward
+    FrameTrace::Scope trace("plan update");
 
-    if (pendingFutureDelta_ && pendingFutureDelta_->version <= currentPlan_->version) {
+    if (pendingFutureDelta_ && pendingFutureDelta_->version <= *planVersion_) {
         applyDelta(*pendingFutureDelta_);
         pendingFutureDelta_.reset();
     }
@@ -130,7 +378,7 @@ void Runner::updatePlan()
     if (!pendingFutureDelta_) {
         std::unique_ptr<ResourceDelta> delta;
         while (try_dequeueDelta(delta)) {
-            if (delta->version > currentPlan_->version) {
+            if (delta->version > *planVersion_) {
                 pendingFutureDelta_ = std::move(delta);
                 break;
             } else {
@@ -142,98 +390,650 @@ void Runner::updatePlan()
     prepareRunContext();
 }
 
+void Runner::acceptPlan(ExecutionPlan &plan)
+{
+    planVersion_ = plan.version;
+
+    if (!plan.isPatch) {
+        assert(plan.nodeExecutionOrder.size() == plan.nodeLevels.size() && plan.nodeExecutionOrder.size() == plan.nodePins.size());
+        clearSchedule(); // as it points into planNodes_
+        planNodes_.clear();
+        planLinks_.clear();
+        for (size_t i = 0; i < plan.nodeExecutionOrder.size(); i++) {
+            planNodes_.try_emplace(plan.nodeExecutionOrder[i],
+                                   PlanNode{.level = plan.nodeLevels[i], .pins = std::move(plan.nodePins[i])});
+        }
+        for (auto [outputPinId, inputPinId] : plan.valueLinks)
+            planLinks_.try_emplace(inputPinId, outputPinId); // inputs accept at most one link
+        rebuildPending_ = true;
+        return;
+    }
+
+    for (auto nodeId : plan.removedNodes) {
+        auto it = planNodes_.find(nodeId);
+        if (it == planNodes_.end())
+            continue;
+        unscheduleCore(it->second); // as the schedule points to it
+        planNodes_.erase(it);
+    }
+    for (auto &update : plan.updatedNodes) {
+        auto &planNode = planNodes_[update.nodeId];
+        planNode.level = update.level;
+        planNode.pins  = std::move(update.pins);
+        dirtyNodes_.insert(update.nodeId);
+    }
+
+    // the nodes owning these inputs are among those updated, so they are rebound when rescheduled
+    for (auto inputPinId : plan.unlinkedInputs)
+        planLinks_.erase(inputPinId);
+    for (auto [outputPinId, inputPinId] : plan.linkedInputs)
+        planLinks_.insert_or_assign(inputPinId, outputPinId);
+}
+
 void Runner::executeFrame(std::stop_token st)
 {
-    if (!currentPlan_)
+    if (!planVersion_)
         return;
 
-    for (auto nodeId : currentPlan_->nodeExecutionOrder) {
-        runContext_.nodeId = nodeId;
-        auto it            = cores_.find(nodeId);
-        if (it != cores_.end()) {
-            scriptEnv_->setCurrentNode(it->first);
+    FrameTrace::Scope trace("frame");
+    auto &ownContext = luaShards_.front()->context;
+    for (auto &level : levels_) {
+        if (level.empty())
+            continue;
 
-            const auto t1 = frameClock_t::now();
-            it->second->onFrame(runContext_);
-            std::chrono::nanoseconds dur = frameClock_t::now() - t1;
+        // the cores given to each other lua shard run as one job, after the jobs of the level's Any cores
+        uint32_t dispatchedCores = level.luaBegin;
+        dispatchedShards_.clear();
+        for (uint32_t shard = 1; shard < level.shardCores.size(); shard++) {
+            if (level.shardCores[shard].empty())
+                continue;
+            dispatchedShards_.push_back(shard);
+            dispatchedCores += static_cast<uint32_t>(level.shardCores[shard].size());
+        }
+
+        const bool dispatch = workerPool_.isRunning() && (level.luaBegin >= MinDispatchedCores || !dispatchedShards_.empty());
+        assert(dispatch || dispatchedShards_.empty()); // the pool is started by the first core given to a shard
+        const auto levelStart = frameClock_t::now();
+        uint64_t levelCoreNs  = 0;
+
+        auto runHere = [&](ScheduledCore &entry) {
+            if (!mustRun(entry)) {
+                frameSkippedCores_++;
+                return;
+            }
+            bindSlots(entry, ownContext);
+            levelCoreNs += runCore(*entry.core, ownContext);
+            frameExecutedCores_++;
+        };
+
+        if (dispatch) {
+            dispatchedLevel_ = &level;
+            dispatchedSkips_.store(0, std::memory_order_relaxed);
+            workerPool_.beginBatch(&Runner::runDispatchedCore, this, level.luaBegin + dispatchedShards_.size());
+        } else {
+            for (uint32_t i = 0; i < level.luaBegin; i++)
+                runHere(level.cores[i]);
+        }
 
-            uint64_t durNs = dur.count();
-            frameCoreTotalExecutionTimeNs_ += durNs;
-            auto fetchResult = it->second->internalChannel_->frameMetrics.fetchFoldBucket();
-            fetchResult.bucket.fold(durNs, fetchResult.isNew);
+        for (uint32_t i = level.luaBegin; i < level.cores.size(); i++) {
+            runHere(level.cores[i]);
+            if (st.stop_requested())
+                break;
         }
+
+        if (dispatch) {
+            workerPool_.finishBatch();
+            dispatchedLevel_ = nullptr;
+
+            const uint32_t skipped = dispatchedSkips_.load(std::memory_order_relaxed);
+            frameSkippedCores_ += skipped;
+            frameExecutedCores_ += dispatchedCores - skipped;
+
+            // per-core durations overlap in time here, so core execution is accounted as the level's wall time instead
+            std::chrono::nanoseconds levelDur = frameClock_t::now() - levelStart;
+            levelCoreNs                       = levelDur.count();
+        }
+
+        frameCoreTotalExecutionTimeNs_ += levelCoreNs;
+
         if (st.stop_requested())
             return;
     }
 }
 
+uint64_t Runner::runCore(NodeCore &core, const NodeCore::RunContext &context)
+{
+    FrameTrace::Scope trace("core", context.nodeId);
+    const uint64_t allocations = AllocationCounter::getThreadCount();
+    PerfCounters::Scope counters; // outside the timing, as reading the counters is a syscall
+    const auto t1 = frameClock_t::now();
+    core.onFrame(context);
+    std::chrono::nanoseconds dur = frameClock_t::now() - t1;
+    PerfCounters::Sample counted;
+    const bool isCounted = counters.stop(counted);
+
+    uint64_t durNs   = dur.count();
+    auto fetchResult = core.internalChannel_->frameMetrics.fetchFoldBucket();
+    fetchResult.bucket.fold(durNs, fetchResult.isNew);
+
+    if constexpr (AllocationCounter::Enabled) {
+        auto allocationsResult = core.internalChannel_->frameAllocations.fetchFoldBucket();
+        allocationsResult.bucket.fold(AllocationCounter::getThreadCount() - allocations, allocationsResult.isNew);
+    }
+    if (isCounted) {
+        auto countersResult = core.internalChannel_->framePerfCounters.fetchFoldBucket();
+        countersResult.bucket.fold(counted, countersResult.isNew);
+    }
+    return durNs;
+}
+
+void Runner::runDispatchedCore(void *runner, size_t jobIndex, size_t workerSlot)
+{
+    auto *self  = static_cast<Runner *>(runner);
+    auto &level = *self->dispatchedLevel_;
+    AllocationCounter::ScopedTally tally(workerSlot ? &self->workerAllocations_ : nullptr); // slot 0 is the runner thread
+
+    if (jobIndex >= level.luaBegin) {
+        const uint32_t shard = self->dispatchedShards_[jobIndex - level.luaBegin];
+        if (uint32_t skipped = self->runLuaShardCores(level.shardCores[shard], self->luaShards_[shard]->context))
+            self->dispatchedSkips_.fetch_add(skipped, std::memory_order_relaxed);
+        return;
+    }
+
+    auto &entry   = level.cores[jobIndex];
+    auto &context = self->workerContexts_[workerSlot];
+    if (!self->mustRun(entry)) {
+        self->dispatchedSkips_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    self->bindSlots(entry, context);
+    self->runCore(*entry.core, context);
+}
+
+uint32_t Runner::runLuaShardCores(std::vector<ScheduledCore> &cores, NodeCore::RunContext &context)
+{
+    uint32_t skipped = 0;
+    for (auto &entry : cores) {
+        if (!mustRun(entry)) {
+            skipped++;
+            continue;
+        }
+        bindSlots(entry, context);
+        runCore(*entry.core, context);
+    }
+    return skipped;
+}
+
+bool Runner::mustRun(ScheduledCore &entry)
+{
+    if (runRate_.executionMode != ExecutionMode::SkipUnchanged)
+        return true;
+
+    // every core's inputs are tracked, not only those of pure cores, as a core may become pure at any time (e.g. a Script)
+    bool changed = entry.stale;
+    entry.stale  = false;
+    for (uint32_t i = entry.inputBegin, end = entry.inputBegin + entry.inputCount; i < end; i++) {
+        const auto *input         = inputSlots_[i];
+        const uint64_t generation = input ? input->getGeneration() : 0;
+        changed |= generation != inputGenerations_[i];
+        inputGenerations_[i] = generation;
+    }
+    return changed || !entry.core->isPure() || entry.core->hasPendingChanges();
+}
+
+void Runner::markAllStale()
+{
+    for (auto &level : levels_) {
+        for (auto &entry : level.cores)
+            entry.stale = true;
+        for (auto &cores : level.shardCores)
+            for (auto &entry : cores)
+                entry.stale = true;
+    }
+}
+
 void Runner::applyDelta(ResourceDelta &delta)
 {
+    FrameTrace::Scope trace("delta");
+
+    // cores are only ever scheduled or unscheduled by the next compile, so until then the schedule may still point to a
+    // deleted core - which is harmless, as no frame runs in between
     for (auto deletedCoreNodeId : delta.deletedCores) {
-        scriptEnv_->forgetNode(deletedCoreNodeId);
         cores_.erase(deletedCoreNodeId);
+        dirtyNodes_.insert(deletedCoreNodeId);
     }
 
-    for (auto deletedOutputPinId : delta.deletedOutputs)
-        outputPinBuffers_.erase(deletedOutputPinId);
+    for (auto deletedOutputPinId : delta.deletedOutputs) {
+        auto it = outputPinSlots_.find(deletedOutputPinId);
+        if (it == outputPinSlots_.end())
+            continue;
+        outputBuffers_.release(it->second);
+        outputPinSlots_.erase(it);
+    }
 
     if (delta.luaEnvInitScript) {
         clearOutputBuffers();
-        scriptEnv_->resetWithInitScript(*delta.luaEnvInitScript);
-        initScriptResult_.postNew(std::make_unique<std::string>(scriptEnv_->getInitScriptResult()));
+        resetLuaShards(*delta.luaEnvInitScript, std::clamp(delta.luaStateCount, 1u, MaxLuaStates));
+        initScriptResult_.postNew(std::make_unique<std::string>(luaShards_.front()->env->getInitScriptResult()));
         raiseLuaStateReset();
     }
 
     for (auto addedOutputPinId : delta.addedOutputs) {
-        auto [it, inserted] = outputPinBuffers_.try_emplace(addedOutputPinId, std::make_unique<ValueBuffer>(scriptEnv_->L));
+        auto [it, inserted] = outputPinSlots_.try_emplace(addedOutputPinId, outputBuffers_.acquire());
         assert(inserted);
     }
 
     for (auto &[addedCoreNodeId, core] : delta.addedCores) {
         auto [it, inserted] = cores_.try_emplace(addedCoreNodeId, std::move(core));
         assert(inserted);
+        dirtyNodes_.insert(addedCoreNodeId);
     }
 }
 
 void Runner::prepareRunContext()
 {
-    runContext_.nodeId = 0;
+    for (auto &shard : luaShards_)
+        shard->context.nodeId = 0;
+    assignLuaShards(); // first, as cores it moves to other shards must be rescheduled
+
+    // a patch touching a large part of the graph is better served by a full rebuild, as is a schedule whose slot arrays have
+    // become mostly unused - and rebuilding is also what lays the output buffers out in execution order again
+    const bool rebuild = rebuildPending_ || dirtyNodes_.size() * PatchLimitDivisor > planNodes_.size() ||
+                         unusedSlots_ * 2 > inputPins_.size() + outputPins_.size();
+    if (rebuild)
+        rebuildRunContext();
+    else
+        patchRunContext();
+
+    rebuildPending_ = false;
+    dirtyNodes_.clear();
+}
+
+void Runner::rebuildRunContext()
+{
+    clearSchedule();
+
+    // cores are scheduled by level, those that may run on any thread ahead of those pinned to ours, then by node id - so that
+    // the slot arrays are laid out in execution order, and runs of the same graph execute identically
+    struct Entry {
+        uint64_t key;
+        NodeId nodeId;
+        PlanNode *planNode;
+        NodeCore *core;
+    };
+    std::vector<Entry> entries;
+    entries.reserve(planNodes_.size());
+    for (auto &[nodeId, planNode] : planNodes_) {
+        planNode.scheduled = {};
+        auto it            = cores_.find(nodeId);
+        if (it == cores_.end())
+            continue;
+        const bool pinned = it->second->getAffinity() != CoreAffinity::Any;
+        entries.push_back(Entry{.key      = (static_cast<uint64_t>(planNode.level) << 1) | (pinned ? 1 : 0),
+                                .nodeId   = nodeId,
+                                .planNode = &planNode,
+                                .core     = it->second.get()});
+    }
+    std::ranges::sort(entries, {}, [](const Entry &e) { return std::pair(e.key, e.nodeId); });
+
+    // the buffers are laid out in the same order first, as that moves them
+    arrangedPins_.clear();
+    for (const auto &entry : entries)
+        arrangedPins_.insert(arrangedPins_.end(), entry.planNode->pins.outputs.begin(), entry.planNode->pins.outputs.end());
+    arrangeOutputBuffers();
+
+    for (const auto &entry : entries)
+        scheduleCore(entry.nodeId, *entry.planNode, *entry.core);
+
+    while (!levels_.empty() && levels_.back().empty())
+        levels_.pop_back();
+}
+
+void Runner::patchRunContext()
+{
+    for (auto nodeId : dirtyNodes_) {
+        auto planIt = planNodes_.find(nodeId);
+        if (planIt == planNodes_.end())
+            continue; // removed, and so already unscheduled
+
+        unscheduleCore(planIt->second);
+        if (auto coreIt = cores_.find(nodeId); coreIt != cores_.end())
+            scheduleCore(nodeId, planIt->second, *coreIt->second);
+    }
+
+    while (!levels_.empty() && levels_.back().empty())
+        levels_.pop_back();
+}
+
+void Runner::arrangeOutputBuffers()
+{
+    // list every live output buffer: those listed in arrangedPins_ by the caller, in that order, then any others (e.g. outputs
+    // added by a delta whose plan we've not yet adopted) in no particular order
+    arrangedSlots_.clear();
+    arrangedMarks_.assign(outputBuffers_.getCapacity(), 0);
+
+    size_t listed = 0;
+    for (auto pinId : arrangedPins_) {
+        auto it = outputPinSlots_.find(pinId);
+        if (it == outputPinSlots_.end())
+            continue;
+        arrangedPins_[listed++] = pinId;
+        arrangedSlots_.push_back(it->second);
+        arrangedMarks_[it->second] = 1;
+    }
+    arrangedPins_.resize(listed);
+
+    if (arrangedSlots_.size() < outputPinSlots_.size()) {
+        for (auto &[pinId, slot] : outputPinSlots_) {
+            if (arrangedMarks_[slot])
+                continue;
+            arrangedPins_.push_back(pinId);
+            arrangedSlots_.push_back(slot);
+        }
+    }
+
+    if (ValueBufferArena::isInOrder(arrangedSlots_))
+        return; // the common case for plans that only change links
+
+    outputBuffers_.arrangeInOrder(arrangedSlots_);
+    for (size_t i = 0; i < arrangedPins_.size(); i++)
+        outputPinSlots_[arrangedPins_[i]] = static_cast<ValueBufferArena::Slot>(i);
+}
+
+void Runner::clearSchedule()
+{
+    for (auto &level : levels_) {
+        level.cores.clear(); // keeping its capacity, as levels are mostly refilled alike
+        level.luaBegin = 0;
+        for (auto &cores : level.shardCores)
+            cores.clear();
+    }
+    inputPins_.clear();
+    outputPins_.clear();
+    inputSlots_.clear();
+    outputSlots_.clear();
+    inputGenerations_.clear();
+    unusedSlots_ = 0;
+}
+
+void Runner::scheduleCore(NodeId nodeId, PlanNode &planNode, NodeCore &core)
+{
+    const auto &pins = planNode.pins;
+    ScheduledCore entry{.nodeId      = nodeId,
+                        .core        = &core,
+                        .planNode    = &planNode,
+                        .inputBegin  = static_cast<uint32_t>(inputPins_.size()),
+                        .inputCount  = static_cast<uint32_t>(pins.inputs.size()),
+                        .outputBegin = static_cast<uint32_t>(outputPins_.size()),
+                        .outputCount = static_cast<uint32_t>(pins.outputs.size())};
+
+    for (auto pinId : pins.inputs) {
+        inputPins_.push_back(pinId);
+        inputSlots_.push_back(resolveInput(pinId));
+    }
+    inputGenerations_.resize(inputPins_.size()); // never compared before the core first runs, as it's stale until then
+
+    if (planNode.level >= levels_.size())
+        levels_.resize(planNode.level + 1);
+    auto &level = levels_[planNode.level];
+
+    // as given by assignLuaShards(), which a core without one (there being a single shard) keeps to ours
+    const auto affinity  = core.getAffinity();
+    const uint32_t shard = affinity == CoreAffinity::AnyLuaState ? core.luaShard_.value_or(0) : 0;
+    assert(shard < luaShards_.size());
+
+    // its outputs belong to the state it writes them in (and a buffer only ever has one writer, so it only moves with it)
+    for (auto pinId : pins.outputs) {
+        auto *output = resolveOutput(pinId);
+        if (output)
+            output->moveToLuaState(luaShards_[shard]->env->L);
+        outputPins_.push_back(pinId);
+        outputSlots_.push_back(output);
+    }
+
+    if (shard) {
+        level.shardCores.resize(luaShards_.size());
+        auto &cores        = level.shardCores[shard];
+        planNode.scheduled = {.level = planNode.level, .index = static_cast<uint32_t>(cores.size()), .luaShard = shard};
+        cores.push_back(entry);
+        if (!workerPool_.isRunning())
+            startWorkers();
+        return;
+    }
+
+    ScheduledLocation location{.level = planNode.level, .index = static_cast<uint32_t>(level.cores.size())};
+    level.cores.push_back(entry);
+
+    if (affinity == CoreAffinity::Any) {
+        // the level's first pinned core, if any, makes way by moving to the end
+        if (location.index != level.luaBegin) {
+            std::swap(level.cores[location.index], level.cores[level.luaBegin]);
+            level.cores[location.index].planNode->scheduled.index = location.index;
+            location.index                                        = level.luaBegin;
+        }
+        if (++level.luaBegin >= MinDispatchedCores && !workerPool_.isRunning())
+            startWorkers();
+    }
+
+    planNode.scheduled = location;
+}
+
+void Runner::unscheduleCore(PlanNode &planNode)
+{
+    const auto location = planNode.scheduled;
+    if (location.level == ScheduledLocation::Unscheduled)
+        return;
+    planNode.scheduled = {};
+
+    auto &level = levels_[location.level];
+    if (location.luaShard) {
+        auto &cores       = level.shardCores[location.luaShard];
+        const auto &entry = cores[location.index];
+        unusedSlots_ += entry.inputCount + entry.outputCount;
+        if (location.index != cores.size() - 1) {
+            cores[location.index]                           = cores.back();
+            cores[location.index].planNode->scheduled.index = location.index;
+        }
+        cores.pop_back();
+        return;
+    }
+
+    const auto &entry = level.cores[location.index];
+    unusedSlots_ += entry.inputCount + entry.outputCount;
+
+    // close the gap from the end of the core's own group, then the gap that leaves from the end of the level, so that cores
+    // which may run on any thread stay ahead of those pinned to ours
+    auto move = [&](uint32_t from, uint32_t to) {
+        level.cores[to]                           = level.cores[from];
+        level.cores[to].planNode->scheduled.index = to;
+    };
+    uint32_t gap = location.index;
+    if (gap < level.luaBegin) {
+        if (gap != --level.luaBegin)
+            move(level.luaBegin, gap);
+        gap = level.luaBegin;
+    }
+    const auto last = static_cast<uint32_t>(level.cores.size() - 1);
+    if (gap != last)
+        move(last, gap);
+    level.cores.pop_back();
+}
+
+void Runner::assignLuaShards()
+{
+    // cores linked to one another - directly, or through cores forwarding their values, as a Switch does - may pass tables and
+    // functions, which can't cross between lua states, so each such group shares one.  The groups are found afresh (by
+    // union-find over the links between their cores) as each plan is adopted, since any patch may join or split them.
+    if (luaShards_.size() < 2)
+        return;
 
-    // TODO: in the future we could probably do this with less memory churn, but because run contexts are only prepared after
-    // topology edits, rather than every frame, this is acceptable for now
+    struct Member {
+        NodeId nodeId;
+        NodeCore *core;
+        const PlanNode *planNode;
+        uint32_t parent = 0;
+    };
+    std::vector<Member> members;
+    const auto shardCount = static_cast<uint32_t>(luaShards_.size());
+    std::vector<size_t> load(shardCount); // cores per shard - ours also runs those pinned to our thread
+    for (const auto &[nodeId, planNode] : planNodes_) {
+        auto it = cores_.find(nodeId);
+        if (it == cores_.end())
+            continue;
+        auto *core = it->second.get();
+        if (core->getAffinity() == CoreAffinity::AnyLuaState || core->forwardsLuaValues())
+            members.push_back({.nodeId = nodeId, .core = core, .planNode = &planNode});
+        else if (core->getAffinity() == CoreAffinity::LuaThread)
+            load[0]++;
+    }
+    std::ranges::sort(members, {}, &Member::nodeId); // so that runs of the same graph are given the same shards
+
+    std::unordered_map<PinId, uint32_t> writers; // output pin -> the member writing it
+    for (uint32_t i = 0; i < members.size(); i++) {
+        members[i].parent = i;
+        for (auto pinId : members[i].planNode->pins.outputs)
+            writers.try_emplace(pinId, i);
+    }
+    auto find = [&](uint32_t i) {
+        while (members[i].parent != i)
+            i = members[i].parent = members[members[i].parent].parent;
+        return i;
+    };
+    for (uint32_t i = 0; i < members.size(); i++) {
+        for (auto pinId : members[i].planNode->pins.inputs) {
+            auto linkIt = planLinks_.find(pinId);
+            if (linkIt == planLinks_.end())
+                continue;
+            auto writerIt = writers.find(linkIt->second);
+            if (writerIt == writers.end())
+                continue;
+            const auto a = find(i), b = find(writerIt->second);
+            members[std::max(a, b)].parent = std::min(a, b); // so each group's root is its lowest node id
+        }
+    }
 
-    runContext_.inputs.clear();
-    runContext_.outputs.clear();
-    inputsBackingVectors_.clear();
+    // a group forwarding values is kept to ours, where the cores doing so run, and any other keeps the shard most of its cores
+    // already have, so that only those joined to it from another move
+    struct Group {
+        uint32_t size = 0;
+        bool pinned   = false;
+        std::optional<uint32_t> shard{};
+    };
+    std::vector<Group> groups(members.size());                   // indexed by root
+    std::vector<uint32_t> votes(members.size() * shardCount, 0); // likewise, then by shard
+    for (uint32_t i = 0; i < members.size(); i++) {
+        const auto root = find(i);
+        auto &group     = groups[root];
+        group.size++;
+        if (members[i].core->getAffinity() != CoreAffinity::AnyLuaState)
+            group.pinned = true;
+        else if (auto shard = members[i].core->luaShard_; shard && *shard < shardCount)
+            votes[root * shardCount + *shard]++;
+    }
+    std::vector<uint32_t> unassigned;
+    for (uint32_t root = 0; root < members.size(); root++) {
+        if (find(root) != root)
+            continue;
+        auto &group = groups[root];
+        auto begin  = votes.begin() + root * shardCount;
+        auto best   = std::max_element(begin, begin + shardCount);
+        if (group.pinned)
+            group.shard = 0;
+        else if (*best)
+            group.shard = static_cast<uint32_t>(best - begin);
+        if (group.shard)
+            load[*group.shard] += group.size;
+        else
+            unassigned.push_back(root);
+    }
 
-    for (auto [outputPinId, inputPinId] : currentPlan_->valueLinks) {
-        auto it = inputsBackingVectors_.find(inputPinId);
-        if (it == inputsBackingVectors_.end()) {
-            it = inputsBackingVectors_.try_emplace(inputPinId, std::vector<const ValueBuffer *>()).first;
+    // new groups spread out, the largest first, each to the shard given the fewest cores so far
+    std::ranges::stable_sort(unassigned, std::greater{}, [&](uint32_t root) { return groups[root].size; });
+    for (auto root : unassigned) {
+        const auto shard   = static_cast<uint32_t>(std::ranges::min_element(load) - load.begin());
+        groups[root].shard = shard;
+        load[shard] += groups[root].size;
+    }
+
+    for (uint32_t i = 0; i < members.size(); i++) {
+        auto &core = *members[i].core;
+        if (core.getAffinity() != CoreAffinity::AnyLuaState)
+            continue;
+        const auto shard = *groups[find(i)].shard;
+        if (core.luaShard_ == shard)
+            continue;
+        if (core.luaShard_) {
+            core.onLuaStateMoved(); // between frames, so the state it leaves isn't running
+            dirtyNodes_.insert(members[i].nodeId);
         }
-        it->second.push_back(outputPinBuffers_.at(outputPinId).get());
+        core.luaShard_ = shard;
     }
+}
+
+void Runner::startWorkers()
+{
+    // the pool is started on first need and then kept for the life of the runner
+    auto hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    workerPool_.start(std::clamp(hardwareThreads - 1, 1u, 15u));
+    workerContexts_.resize(workerPool_.getWorkerCount() + 1); // default contexts carry no lua state or env
+    for (auto &context : workerContexts_)
+        context.arena = workerArenas_.emplace_back(std::make_unique<FrameArena>()).get();
+}
 
-    for (auto &[inputPinId, backingVector] : inputsBackingVectors_)
-        runContext_.inputs.try_emplace(inputPinId, std::span(backingVector));
+const ValueBuffer *Runner::resolveInput(PinId inputPinId)
+{
+    auto linkIt = planLinks_.find(inputPinId);
+    return linkIt != planLinks_.end() ? resolveOutput(linkIt->second) : nullptr;
+}
 
-    for (auto &[outputPinId, valueBuffer] : outputPinBuffers_)
-        runContext_.outputs.try_emplace(outputPinId, valueBuffer.get());
+ValueBuffer *Runner::resolveOutput(PinId outputPinId)
+{
+    auto slotIt = outputPinSlots_.find(outputPinId);
+    return slotIt != outputPinSlots_.end() ? &outputBuffers_[slotIt->second] : nullptr;
 }
 
 void Runner::clearOutputBuffers()
 {
-    for (auto &[outputPinId, valueBuffer] : outputPinBuffers_)
-        valueBuffer->clear();
+    outputBuffers_.forEachLive([](ValueBuffer &buf) { buf.clear(); });
+}
+
+void Runner::resetLuaShards(const std::string &initScript, uint32_t count)
+{
+    luaShards_.resize(std::min<size_t>(luaShards_.size(), count)); // the buffers no longer hold refs to those dropped
+    for (auto &shard : luaShards_) {
+        shard->env->resetWithInitScript(initScript);
+        restartLuaGcPacing(*shard);
+    }
+    while (luaShards_.size() < count) {
+        addLuaShard();
+        luaShards_.back()->env->resetWithInitScript(initScript);
+        restartLuaGcPacing(*luaShards_.back());
+    }
+}
+
+void Runner::addLuaShard()
+{
+    if (imagePools_.size() < luaShards_.size() + 1)
+        imagePools_.push_back(std::make_unique<ImagePool>());
+    auto &shard = *luaShards_.emplace_back(std::make_unique<LuaShard>());
+    shard.env.emplace(shard.context, imagePools_[luaShards_.size() - 1].get());
+    shard.context.compiler = &scriptCompiler_;
+    shard.context.arena    = &shard.arena;
+    restartLuaGcPacing(shard);
 }
 
 void Runner::raiseLuaStateReset()
 {
-    for (auto &[outputPinId, valueBuffer] : outputPinBuffers_)
-        valueBuffer->onNewLuaState(scriptEnv_->L); // doing this here is another consequence of TD1 (see TechDebt.md)
+    // doing this here is another consequence of TD1 (see TechDebt.md) - the buffers of cores given other shards move to
+    // them again as the schedule is rebuilt, which it must be, as the shards are given out afresh
+    outputBuffers_.onNewLuaState(luaShards_.front()->env->L);
+    rebuildPending_ = true;
 
-    for (auto &[nodeId, core] : cores_)
+    for (auto &[nodeId, core] : cores_) {
+        core->luaShard_.reset();
         core->onLuaStateReset();
+    }
+    markAllStale(); // every buffer was cleared, so even pure cores with unchanged inputs must write theirs again
 }
 
 } // namespace Mirael
\ No newline at end of file
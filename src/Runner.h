@@ -1,20 +1,29 @@
 #pragma once
 
+#include <array>
 #include <atomic>
 #include <chrono>
-#include <condition_variable>
 #include <memory>
+#include <semaphore>
+#include <span>
 #include <thread>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "readerwriterqueue.h"
 
+#include "AllocationCounter.h"
 #include "data.h"
+#include "ImagePool.h"
 #include "Mailbox.h"
 #include "NodeCore.h"
+#include "ScriptCompiler.h"
 #include "ScriptEnv.h"
+#include "TopoOrder.h"
 #include "ValueBuffer.h"
+#include "ValueBufferArena.h"
+#include "WorkerPool.h"
 
 namespace Mirael
 {
@@ -29,22 +38,70 @@ struct ResourceDelta {
     std::vector<PinId> addedOutputs;
     std::optional<std::string>
         luaEnvInitScript; // if present, all output buffers will be cleared and the lua-state recreated with this init script
+    uint32_t luaStateCount = 1; // with luaEnvInitScript, how many lua states to recreate it in, which script cores are spread over
 };
 
+// A full plan lists the whole graph.  A patch (isPatch) instead lists only what changed since the plan posted just before it,
+// leaving the full plan's lists empty, so that the Runner can follow small edits of large graphs without O(graph) work.
 struct ExecutionPlan {
     PlanVersion version;
+    bool isPatch = false;
+
+    // full plan
     std::vector<NodeId> nodeExecutionOrder;
+    std::vector<uint32_t> nodeLevels; // parallel to nodeExecutionOrder - a node only depends on nodes of strictly lower level
+    using NodePins = Mirael::NodePins;
+    std::vector<NodePins> nodePins; // parallel to nodeExecutionOrder
     struct Link {
         PinId output, input;
     };
     std::vector<Link> valueLinks; // only includes links that tie an input to an output - excludes node-internal sublinks
+
+    // fills the full plan's order, levels and pins from an order without cycles, taking each node's pins from
+    // getPins(NodeId, NodePins &) - as both the Graph and a headless graph build their full plans
+    template <typename GetPins> void setOrder(const TopoOrder &order, GetPins &&getPins)
+    {
+        nodeExecutionOrder.reserve(order.getNodeCount());
+        nodeLevels.reserve(order.getNodeCount());
+        order.forEachInOrder([this](NodeId nodeId, uint32_t level) {
+            nodeExecutionOrder.push_back(nodeId);
+            nodeLevels.push_back(level);
+        });
+
+        nodePins.reserve(nodeExecutionOrder.size());
+        for (auto nodeId : nodeExecutionOrder)
+            getPins(nodeId, nodePins.emplace_back());
+    }
+
+    // patch
+    struct NodeUpdate {
+        NodeId nodeId;
+        uint32_t level;
+        NodePins pins;
+    };
+    std::vector<NodeId> removedNodes;
+    std::vector<NodeUpdate> updatedNodes; // nodes added, or whose level, pins or links changed - each with its current state
+    std::vector<PinId> unlinkedInputs;    // inputs whose link was removed, or which were themselves removed
+    std::vector<Link> linkedInputs;       // inputs newly linked, or relinked to a different output
 };
 
 enum class RunRateMode { Disabled = 0, SetRate = 1, UIRate = 2, Unlimited = 3 };
 
+// SkipUnchanged skips each pure core (see NodeCore::isPure()) whose inputs are unchanged since it last ran
+enum class ExecutionMode { RunAll = 0, SkipUnchanged = 1 };
+
+// Automatic leaves the lua collector to run whenever allocation trips it, which is mid-frame.  The others stop it, and the
+// Runner instead steps it for up to a budget after each frame (FrameStep), or while waiting for the next frame (IdleCollect),
+// or never, leaving scripts to call collectgarbage() (Manual) - see doc/GraphExecution.md
+enum class LuaGcMode { Automatic = 0, FrameStep = 1, IdleCollect = 2, Manual = 3 };
+
 struct RunRateSetting {
     RunRateMode rateMode;
     float desiredFramesPerSecond;
+    ExecutionMode executionMode = ExecutionMode::RunAll;
+    LuaGcMode luaGcMode         = LuaGcMode::Automatic;
+    float luaGcBudgetMs         = 1.0f; // per frame, of stepping under FrameStep (or IdleCollect, when there's no idle time)
+    float uiLeadMs              = 1.0f; // under UIRate, the margin by which each frame aims to finish ahead of the UI's next
 };
 
 class Runner
@@ -59,6 +116,8 @@ public:
     Runner(Runner &&)                 = delete;
     Runner &operator=(Runner &&)      = delete;
 
+    static constexpr uint32_t MaxLuaStates = 16; // as a ResourceDelta may ask for
+
     // Graph API
     void run(RunRateSetting runRate)
     {
@@ -67,7 +126,8 @@ public:
             return;
         }
         runRate_ = runRate;
-        thread_  = std::jthread([this](std::stop_token st) { mainLoop(st); });
+        finished_.store(false, std::memory_order_relaxed);
+        thread_ = std::jthread([this](std::stop_token st) { mainLoop(st); });
     }
     void stop()
     {
@@ -82,51 +142,101 @@ public:
         pendingRunRate_.postNew(std::make_unique<RunRateSetting>(newSetting));
         wakeFromFrameWait();
     }
-    void onNewUIFrame();
+    void onNewUIFrame(); // called by the UI thread as it starts each frame, to pace UIRate - lock-free
     void queueDelta(std::unique_ptr<ResourceDelta> delta) { deltaQueue_.enqueue(std::move(delta)); }
     void postPlan(std::unique_ptr<ExecutionPlan> newPlan)
     {
-        pendingPlan_.postNew(std::move(newPlan));
+        planQueue_.enqueue(std::move(newPlan));
         wakeFromFrameWait();
     }
     std::unique_ptr<std::string> tryAcceptInitScriptResult() { return initScriptResult_.tryAcceptLatest(); }
+    ScriptCompiler &getScriptCompiler() { return scriptCompiler_; } // thread-safe, for its bytecode cache
 
     struct RunnerMetricsBuckets {
-        FrameMetricsBucket coreExecution;
-        FrameMetricsBucket runnerOverhead;
+        FrameHistogramBucket coreExecution;
+        FrameHistogramBucket runnerOverhead;
+        FrameStatsBucket executedCores, skippedCores;                            // counts per frame
+        FrameStatsBucket imagePoolHits, imagePoolMisses, imagePoolResidentBytes; // likewise counts (or bytes) per frame
+        FrameHistogramBucket luaGc;    // spent stepping the lua collector, after the frame or while waiting for the next
+        FrameStatsBucket luaHeapBytes; // bytes per frame, over every lua state as the frame ended
+        FrameStatsBucket allocations;  // heap allocations per frame, over every thread (0 unless AllocationCounter::Enabled)
+        FrameHistogramBucket framePeriod;   // between the starts of consecutive frames - the rate achieved, and its jitter
+        FrameHistogramBucket frameLateness; // of each paced frame's start, after its deadline (none at an Unlimited rate)
     };
     const RunnerMetricsBuckets &getMetricsBuckets() const { return metrics_.getReadBucket(); }
     bool releaseMetricsBuckets() { return metrics_.releaseReadBucket(); }
 
+    // Headless API - used by the bench harness to run an exact number of frames
+    void setFrameLimit(uint64_t frameLimit) { frameLimit_ = frameLimit; }                // 0 for no limit - only set while not running
+    void waitUntilFinished() const { finished_.wait(false, std::memory_order_acquire); } // returns once the limit is reached
+    bool flushMetricsBuckets() { return metrics_.flushFoldBucket(); }                    // only while not running
+    void adoptPendingPlans() { updatePlan(); }                                           // only while not running
+    void waitUntilScriptsCompiled() { scriptCompiler_.waitUntilIdle(); }                 // once every script submitted has compiled
+
 private:
     // Graph API communications channels/buffer
     moodycamel::ReaderWriterQueue<std::unique_ptr<ResourceDelta>> deltaQueue_{}; // incoming
     std::unique_ptr<ResourceDelta> pendingFutureDelta_{}; // used to store up to 1 dequeued delta for a future plan version
-    Mailbox<ExecutionPlan> pendingPlan_{};                // incoming
-    std::unique_ptr<ExecutionPlan> currentPlan_{};
+    moodycamel::ReaderWriterQueue<std::unique_ptr<ExecutionPlan>> planQueue_{}; // incoming - lossless, as patches build on each other
     Mailbox<std::string> initScriptResult_{};     // outgoing
     BucketCycle<RunnerMetricsBuckets> metrics_{}; // outgoing
-    uint64_t frameCoreTotalExecutionTimeNs_ = 0;
+    uint64_t frameCoreTotalExecutionTimeNs_  = 0;
+    uint32_t frameExecutedCores_             = 0;
+    uint32_t frameSkippedCores_              = 0;
+    uint64_t frameLuaGcNs_                   = 0;
+    uint64_t frameLimit_                     = 0;
+    std::atomic<bool> finished_              = false; // outgoing, set once frameLimit_ frames have run
+    uint64_t runnerAllocationsSeen_          = 0;     // the runner thread's AllocationCounter count, as of the last fold
+    std::atomic<uint64_t> workerAllocations_ = 0;     // the worker jobs' allocations since the last fold
 
     // metrics handling
     void foldFrameMetrics(uint64_t coreExecutionTotalNs, uint64_t runnerOverheadNs)
     {
+        ImagePool::FrameStats imagePoolStats{};
+        for (auto &pool : imagePools_)
+            pool->endFrame(imagePoolStats);
+
         auto result = metrics_.fetchFoldBucket();
         result.bucket.coreExecution.fold(coreExecutionTotalNs, result.isNew);
         result.bucket.runnerOverhead.fold(runnerOverheadNs, result.isNew);
+        result.bucket.executedCores.fold(frameExecutedCores_, result.isNew);
+        result.bucket.skippedCores.fold(frameSkippedCores_, result.isNew);
+        result.bucket.imagePoolHits.fold(imagePoolStats.hits, result.isNew);
+        result.bucket.imagePoolMisses.fold(imagePoolStats.misses, result.isNew);
+        result.bucket.imagePoolResidentBytes.fold(imagePoolStats.residentBytes, result.isNew);
+        result.bucket.luaGc.fold(frameLuaGcNs_, result.isNew);
+        result.bucket.luaHeapBytes.fold(getLuaHeapBytes(), result.isNew);
+
+        // whatever the runner thread allocated since the last fold counts, as well as what its jobs allocated on the workers
+        const uint64_t runnerAllocations = AllocationCounter::getThreadCount();
+        const uint64_t workerAllocations = workerAllocations_.exchange(0, std::memory_order_relaxed);
+        result.bucket.allocations.fold(runnerAllocations - runnerAllocationsSeen_ + workerAllocations, result.isNew);
+        runnerAllocationsSeen_ = runnerAllocations;
+
+        // these aren't measured for every frame, so are only reset with the bucket when not
+        auto foldMeasured = [&result](FrameHistogramBucket &bucket, std::optional<uint64_t> ns) {
+            if (ns)
+                bucket.fold(*ns, result.isNew || !bucket.count);
+            else if (result.isNew)
+                bucket = {};
+        };
+        foldMeasured(result.bucket.framePeriod, framePeriodNs_);
+        foldMeasured(result.bucket.frameLateness, frameLatenessNs_);
     }
 
     // Receiving Graph Communications
     bool try_dequeueDelta(std::unique_ptr<ResourceDelta> &out) { return deltaQueue_.try_dequeue(out); }
-    bool try_acceptLatestPlan()
+    bool try_acceptPlans()
     {
-        if (auto taken = pendingPlan_.tryAcceptLatest()) {
-            currentPlan_ = std::move(taken);
-            return true;
-        } else {
-            return false;
+        std::unique_ptr<ExecutionPlan> plan;
+        bool accepted = false;
+        while (planQueue_.try_dequeue(plan)) {
+            acceptPlan(*plan);
+            accepted = true;
         }
+        return accepted;
     }
+    void acceptPlan(ExecutionPlan &plan);
 
     // main operations
     void mainLoop(std::stop_token st);
@@ -135,42 +245,227 @@ private:
     bool waitForNextFrame(frameClock_t::time_point frameStart); // returns true only if the next frame is should now occur
     void wakeFromFrameWait()
     {
-        std::lock_guard lock(frameWaitMutex_);
-        frameWaitWakeUp_ = true;
-        frameWaitCV_.notify_one();
+        if (!frameWaitWakeUp_.exchange(true, std::memory_order_acq_rel))
+            frameWaitSemaphore_.release(); // wake-ups coalesce, so the semaphore is released at most once until taken
     }
 
     void updatePlan();
     void executeFrame(std::stop_token st);
+    uint64_t runCore(NodeCore &core, const NodeCore::RunContext &context);
+    void resetFrameArenas()
+    {
+        for (auto &shard : luaShards_)
+            shard->arena.reset();
+        for (auto &arena : workerArenas_)
+            arena->reset();
+    }
 
     void applyDelta(ResourceDelta &delta);
     void prepareRunContext();
+    void rebuildRunContext();
+    void patchRunContext();
+    void arrangeOutputBuffers();
 
     void clearOutputBuffers();
     void raiseLuaStateReset();
 
     // our thread
+    // for images created by scripts, one per lua shard, so that each shard acquires without contention - declared ahead of all
+    // that may hold their images, and only ever added to, so they outlive those images (which may outlive their shards)
+    std::vector<std::unique_ptr<ImagePool>> imagePools_;
     std::unordered_map<NodeId, std::unique_ptr<NodeCore>> cores_;
-    std::unordered_map<PinId, std::unique_ptr<ValueBuffer>> outputPinBuffers_;
-    std::unordered_map<PinId, std::vector<const ValueBuffer *>> inputsBackingVectors_;
-    NodeCore::RunContext runContext_{};
+    ValueBufferArena outputBuffers_; // every output pin's value buffer, laid out in execution order on each full rebuild
+    std::unordered_map<PinId, ValueBufferArena::Slot> outputPinSlots_;
+    std::vector<PinId> arrangedPins_;                   // arrangeOutputBuffers() input and scratch
+    std::vector<ValueBufferArena::Slot> arrangedSlots_; // parallel to arrangedPins_
+    std::vector<uint8_t> arrangedMarks_;                // per arena slot
     RunRateSetting runRate_ = {.rateMode = RunRateMode::Disabled, .desiredFramesPerSecond = 60.0f};
     Mailbox<RunRateSetting> pendingRunRate_; // incoming
     std::optional<std::jthread> thread_{};
 
-    // frame wait handling
-    std::condition_variable frameWaitCV_;
-    std::mutex frameWaitMutex_;
-    bool frameWaitWakeUp_ = false; // guarded by frameWaitMutex_
+    // frame wait handling - waits sleep on the semaphore until a little before their deadline, then spin the rest of the way,
+    // as sleeping alone wakes late by the OS's timer slack.  The spin is as long as the sleeps have recently overslept
+    static constexpr auto MinFrameWaitSpin = std::chrono::microseconds(50);
+    static constexpr auto MaxFrameWaitSpin = std::chrono::microseconds(2000);
+    std::binary_semaphore frameWaitSemaphore_{0};
+    std::atomic<bool> frameWaitWakeUp_                      = false; // set as the semaphore is released, cleared as it is acquired
+    frameClock_t::duration frameWaitSpin_                   = MaxFrameWaitSpin / 2;
+    std::optional<frameClock_t::time_point> frameDeadline_  = {}; // when the current frame was due to start, if it was paced
+    std::optional<frameClock_t::time_point> lastFrameStart_ = {}; // unless the wait since wasn't paced (e.g. while Disabled)
+    std::optional<uint64_t> framePeriodNs_                  = {}; // of the current frame, for its metrics
+    std::optional<uint64_t> frameLatenessNs_                = {}; // likewise
+
+    bool waitUntil(frameClock_t::time_point deadline, bool precise); // returns true if woken first - precise waits spin
+    void waitUntilWokenUp();
+    bool takeWakeUp(); // returns true if there was a wake-up to take
+
+    // UIRate pacing - each frame starts so as to finish just ahead of the UI's next frame, as predicted from the UI's latest
+    // frame and its period, by the most our recent frames took plus the lead margin.  The UI's signals don't wake us, so
+    // while it signals none (e.g. while minimized), we check for one every UIRatePollInterval
+    static constexpr int64_t UIRateStalePeriods = 8;  // the UI is idle once it has signalled no frame for this many
+    static constexpr size_t UIRateRecentFrames  = 16; // our frames whose durations set the lead
+    static constexpr auto UIRatePollInterval    = std::chrono::milliseconds(50);
+    std::atomic<int64_t> uiFrameNs_             = 0; // as the UI's latest frame started, in frameClock_t ns - 0 until then
+    std::atomic<int64_t> uiFramePeriodNs_       = 0; // the interval between the UI's frames, smoothed
+    uint32_t uiLongIntervals_                   = 0; // consecutive intervals ignored as hitches - UI thread only
+    int64_t uiFrameTargetedNs_                  = 0; // the UI frame our latest frame aimed to finish ahead of
+    std::array<int64_t, UIRateRecentFrames> recentFrameNs_{}; // durations of our latest frames, at recentFrameCount_ % size
+    size_t recentFrameCount_ = 0;
+
+    static int64_t toNs(frameClock_t::time_point t) { return std::chrono::nanoseconds(t.time_since_epoch()).count(); }
+    std::optional<int64_t> getUIRateTargetNs() const; // the UI frame the next frame should finish ahead of, if the UI is active
+    int64_t getUIRateLeadNs() const;
 
     void updateRunRate()
     {
-        if (auto taken = pendingRunRate_.tryAcceptLatest())
+        if (auto taken = pendingRunRate_.tryAcceptLatest()) {
+            if (taken->executionMode != runRate_.executionMode)
+                markAllStale(); // inputs were not tracked, or won't be
             runRate_ = *taken;
+        }
     }
 
-    // lua
-    std::optional<ScriptEnv> scriptEnv_{};
+    // lua garbage collection, as runRate_.luaGcMode has it - while held, the collector is stepped on the schedule LuaJIT's
+    // own pacing would keep, but between frames rather than within them (see doc/GraphExecution.md)
+    struct LuaGcPacing {
+        size_t baseBytes     = 0;     // the lua heap as the last cycle we stepped finished, or as the state was created
+        size_t leftBytes     = 0;     // the lua heap as we last left it, so its growth since is what the frame allocated
+        size_t debtBytes     = 0;     // allocation not yet paid for by a step
+        size_t externalBytes = 0;     // charged outside the heap since the base (see ScriptEnv::chargeExternalBytes)
+        bool cycleOpen       = false; // we have stepped the current cycle without finishing it
+    };
+    static constexpr size_t LuaGcPauseFactor   = 2;    // as LuaJIT's default - a cycle is due once the heap is this times its base
+    static constexpr size_t LuaGcIdleDivisor   = 8;    // in idle time, once the heap outgrows its base by 1 in this many bytes
+    static constexpr size_t LuaGcStepBytes     = 1024; // the allocation each step pays for, as LuaJIT's GCSTEPSIZE
+    static constexpr size_t LuaGcMaxDebtFactor = 2;    // debt beyond this times the base (or the frame's allocation) is paid
+                                                       // whatever the budget
+
+    // lua - the Runner keeps one or more lua states (shards), each with its own env and the graph's init script.  Shard 0 is
+    // ours, and runs every LuaThread core; each other shard runs the AnyLuaState cores given to it, a level's worth at a time
+    // on whichever thread of the worker pool takes them, so only one thread ever uses a state at once
+    struct LuaShard {
+        NodeCore::RunContext context{}; // the only contexts through which cores may reach lua
+        FrameArena arena{};             // the context's
+        std::optional<ScriptEnv> env{};
+        LuaGcPacing gc{};
+    };
+    std::vector<std::unique_ptr<LuaShard>> luaShards_; // by pointer, as each env refers to its context
+    ScriptCompiler scriptCompiler_;                    // started by the first script core to submit a script
+
+    void resetLuaShards(const std::string &initScript, uint32_t count);
+    void addLuaShard();
+    size_t getLuaHeapBytes() const
+    {
+        size_t total = 0;
+        for (const auto &shard : luaShards_)
+            total += shard->env->getHeapBytes();
+        return total;
+    }
+
+    // each of these runs once per shard - on the worker pool, when there are several
+    using LuaShardFn = void (Runner::*)(LuaShard &shard);
+    LuaShardFn luaShardJob_ = nullptr;
+    void runOnLuaShards(LuaShardFn fn);
+    static void runLuaShardJob(void *runner, size_t jobIndex, size_t workerSlot);
+
+    frameClock_t::time_point luaGcUntil_{}; // for the shards' collectLuaGarbageUntil()
+    static void restartLuaGcPacing(LuaShard &shard)
+    {
+        shard.gc.baseBytes = shard.gc.leftBytes = shard.env->getHeapBytes();
+        shard.gc.debtBytes                      = 0;
+        shard.gc.externalBytes                  = 0;
+        shard.gc.cycleOpen                      = false;
+        shard.env->takeExternalBytes(); // as charged before the restart
+    }
+    void collectLuaGarbageAfterFrame();
+    void collectLuaGarbageUntil(frameClock_t::time_point idleUntil); // called before each wait for the next frame
+    void collectLuaGarbageAfterFrame(LuaShard &shard);
+    void collectLuaGarbageUntil(LuaShard &shard);
+    // steps until the debt is paid down to the bytes given (or else until the cycle finishes), or the time passes
+    static void stepLuaGc(LuaShard &shard, frameClock_t::time_point until, std::optional<size_t> payDownToBytes);
+
+    // where a core sits in levels_ below
+    struct ScheduledLocation {
+        static constexpr uint32_t Unscheduled = UINT32_MAX;
+        uint32_t level = Unscheduled, index = 0;
+        uint32_t luaShard = 0; // if not ours, the index is into the level's shardCores of that shard
+    };
+
+    // the adopted plan, held in a form that patches can edit in place
+    struct PlanNode {
+        uint32_t level = 0;
+        ExecutionPlan::NodePins pins;
+        ScheduledLocation scheduled{};
+    };
+    std::optional<PlanVersion> planVersion_{};
+    std::unordered_map<NodeId, PlanNode> planNodes_; // node references are stable, so the schedule points into it
+    std::unordered_map<PinId, PinId> planLinks_;     // input pin -> the output pin linked to it
+    std::unordered_set<NodeId> dirtyNodes_;          // nodes to reschedule, due to a patch or delta since the last compile
+    bool rebuildPending_ = true;                     // a full plan has been accepted since the last compile
+
+    // a compile rebuilds everything rather than patching once it would reschedule more than 1 in this many nodes
+    static constexpr size_t PatchLimitDivisor = 4;
+
+    // parallel execution - cores of the same dependency level are independent, so those with CoreAffinity::Any are
+    // dispatched to the worker pool, along with one job per lua shard (but ours) for the cores given to that shard, while our
+    // thread runs the level's lua-pinned cores (see doc/GraphExecution.md)
+    struct ScheduledCore {
+        NodeId nodeId;
+        NodeCore *core;
+        PlanNode *planNode;
+        uint32_t inputBegin, inputCount, outputBegin, outputCount; // ranges within the compiled slot arrays below
+        bool stale = true; // must run next frame whatever its inputs - until it has run since being scheduled
+    };
+    struct ScheduledLevel {
+        std::vector<ScheduledCore> cores; // [0, luaBegin) may run on any thread, the rest are pinned to our thread
+        uint32_t luaBegin = 0;
+        std::vector<std::vector<ScheduledCore>> shardCores; // indexed by lua shard - [0] stays empty, as ours run above
+
+        bool empty() const
+        {
+            return cores.empty() && std::ranges::all_of(shardCores, [](const auto &c) { return c.empty(); });
+        }
+    };
+    std::vector<ScheduledLevel> levels_; // indexed by level - some may be empty between compiles that rebuild everything
+    ScheduledLevel *dispatchedLevel_ = nullptr;
+    std::vector<uint32_t> dispatchedShards_;    // the shards with cores in the dispatched level, whose jobs follow its Any cores
+    std::atomic<uint32_t> dispatchedSkips_ = 0; // pure cores the workers skipped in the dispatched level
+    WorkerPool workerPool_;
+    std::vector<NodeCore::RunContext> workerContexts_;       // lua-free contexts, indexed by worker slot
+    std::vector<std::unique_ptr<FrameArena>> workerArenas_; // parallel to workerContexts_
+
+    void clearSchedule();
+    void scheduleCore(NodeId nodeId, PlanNode &planNode, NodeCore &core);
+    void unscheduleCore(PlanNode &planNode);
+    void assignLuaShards(); // gives AnyLuaState cores their shards, as each plan is adopted
+    void startWorkers();
+
+    // compiled slot arrays - compiled as a plan is adopted, so frames index them instead of looking up pins.  A patch appends
+    // the ranges of the cores it reschedules, leaving their old ranges unused until the next full rebuild.
+    std::vector<PinId> inputPins_, outputPins_;
+    std::vector<const ValueBuffer *> inputSlots_; // parallel to inputPins_
+    std::vector<ValueBuffer *> outputSlots_;      // parallel to outputPins_
+    std::vector<uint64_t> inputGenerations_;      // parallel to inputPins_ - as last seen, under ExecutionMode::SkipUnchanged
+    size_t unusedSlots_ = 0;                      // entries within the slot arrays that no core's range covers
+    const ValueBuffer *resolveInput(PinId inputPinId);
+    ValueBuffer *resolveOutput(PinId outputPinId);
+    void bindSlots(const ScheduledCore &entry, NodeCore::RunContext &context) const
+    {
+        context.nodeId     = entry.nodeId;
+        context.inputPins  = {inputPins_.data() + entry.inputBegin, entry.inputCount};
+        context.inputs     = {inputSlots_.data() + entry.inputBegin, entry.inputCount};
+        context.outputPins = {outputPins_.data() + entry.outputBegin, entry.outputCount};
+        context.outputs    = {outputSlots_.data() + entry.outputBegin, entry.outputCount};
+    }
+
+    static constexpr uint32_t MinDispatchedCores = 2; // below this, dispatch costs more than it saves
+
+    // dirty propagation - a skipped core leaves its outputs untouched, so the cores downstream see no change either
+    bool mustRun(ScheduledCore &entry);
+    void markAllStale();
+
+    static void runDispatchedCore(void *runner, size_t jobIndex, size_t workerSlot);
+    uint32_t runLuaShardCores(std::vector<ScheduledCore> &cores, NodeCore::RunContext &context); // returns those skipped
 };
 
 } // namespace Mirael
\ No newline at end of file
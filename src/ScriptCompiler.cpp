@@ -0,0 +1,302 @@
+#include "pch.h"
+
+#include "lua.hpp"
+
+#include "FrameTrace.h"
+#include "ScriptCompiler.h"
+
+namespace Mirael
+{
+
+namespace
+{
+
+struct LuaStateDeleter {
+    void operator()(lua_State *s) const { lua_close(s); }
+};
+using LuaStatePtr = std::unique_ptr<lua_State, LuaStateDeleter>;
+
+constexpr std::string_view CacheMagic = "MiraelBC2"; // begins each cache written, and names the format's version
+constexpr uint32_t MaxCachedSize      = 1u << 26;    // of a script or its bytecode, so a damaged file can't cause a huge read
+constexpr std::string_view ProbeScript = "local t = {...} return #t, t[1] .. 'x', 0.5"; // dumped for the build's stamp
+
+// LuaJIT's bytecode names its chunk in its header, after the signature, version and flags (see lj_bcdump.h), and loading it
+// takes that name rather than the one given to luaL_loadbuffer() - unless stripped of debug info, which would lose line numbers
+constexpr std::string_view BytecodeSignature = "\x1bLJ";
+constexpr uint32_t BytecodeStripFlag         = 0x02;
+
+bool readUleb128(std::string_view s, size_t &pos, uint32_t &value)
+{
+    value = 0;
+    for (int shift = 0; pos < s.size() && shift < 32; shift += 7) {
+        const auto byte = static_cast<uint8_t>(s[pos++]);
+        value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+void appendUleb128(std::string &s, uint32_t value)
+{
+    for (; value >= 0x80; value >>= 7)
+        s.push_back(static_cast<char>((value & 0x7f) | 0x80));
+    s.push_back(static_cast<char>(value));
+}
+
+// returns the bytecode with its chunk renamed, or an empty string if its header isn't as expected
+std::string renameChunk(std::string_view bytecode, std::string_view chunkName)
+{
+    if (!bytecode.starts_with(BytecodeSignature))
+        return {};
+
+    size_t pos = BytecodeSignature.size() + 1; // past the version
+    uint32_t flags, nameSize;
+    if (!readUleb128(bytecode, pos, flags) || (flags & BytecodeStripFlag))
+        return {};
+    const size_t nameStart = pos;
+    if (!readUleb128(bytecode, pos, nameSize) || bytecode.size() - pos < nameSize)
+        return {};
+
+    std::string renamed(bytecode.substr(0, nameStart));
+    appendUleb128(renamed, static_cast<uint32_t>(chunkName.size()));
+    renamed.append(chunkName);
+    renamed.append(bytecode.substr(pos + nameSize));
+    return renamed;
+}
+
+bool readString(std::istream &in, std::string &s)
+{
+    uint32_t size = 0;
+    if (!in.read(reinterpret_cast<char *>(&size), sizeof(size)) || size > MaxCachedSize)
+        return false;
+    s.resize(size);
+    return static_cast<bool>(in.read(s.data(), size));
+}
+
+void writeString(std::ostream &out, std::string_view s)
+{
+    const auto size = static_cast<uint32_t>(s.size());
+    out.write(reinterpret_cast<const char *>(&size), sizeof(size));
+    out.write(s.data(), size);
+}
+
+// FNV-1a, as the hash must be the same in every build and run that reads the file
+uint64_t hashBytes(std::string_view s, uint64_t hash = 0xcbf29ce484222325)
+{
+    for (char c : s)
+        hash = (hash ^ static_cast<uint8_t>(c)) * 0x100000001b3;
+    return hash;
+}
+
+// of an entry's script and bytecode together, so that an entry whose bytecode isn't that cached for its script is dropped
+uint64_t hashEntry(std::string_view script, std::string_view bytecode)
+{
+    return hashBytes(bytecode, hashBytes(script) ^ script.size());
+}
+
+// names the LuaJIT build, and hashes the bytecode it dumps for a probe script - which holds its bytecode format's version and
+// flags - so that bytecode is only read back by a build that would have compiled the same, and is otherwise compiled anew
+const std::string &getBuildStamp()
+{
+    static const std::string stamp = [] {
+        std::string probe;
+        if (LuaStatePtr L{luaL_newstate()}; L && luaL_loadbuffer(L.get(), ProbeScript.data(), ProbeScript.size(), "probe") == LUA_OK) {
+            auto writer = [](lua_State *, const void *p, size_t size, void *bytecode) {
+                static_cast<std::string *>(bytecode)->append(static_cast<const char *>(p), size);
+                return 0;
+            };
+            lua_dump(L.get(), writer, &probe);
+        }
+        return std::format("{} {:016x}", LUAJIT_VERSION, hashBytes(probe));
+    }();
+    return stamp;
+}
+
+} // namespace
+
+void ScriptCompiler::submit(std::shared_ptr<ResultMailbox> mailbox, uint64_t version, std::string script, std::string chunkName)
+{
+    std::lock_guard lock(mutex_);
+
+    Result submitted{.version = version, .script = std::move(script), .chunkName = std::move(chunkName)};
+    auto waiting = std::ranges::find(jobs_, mailbox, &Job::mailbox);
+
+    // a cached script is posted at once - unless the mailbox's prior script is still compiling, as it would then be posted after
+    if (mailbox.get() != compilingFor_ && tryFindCached(submitted)) {
+        if (waiting != jobs_.end())
+            jobs_.erase(waiting);
+        mailbox->postNew(std::make_unique<Result>(std::move(submitted)));
+        if (jobs_.empty() && !compilingFor_)
+            idleCV_.notify_all();
+        return;
+    }
+
+    if (!thread_)
+        thread_.emplace([this](std::stop_token st) { compilerLoop(st); });
+
+    if (waiting != jobs_.end())
+        waiting->result = std::move(submitted);
+    else
+        jobs_.push_back(Job{.mailbox = std::move(mailbox), .result = std::move(submitted)});
+    wakeCV_.notify_one();
+}
+
+void ScriptCompiler::waitUntilIdle()
+{
+    std::unique_lock lock(mutex_);
+    idleCV_.wait(lock, [this] { return jobs_.empty() && !compilingFor_; });
+}
+
+void ScriptCompiler::stop()
+{
+    if (!thread_)
+        return;
+
+    thread_->request_stop(); // wakes the thread, as its wait observes the stop token
+    thread_.reset();         // joins
+
+    std::lock_guard lock(mutex_);
+    jobs_.clear();
+    idleCV_.notify_all();
+}
+
+void ScriptCompiler::compilerLoop(std::stop_token st)
+{
+    FrameTrace::setThreadName("Script Compiler");
+    LuaStatePtr L{luaL_newstate()}; // no libraries, as it never runs anything
+
+    std::unique_lock lock(mutex_);
+    while (wakeCV_.wait(lock, st, [this] { return !jobs_.empty(); })) {
+        auto job = std::move(jobs_.front());
+        jobs_.pop_front();
+        compilingFor_ = job.mailbox.get();
+
+        // a job is only left to this thread when found in the cache if its mailbox was then busy, as above
+        const bool cached = tryFindCached(job.result);
+        if (!cached) {
+            stats_.misses++;
+            lock.unlock();
+            if (L)
+                compile(L.get(), job.result);
+            else
+                job.result.errorText = "Unable to initialize Lua for compilation.";
+            lock.lock();
+            if (!job.result.bytecode.empty())
+                addToCache(job.result.script, job.result.bytecode);
+        }
+
+        job.mailbox->postNew(std::make_unique<Result>(std::move(job.result))); // while locked, so ordered with submit()'s posts
+        compilingFor_ = nullptr;
+        if (jobs_.empty())
+            idleCV_.notify_all();
+    }
+}
+
+void ScriptCompiler::compile(lua_State *L, Result &result)
+{
+    FrameTrace::Scope trace("compile");
+    if (luaL_loadbuffer(L, result.script.data(), result.script.size(), result.chunkName.c_str()) != LUA_OK) {
+        const char *errorText = lua_tostring(L, -1);
+        result.errorText      = errorText ? errorText : "Unknown compilation error.";
+        lua_pop(L, 1);
+        return;
+    }
+
+    auto writer = [](lua_State *, const void *p, size_t size, void *bytecode) {
+        static_cast<std::string *>(bytecode)->append(static_cast<const char *>(p), size);
+        return 0;
+    };
+    lua_dump(L, writer, &result.bytecode);
+    lua_pop(L, 1);
+}
+
+ScriptCompiler::CacheStats ScriptCompiler::getCacheStats() const
+{
+    std::lock_guard lock(mutex_);
+
+    CacheStats result = stats_;
+    result.entries    = cache_.size();
+    result.bytes      = cacheBytes_;
+    return result;
+}
+
+void ScriptCompiler::readCache(std::istream &in)
+{
+    LuaStatePtr L{luaL_newstate()}; // to check each bytecode loads, as that of another LuaJIT build may not
+    if (!L)
+        return;
+
+    std::string magic(CacheMagic.size(), '\0'), stamp, script, bytecode;
+    uint32_t count = 0;
+    uint64_t hash  = 0;
+    while (in.read(magic.data(), magic.size()) && magic == CacheMagic && readString(in, stamp) &&
+           in.read(reinterpret_cast<char *>(&count), sizeof(count))) {
+        const bool sameBuild = stamp == getBuildStamp();
+        for (; count > 0 && in.read(reinterpret_cast<char *>(&hash), sizeof(hash)) && readString(in, script) &&
+               readString(in, bytecode);
+             count--) {
+            if (!sameBuild || hash != hashEntry(script, bytecode))
+                continue;
+            const bool loads = luaL_loadbuffer(L.get(), bytecode.data(), bytecode.size(), "cache") == LUA_OK;
+            lua_pop(L.get(), 1); // the chunk, or the error
+            if (loads) {
+                std::lock_guard lock(mutex_);
+                addToCache(script, bytecode);
+            }
+        }
+        if (count)
+            return; // truncated
+    }
+}
+
+void ScriptCompiler::writeCache(std::ostream &out) const
+{
+    std::lock_guard lock(mutex_);
+
+    out.write(CacheMagic.data(), CacheMagic.size());
+    writeString(out, getBuildStamp());
+    const auto count = static_cast<uint32_t>(cache_.size());
+    out.write(reinterpret_cast<const char *>(&count), sizeof(count));
+    for (const auto &[script, entry] : cache_) {
+        const uint64_t hash = hashEntry(script, entry.bytecode);
+        out.write(reinterpret_cast<const char *>(&hash), sizeof(hash));
+        writeString(out, script);
+        writeString(out, entry.bytecode);
+    }
+}
+
+bool ScriptCompiler::tryFindCached(Result &result)
+{
+    auto it = cache_.find(result.script);
+    if (it == cache_.end())
+        return false;
+
+    // the cached bytecode names the chunk it was first compiled as, so is renamed for runtime errors to name this one
+    auto renamed = renameChunk(it->second.bytecode, result.chunkName);
+    if (renamed.empty())
+        return false;
+
+    it->second.lastUsed = ++cacheUses_;
+    result.bytecode     = std::move(renamed);
+    stats_.hits++;
+    return true;
+}
+
+void ScriptCompiler::addToCache(const std::string &script, const std::string &bytecode)
+{
+    auto [it, inserted] = cache_.try_emplace(script);
+    if (!inserted)
+        cacheBytes_ -= script.size() + it->second.bytecode.size();
+    it->second.bytecode = bytecode;
+    it->second.lastUsed = ++cacheUses_;
+    cacheBytes_ += script.size() + bytecode.size();
+
+    while (cacheBytes_ > MaxCacheBytes && cache_.size() > 1) {
+        auto oldest = std::ranges::min_element(cache_, {}, [](const auto &kv) { return kv.second.lastUsed; });
+        cacheBytes_ -= oldest->first.size() + oldest->second.bytecode.size();
+        cache_.erase(oldest);
+    }
+}
+
+} // namespace Mirael
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+
+#include "Mailbox.h"
+
+struct lua_State;
+
+namespace Mirael
+{
+
+/// <summary>
+/// Compiles Lua scripts to LuaJIT bytecode on a thread of its own, so that a Runner need only load the bytecode - which is
+/// far cheaper than parsing the source - rather than stall a frame on the parse.
+///
+/// Each submission names the Mailbox its result is posted to.  A newer submission to the same Mailbox replaces any older one
+/// still waiting, so a burst of edits compiles only the latest.  The compiler's own lua_State does nothing but parse and dump,
+/// so the bytecode loads into any state, and keeps its debug info so that runtime errors still report lines.  The thread is
+/// started by the first submission.
+///
+/// Compiled bytecode is cached by script, so that a script identical to one already compiled - whether in another node, or
+/// in the same node after a project reload - skips the parser entirely.  A cached script is posted at once by submit(), so
+/// is ready within the same frame.  The cache can be written to and read from a file, so that it outlives the process - each
+/// entry hashed with its script, and the file stamped with the LuaJIT build that wrote it, so that only bytecode this build
+/// would have compiled from the same script is read back.
+/// </summary>
+class ScriptCompiler
+{
+public:
+    struct Result {
+        uint64_t version = 0;  // as submitted
+        std::string script;    // as submitted
+        std::string chunkName; // as submitted
+        std::string bytecode;  // empty if compilation failed
+        std::string errorText; // the reason compilation failed, if it did
+    };
+    using ResultMailbox = Mailbox<Result>;
+
+    struct CacheStats {
+        uint64_t hits = 0, misses = 0; // submissions served by the cache, and those compiled
+        size_t entries = 0, bytes = 0; // as now cached
+    };
+
+    static constexpr size_t MaxCacheBytes = size_t{16} << 20; // of scripts and bytecode, beyond which the least recently used go
+
+    ScriptCompiler() = default;
+    ~ScriptCompiler() { stop(); }
+
+    // forbid copy/move
+    ScriptCompiler(const ScriptCompiler &)            = delete;
+    ScriptCompiler &operator=(const ScriptCompiler &) = delete;
+    ScriptCompiler(ScriptCompiler &&)                 = delete;
+    ScriptCompiler &operator=(ScriptCompiler &&)      = delete;
+
+    void submit(std::shared_ptr<ResultMailbox> mailbox, uint64_t version, std::string script, std::string chunkName);
+    void waitUntilIdle(); // returns once every result submitted so far has been posted
+    void stop();          // drops any submissions still waiting
+
+    CacheStats getCacheStats() const;
+    void readCache(std::istream &in);         // adds what writeCache() wrote, but for entries of another build or damaged
+    void writeCache(std::ostream &out) const; // appends, so that several compilers' caches may share one file
+
+private:
+    struct Job {
+        std::shared_ptr<ResultMailbox> mailbox;
+        Result result; // all but the output
+    };
+
+    struct CacheEntry {
+        std::string bytecode;
+        uint64_t lastUsed = 0; // as counted by cacheUses_
+    };
+
+    mutable std::mutex mutex_; // guards all below but the thread
+    std::condition_variable_any wakeCV_;
+    std::condition_variable idleCV_;
+    std::deque<Job> jobs_;
+    const ResultMailbox *compilingFor_ = nullptr;       // the mailbox of the job being compiled, if any
+    std::unordered_map<std::string, CacheEntry> cache_; // keyed by script, so hashed by content
+    uint64_t cacheUses_ = 0;
+    size_t cacheBytes_  = 0;
+    CacheStats stats_{}; // but for its sizes, which are taken from the above
+
+    std::optional<std::jthread> thread_{};
+
+    void compilerLoop(std::stop_token st);
+    static void compile(lua_State *L, Result &result);
+
+    // cache - each only while locked
+    bool tryFindCached(Result &result);
+    void addToCache(const std::string &script, const std::string &bytecode);
+};
+
+} // namespace Mirael
@@ -2,19 +2,30 @@
 
 #include "ScriptEnv.h"
 
+#include "NativeArray.h"
+#include "NativeImage.h"
+#include "PixelKernels.h"
+
 namespace Mirael
 {
 
-ScriptEnv::ScriptEnv(NodeCore::RunContext &runContext) : runContext_(runContext)
+namespace
 {
-    runContext.env = this;
-    establishLuaState();
-}
 
-void ScriptEnv::registerPins(PinMapping pinMapping)
+char envKey = 0; // its address is the registry key of each state's env, as light userdata
+
+// run once per lua state - returns a function casting light userdata to the double * through which scripts see numeric pins
+constexpr std::string_view SlotCastScript = R"lua(
+local cast = require('ffi').cast
+return function(slots) return cast('double *', slots) end
+)lua";
+
+} // namespace
+
+ScriptEnv::ScriptEnv(NodeCore::RunContext &runContext, ImagePool *imagePool) : runContext_(runContext), imagePool_(imagePool)
 {
-    pinMappings_[runContext_.nodeId] = pinMapping;
-    setCurrentNode(runContext_.nodeId); // this is necessary for the case where a core calls registerPins() within onFrame
+    runContext.env = this;
+    establishLuaState();
 }
 
 void ScriptEnv::pushEnvTable()
@@ -23,14 +34,67 @@ void ScriptEnv::pushEnvTable()
     lua_rawgeti(L, LUA_REGISTRYINDEX, envTableRef_);
 }
 
+void ScriptEnv::pushNodeEnvTable(double *inputSlots, double *outputSlots)
+{
+    // scripts reach the proxies in their own env without the detour through its metatable to globals, which otherwise
+    // serves every read and forbids every write just as for the shared env table
+    pushEnvTable();
+    lua_createtable(L, 0, 2);
+    for (auto [keyword, slots] : {std::pair{"input", inputSlots}, std::pair{"output", outputSlots}}) {
+        lua_pushstring(L, keyword);
+        if (slots) {
+            lua_rawgeti(L, LUA_REGISTRYINDEX, slotCastRef_);
+            lua_pushlightuserdata(L, slots);
+            lua_call(L, 1, 1);
+        } else
+            lua_getfield(L, LUA_GLOBALSINDEX, keyword); // as the init script left them
+        lua_rawset(L, -3);
+    }
+    lua_getmetatable(L, -2);
+    lua_setmetatable(L, -2);
+    lua_remove(L, -2); // the shared env table
+}
+
 void ScriptEnv::resetWithInitScript(const std::string &initScript)
 {
     L_.reset();
     L            = nullptr;
     envTableRef_ = LUA_NOREF;
+    slotCastRef_ = LUA_NOREF;
     establishLuaState(initScript.c_str());
 }
 
+void ScriptEnv::holdCollector(bool hold)
+{
+    if (hold)
+        lua_gc(L, LUA_GCSTOP, 0); // even if already held, as a script's collectgarbage() restarts it
+    else if (collectorHeld_)
+        lua_gc(L, LUA_GCRESTART, 0);
+    collectorHeld_ = hold;
+}
+
+bool ScriptEnv::stepCollector()
+{
+    const bool finishedCycle = lua_gc(L, LUA_GCSTEP, 0) == 1;
+    if (collectorHeld_)
+        lua_gc(L, LUA_GCSTOP, 0); // as stepping restarts it
+    return finishedCycle;
+}
+
+void ScriptEnv::chargeExternalBytes(lua_State *L, size_t bytes)
+{
+    lua_pushlightuserdata(L, &envKey);
+    lua_rawget(L, LUA_REGISTRYINDEX);
+    auto *self = static_cast<ScriptEnv *>(lua_touserdata(L, -1));
+    lua_pop(L, 1);
+
+    // stepping while held would restart the collector mid-frame - the very thing holding it avoids
+    if (self && self->collectorHeld_)
+        self->externalBytes_ += bytes;
+    else
+        lua_gc(L, LUA_GCSTEP, static_cast<int>(bytes / 1024));
+}
+
 void ScriptEnv::establishLuaState(const char *initScript)
 {
     if (L_)
@@ -46,9 +110,18 @@ void ScriptEnv::establishLuaState(const char *initScript)
     L             = L_.get();
     runContext_.L = L;
 
+    if (collectorHeld_)
+        lua_gc(L, LUA_GCSTOP, 0);
+    externalBytes_ = 0; // as charged to the prior state
+
+    lua_pushlightuserdata(L, &envKey);
+    lua_pushlightuserdata(L, this);
+    lua_rawset(L, LUA_REGISTRYINDEX);
+
     luaL_openlibs(L);
 
     establishRootMiraelKeywords();
+    establishSlotCast(); // before the init script, which might otherwise alter the ffi library it uses
 
     attemptInitScript(initScript); // it is valid for init scripts to modfiy globals, or make aliases to mirael keywords
 
@@ -100,6 +173,17 @@ void ScriptEnv::establishRootMiraelKeywords()
     lua_rawset(L, -3);
 
     lua_pop(L, 1);
+
+    NativeImage::establishLuaBindings(L, imagePool_); // newimage and copyimage
+    NativeArray::establishLuaBindings(L);             // newarray and copyarray
+    PixelKernels::establishLuaBindings(L);            // the pixels table
+}
+
+void ScriptEnv::establishSlotCast()
+{
+    if (luaL_loadbuffer(L, SlotCastScript.data(), SlotCastScript.size(), "slotCast") != LUA_OK || lua_pcall(L, 0, 1, 0) != LUA_OK)
+        throw std::runtime_error(std::format("Unable to define numeric pins: {}", lua_tostring(L, -1)));
+    slotCastRef_ = luaL_ref(L, LUA_REGISTRYINDEX);
 }
 
 void ScriptEnv::establishEnvTable()
@@ -160,24 +244,29 @@ int ScriptEnv::l_forbidGlobalNewIndex(lua_State *L)
     return luaL_error(L, "attempt to write at global index \'%s\'", key);
 }
 
+void ScriptEnv::pushInputValue(lua_State *L, const ValueBuffer &buf, int n)
+{
+    // a value the script couldn't read as it is would otherwise read as nil, as though its input were unlinked, so it errs
+    if (const char *typeName = buf.getUncrossableTypeName(L))
+        luaL_error(L, "input %d is a %s from another lua state, which only numbers, strings, images and arrays cross - give "
+                      "its graph a single Lua State, or pass it in one of those",
+                   n, typeName);
+    buf.pushValueToLuaStack(L);
+}
+
 int ScriptEnv::l_inputIndex(lua_State *L)
 {
+    // input[n] reads input slot n-1 of the current node - slots follow the node's pin order, as compiled by the Runner
     auto *self = static_cast<ScriptEnv *>(lua_touserdata(L, lua_upvalueindex(1)));
     int n      = static_cast<int>(lua_tointeger(L, 2));
 
-    PinId pinId;
-    if (!tryGetPinId(self->currentInPins_, n, pinId)) {
-        lua_pushnil(L);
-        return 1;
-    }
-
-    const ValueBuffer *buf = self->runContext_.getFirstInput(pinId);
+    const ValueBuffer *buf = n > 0 ? self->runContext_.getInputAt(static_cast<size_t>(n - 1)) : nullptr;
     if (!buf) {
         lua_pushnil(L);
         return 1;
     }
 
-    buf->pushValueToLuaStack();
+    pushInputValue(L, *buf, n);
     return 1;
 }
 
@@ -185,16 +274,15 @@ int ScriptEnv::l_inputCall(lua_State *L)
 {
     auto *self = static_cast<ScriptEnv *>(lua_touserdata(L, lua_upvalueindex(1)));
 
-    auto &pins = *self->currentInPins_;
-    for (auto pinId : pins) {
-        const auto *buf = self->runContext_.getFirstInput(pinId);
-        if (buf)
-            buf->pushValueToLuaStack();
+    auto inputs = self->runContext_.inputs;
+    for (size_t i = 0; i < inputs.size(); i++) {
+        if (inputs[i])
+            pushInputValue(L, *inputs[i], static_cast<int>(i + 1));
         else
             lua_pushnil(L);
     }
 
-    return static_cast<int>(pins.size());
+    return static_cast<int>(inputs.size());
 }
 
 int ScriptEnv::l_outputIndex(lua_State *L)
@@ -202,19 +290,13 @@ int ScriptEnv::l_outputIndex(lua_State *L)
     auto *self = static_cast<ScriptEnv *>(lua_touserdata(L, lua_upvalueindex(1)));
     int n      = static_cast<int>(lua_tointeger(L, 2));
 
-    PinId pinId;
-    if (!tryGetPinId(self->currentOutPins_, n, pinId)) {
-        lua_pushnil(L);
-        return 1;
-    }
-
-    const ValueBuffer *buf = self->runContext_.getOutput(pinId);
+    const ValueBuffer *buf = n > 0 ? self->runContext_.getOutputAt(static_cast<size_t>(n - 1)) : nullptr;
     if (!buf) {
         lua_pushnil(L);
         return 1;
     }
 
-    buf->pushValueToLuaStack();
+    buf->pushValueToLuaStack(L);
     return 1;
 }
 
@@ -223,11 +305,7 @@ int ScriptEnv::l_outputNewIndex(lua_State *L)
     auto *self = static_cast<ScriptEnv *>(lua_touserdata(L, lua_upvalueindex(1)));
     int n      = static_cast<int>(lua_tointeger(L, 2));
 
-    PinId pinId;
-    if (!tryGetPinId(self->currentOutPins_, n, pinId))
-        return 0;
-
-    ValueBuffer *buf = self->runContext_.getOutput(pinId);
+    ValueBuffer *buf = n > 0 ? self->runContext_.getOutputAt(static_cast<size_t>(n - 1)) : nullptr;
     if (!buf)
         return 0;
 
@@ -242,8 +320,8 @@ int ScriptEnv::l_outputCall(lua_State *L)
     // 'eventual consistency' design approach, and occurs when pins are added before a corresponding execution plan update.
 
     auto *self        = static_cast<ScriptEnv *>(lua_touserdata(L, lua_upvalueindex(1)));
-    auto &pins        = *self->currentOutPins_;
-    const int numPins = static_cast<int>(pins.size());
+    auto outputs      = self->runContext_.outputs;
+    const int numPins = static_cast<int>(outputs.size());
     const int numArgs = lua_gettop(L) - 1;
 
     if (numArgs > 0) {
@@ -256,8 +334,7 @@ int ScriptEnv::l_outputCall(lua_State *L)
         int i = std::min(numArgs, numPins);
 
         while (i-- > 0) {
-            auto pinId = pins[i];
-            auto *buf  = self->runContext_.getOutput(pinId);
+            auto *buf = outputs[i];
             if (buf)
                 buf->setValueFromLuaStack(); // pops the value from the Lua stack and sets the buffer to that value
             else
@@ -268,40 +345,16 @@ int ScriptEnv::l_outputCall(lua_State *L)
         return 0;
     } else {
         // return all outputs
-        for (auto pinId : pins) {
-            const auto *buf = self->runContext_.getOutput(pinId);
+        for (const auto *buf : outputs) {
             if (buf)
-                buf->pushValueToLuaStack();
+                buf->pushValueToLuaStack(L);
             else
                 lua_pushnil(L);
         }
-        assert(lua_gettop(L) == 1 + pins.size()); // should have pushed exactly one value per pin
+        assert(lua_gettop(L) == 1 + numPins); // should have pushed exactly one value per pin
 
         return numPins;
     }
 }
 
-bool ScriptEnv::tryGetPinId(const std::vector<PinId> *pins, int n, PinId &outPinId)
-{
-    if (pins && n > 0 && n <= pins->size()) {
-        outPinId = (*pins)[static_cast<size_t>(n - 1)];
-        return true;
-    } else
-        return false;
-}
-
-void ScriptEnv::setCurrentNode(NodeId nodeId)
-{
-    auto it = pinMappings_.find(nodeId);
-    if (it != pinMappings_.end()) {
-        currentInPins_  = it->second.inPins;
-        currentOutPins_ = it->second.outPins;
-    } else {
-        currentInPins_  = nullptr;
-        currentOutPins_ = nullptr;
-    }
-}
-
-void ScriptEnv::forgetNode(NodeId nodeId) { pinMappings_.erase(nodeId); }
-
 }; // namespace Mirael
\ No newline at end of file
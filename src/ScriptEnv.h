@@ -3,9 +3,9 @@
 #include "lua.hpp"
 
 #include <memory>
-#include <unordered_map>
-#include <vector>
+#include <utility>
 
+#include "ImagePool.h"
 #include "NodeCore.h"
 
 namespace Mirael
@@ -14,12 +14,13 @@ namespace Mirael
 /*
  * ScriptEnv manages the Lua Environment for Script Nodes.
  *
- * ScriptEnv is owned by the Runner and operates only on the Runner thread.
+ * ScriptEnv is owned by the Runner, which may keep several (one per lua state), and each operates
+ * on one thread at a time - the Runner thread, or whichever worker is running its state's cores.
  */
 class ScriptEnv final
 {
 public:
-    explicit ScriptEnv(NodeCore::RunContext &runContext);
+    explicit ScriptEnv(NodeCore::RunContext &runContext, ImagePool *imagePool = nullptr); // images come from the heap without a pool
 
     // forbid copy/move
     ScriptEnv(const ScriptEnv &)            = delete;
@@ -27,19 +28,28 @@ public:
     ScriptEnv(ScriptEnv &&)                 = delete;
     ScriptEnv &operator=(ScriptEnv &&)      = delete;
 
-    struct PinMapping {
-        const std::vector<PinId> *inPins;
-        const std::vector<PinId> *outPins;
-    };
-
-    void registerPins(PinMapping pinMapping);
     void pushEnvTable();
+    // a new env table for one node's script, holding the input and output proxies itself - or, given slots for numeric pins,
+    // holding input and output as double * cdata over those slots instead
+    void pushNodeEnvTable(double *inputSlots = nullptr, double *outputSlots = nullptr);
 
     void resetWithInitScript(const std::string &initScript);
     std::string getInitScriptResult() { return initScriptResult_; } // rarely called, copy is fine
 
+    // while held, the collector only runs when stepped (see LuaGcMode) - which outlasts a reset of the state
+    void holdCollector(bool hold);
+    bool stepCollector(); // one small increment, leaving it held - returns true if that finished a cycle
+
+    // accounts for memory outside the lua heap that a new lua object keeps alive (as an image's view does its pixels), which
+    // the collector would otherwise never see - stepping it as though the bytes were allocated in the heap, unless it's held,
+    // when they are kept for the Runner to take as the frame's, with its heap's growth
+    static void chargeExternalBytes(lua_State *L, size_t bytes);
+    size_t takeExternalBytes() { return std::exchange(externalBytes_, 0); }
+    size_t getHeapBytes() const { return static_cast<size_t>(lua_gc(L, LUA_GCCOUNT, 0)) * 1024 + lua_gc(L, LUA_GCCOUNTB, 0); }
+
 private:
     NodeCore::RunContext &runContext_;
+    ImagePool *imagePool_;
     struct LuaStateDeleter {
         void operator()(lua_State *s) const { lua_close(s); }
     };
@@ -48,32 +58,27 @@ private:
 
     void establishLuaState(const char *initScript = nullptr);
 
-    std::unordered_map<NodeId, PinMapping> pinMappings_;
-
-    const std::vector<PinId> *currentInPins_  = nullptr;
-    const std::vector<PinId> *currentOutPins_ = nullptr;
-
-    int envTableRef_ = LUA_NOREF;
+    int envTableRef_      = LUA_NOREF;
+    int slotCastRef_      = LUA_NOREF;
+    bool collectorHeld_   = false;
+    size_t externalBytes_ = 0; // charged while held, since last taken
 
     std::string initScriptResult_;
     void attemptInitScript(const char *initScript);
 
     void establishRootMiraelKeywords();
+    void establishSlotCast();
     void establishEnvTable();
     void pushNewUserData(lua_CFunction indexFn, lua_CFunction newIndexFn, lua_CFunction callFn);
 
     static int l_forbidGlobalNewIndex(lua_State *L);
+    static void pushInputValue(lua_State *L, const ValueBuffer &buf, int n); // input n's value, for input[n] and input()
     static int l_inputIndex(lua_State *L);
     static int l_inputCall(lua_State *L);
     static int l_outputIndex(lua_State *L);
     static int l_outputNewIndex(lua_State *L);
     static int l_outputCall(lua_State *L);
 
-    static bool tryGetPinId(const std::vector<PinId> *pins, int n, PinId &outPinId);
-
-    void setCurrentNode(NodeId nodeId);
-    void forgetNode(NodeId nodeId);
-
     friend Runner;
 };
 
@@ -50,6 +50,15 @@ void Settings::showMiraelSetingsEditor()
     ImGui::Checkbox("Moving a Node", &changeTrackingSettings.moveNode);
     ImGui::Checkbox("Toggling Graph Visiblity", &changeTrackingSettings.graphVisibility);
 
+    ImGui::SeparatorText("Script Compilation");
+
+    if (ImGui::Checkbox("Keep Compiled Scripts Beside Project", &app.getScriptCacheSettings().keepOnDisk))
+        ImGui::MarkIniSettingsDirty(); // kept with the main window's settings, so it lasts between sessions
+    ImGui::SameLine();
+    ImGuiEx::ToolTipHint("Saves the bytecode of compiled scripts to a .mirbc file beside the project, "
+                         "so that loading the project need not compile them again.  Only enable this for projects "
+                         "whose folder you trust, as the bytecode is run in place of the scripts.");
+
     ImGui::SeparatorText("Mirael Style Values");
 
     auto &values = app.getStyle().values;
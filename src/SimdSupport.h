@@ -0,0 +1,44 @@
+#pragma once
+
+/*
+ * What the vectorized kernels (PixelKernels and ArrayKernels) share in picking an instruction set.  On
+ * x64, SSE2 is always available, while AVX2 is detected at runtime, and the functions using it are
+ * marked MIRAEL_TARGET_AVX2 so that the rest of the build needn't assume it.
+ */
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define MIRAEL_SIMD_X64 1
+#include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define MIRAEL_TARGET_AVX2 // MSVC allows the intrinsics of any instruction set without marking the function
+#else
+#define MIRAEL_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+#ifdef MIRAEL_SIMD_X64
+
+namespace Mirael
+{
+
+inline bool cpuHasAvx2()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+    __cpuid(info, 1);
+    const bool osSavesYmm = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6; // OSXSAVE, AVX, and state
+    __cpuidex(info, 7, 0);
+    return osSavesYmm && (info[1] & (1 << 5));
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+} // namespace Mirael
+
+#endif // MIRAEL_SIMD_X64
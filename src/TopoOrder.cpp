@@ -0,0 +1,386 @@
+#include "pch.h"
+
+#include "TopoOrder.h"
+
+using namespace Mirael;
+
+void TopoOrder::addNode(NodeId nodeId)
+{
+    Vertex v;
+    if (!freeVertices_.empty()) {
+        v = freeVertices_.back();
+        freeVertices_.pop_back();
+    } else {
+        v = static_cast<Vertex>(vertices_.size());
+        vertices_.emplace_back();
+        marks_.push_back(0);
+    }
+
+    auto [it, inserted] = indices_.try_emplace(nodeId, v);
+    assert(inserted); // each node may only be added once
+
+    // a node without edges may go anywhere, so it simply goes last
+    auto &info    = vertices_[v];
+    info.nodeId       = nodeId;
+    info.position     = static_cast<uint32_t>(order_.size());
+    info.level        = 0;
+    info.levelChanged = false; // the vertex may still be listed for the node that used it before
+    order_.push_back(v);
+}
+
+void TopoOrder::removeNode(NodeId nodeId)
+{
+    update(); // the node's edge removals may still be queued
+
+    auto it = indices_.find(nodeId);
+    if (it == indices_.end())
+        return;
+
+    const Vertex v = it->second;
+    auto &info     = vertices_[v];
+    assert(info.out.empty() && info.in.empty()); // edges must be removed first
+    assert(std::ranges::none_of(asideEdges_, [v](const Edge &e) { return e.from == v || e.to == v; }));
+
+    order_[info.position] = Invalid;
+    info.position         = NoOrder;
+    holes_++;
+    freeVertices_.push_back(v);
+    indices_.erase(it);
+
+    if (holes_ > 64 && holes_ * 2 > order_.size())
+        compact();
+}
+
+void TopoOrder::addEdge(NodeId from, NodeId to)
+{
+    queued_.push_back(QueuedEdit{.from = getVertex(from), .to = getVertex(to), .add = true});
+}
+
+void TopoOrder::removeEdge(NodeId from, NodeId to)
+{
+    queued_.push_back(QueuedEdit{.from = getVertex(from), .to = getVertex(to), .add = false});
+}
+
+void TopoOrder::update()
+{
+    if (queued_.empty())
+        return;
+    lastVisitedCount_ = 0;
+
+    if (queued_.size() < ResortMinEdits || queued_.size() * ResortNodesPerEdit < indices_.size()) {
+        for (const auto &edit : queued_) {
+            if (edit.add)
+                applyAdd(edit.from, edit.to);
+            else
+                applyRemove(edit.from, edit.to);
+        }
+    } else {
+        // just record the edits, then sort once
+        for (const auto &edit : queued_) {
+            if (edit.add) {
+                vertices_[edit.from].out.push_back(edit.to);
+                vertices_[edit.to].in.push_back(edit.from);
+            } else if (!eraseAside(edit.from, edit.to)) {
+                eraseOne(vertices_[edit.from].out, edit.to);
+                eraseOne(vertices_[edit.to].in, edit.from);
+            }
+        }
+        resort();
+    }
+    queued_.clear();
+}
+
+void TopoOrder::applyAdd(Vertex from, Vertex to)
+{
+    if (!tryIntegrate(from, to))
+        asideEdges_.push_back(Edge{.from = from, .to = to});
+}
+
+void TopoOrder::applyRemove(Vertex from, Vertex to)
+{
+    if (eraseAside(from, to))
+        return; // an edge kept aside was never part of the order, so removing it changes nothing else
+
+    eraseOne(vertices_[from].out, to);
+    eraseOne(vertices_[to].in, from);
+    updateLevelsFrom(to);
+
+    // the removed edge may have been part of every cycle an edge kept aside would close.  Integrating an edge only adds
+    // constraints, so an edge that fails here could not succeed later in the same pass.
+    for (size_t i = 0; i < asideEdges_.size();) {
+        if (tryIntegrate(asideEdges_[i].from, asideEdges_[i].to)) {
+            asideEdges_[i] = asideEdges_.back();
+            asideEdges_.pop_back();
+        } else
+            i++;
+    }
+}
+
+bool TopoOrder::eraseAside(Vertex from, Vertex to)
+{
+    for (size_t i = 0; i < asideEdges_.size(); i++) {
+        if (asideEdges_[i].from == from && asideEdges_[i].to == to) {
+            asideEdges_[i] = asideEdges_.back();
+            asideEdges_.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+
+void TopoOrder::clear()
+{
+    indices_.clear();
+    vertices_.clear();
+    freeVertices_.clear();
+    order_.clear();
+    holes_ = 0;
+    asideEdges_.clear();
+    queued_.clear();
+    levelChanges_.clear();
+    resorted_ = false;
+    marks_.clear();
+}
+
+bool TopoOrder::takeLevelChanges(std::vector<NodeId> &changed)
+{
+    changed.clear();
+    for (auto v : levelChanges_) {
+        auto &info = vertices_[v];
+        if (info.position != NoOrder && info.levelChanged)
+            changed.push_back(info.nodeId);
+        info.levelChanged = false;
+    }
+    levelChanges_.clear();
+
+    const bool complete = !resorted_;
+    resorted_           = false;
+    return complete;
+}
+
+bool TopoOrder::tryIntegrate(Vertex from, Vertex to)
+{
+    if (from == to)
+        return false;
+
+    // the order only has to change if the edge points backwards in it
+    const uint32_t upperBound = vertices_[from].position, lowerBound = vertices_[to].position;
+    if (upperBound > lowerBound) {
+        if (!searchForward(to, upperBound, from))
+            return false;
+        searchBackward(from, lowerBound);
+        reorder();
+    }
+
+    vertices_[from].out.push_back(to);
+    vertices_[to].in.push_back(from);
+    updateLevelsFrom(to);
+    return true;
+}
+
+// Collects into forward_ every node reachable from start that lies before upperBound in the order.  Returns false, with no
+// node left marked, if target is reachable - since target lies at upperBound, any path to it runs entirely through such nodes.
+bool TopoOrder::searchForward(Vertex start, uint32_t upperBound, Vertex target)
+{
+    forward_.clear();
+    stack_.clear();
+    auto visit = [this](Vertex v) {
+        marks_[v] = 1;
+        forward_.push_back(v);
+        stack_.push_back(v);
+    };
+
+    visit(start);
+    while (!stack_.empty()) {
+        const Vertex v = stack_.back();
+        stack_.pop_back();
+        for (auto next : vertices_[v].out) {
+            if (next == target) {
+                lastVisitedCount_ += forward_.size();
+                for (auto f : forward_)
+                    marks_[f] = 0;
+                return false;
+            }
+            if (!marks_[next] && vertices_[next].position < upperBound)
+                visit(next);
+        }
+    }
+
+    lastVisitedCount_ += forward_.size();
+    return true;
+}
+
+// Collects into backward_ every node that reaches start and lies after lowerBound in the order.
+void TopoOrder::searchBackward(Vertex start, uint32_t lowerBound)
+{
+    backward_.clear();
+    stack_.clear();
+    auto visit = [this](Vertex v) {
+        marks_[v] = 1;
+        backward_.push_back(v);
+        stack_.push_back(v);
+    };
+
+    visit(start);
+    while (!stack_.empty()) {
+        const Vertex v = stack_.back();
+        stack_.pop_back();
+        for (auto prev : vertices_[v].in)
+            if (!marks_[prev] && vertices_[prev].position > lowerBound)
+                visit(prev);
+    }
+
+    lastVisitedCount_ += backward_.size();
+}
+
+// Moves the backward set ahead of the forward set, reusing only the positions the two sets already occupy.  Each set keeps its
+// own relative order, so every edge within, into or out of the affected region still points forwards.
+void TopoOrder::reorder()
+{
+    auto byPosition = [this](Vertex v) { return vertices_[v].position; };
+    std::ranges::sort(forward_, {}, byPosition);
+    std::ranges::sort(backward_, {}, byPosition);
+
+    positions_.clear();
+    for (auto v : backward_)
+        positions_.push_back(vertices_[v].position);
+    for (auto v : forward_)
+        positions_.push_back(vertices_[v].position);
+    std::ranges::sort(positions_);
+
+    size_t i   = 0;
+    auto place = [&](Vertex v) {
+        vertices_[v].position   = positions_[i];
+        order_[positions_[i++]] = v;
+        marks_[v]               = 0;
+    };
+    for (auto v : backward_)
+        place(v);
+    for (auto v : forward_)
+        place(v);
+}
+
+// Recomputes levels starting at v, continuing downstream only through nodes whose level actually changed.  Nodes are taken
+// in order, so each is recomputed once, after all of its predecessors.
+void TopoOrder::updateLevelsFrom(Vertex v)
+{
+    auto later = [this](Vertex a, Vertex b) { return vertices_[a].position > vertices_[b].position; }; // makes a min-heap
+
+    heap_.clear();
+    heap_.push_back(v);
+    marks_[v] = 1;
+    while (!heap_.empty()) {
+        std::ranges::pop_heap(heap_, later);
+        const Vertex next = heap_.back();
+        heap_.pop_back();
+        marks_[next] = 0;
+        lastVisitedCount_++;
+
+        auto &info     = vertices_[next];
+        uint32_t level = 0;
+        for (auto prev : info.in)
+            level = std::max(level, vertices_[prev].level + 1);
+        if (level == info.level)
+            continue;
+
+        info.level = level;
+        if (!info.levelChanged) {
+            info.levelChanged = true;
+            levelChanges_.push_back(next);
+        }
+        for (auto succ : info.out) {
+            if (!marks_[succ]) {
+                marks_[succ] = 1;
+                heap_.push_back(succ);
+                std::ranges::push_heap(heap_, later);
+            }
+        }
+    }
+}
+
+// Sorts every node from scratch by Kahn's algorithm, taking the queue in the current order so that nodes keep their relative
+// positions where the edges allow.  Nodes left over are on or downstream of a cycle: they go last, and the edges between them
+// are added back one at a time, so that exactly those closing a cycle end up kept aside.
+void TopoOrder::resort()
+{
+    for (auto e : asideEdges_) {
+        vertices_[e.from].out.push_back(e.to);
+        vertices_[e.to].in.push_back(e.from);
+    }
+    asideEdges_.clear();
+    resorted_ = true;
+
+    inDegrees_.resize(vertices_.size());
+    forward_.clear(); // the sorted nodes
+    for (auto v : order_) {
+        if (v == Invalid)
+            continue;
+        inDegrees_[v]      = static_cast<uint32_t>(vertices_[v].in.size());
+        vertices_[v].level = 0;
+        if (!inDegrees_[v])
+            forward_.push_back(v);
+    }
+
+    for (size_t head = 0; head < forward_.size(); head++) {
+        const auto &info = vertices_[forward_[head]];
+        for (auto next : info.out) {
+            vertices_[next].level = std::max(vertices_[next].level, info.level + 1);
+            if (!--inDegrees_[next])
+                forward_.push_back(next);
+        }
+    }
+
+    backward_.clear(); // the nodes left over
+    for (auto v : order_)
+        if (v != Invalid && inDegrees_[v])
+            backward_.push_back(v);
+
+    lastVisitedCount_ += forward_.size() + backward_.size();
+
+    order_.clear();
+    holes_ = 0;
+    for (auto v : forward_) {
+        vertices_[v].position = static_cast<uint32_t>(order_.size());
+        order_.push_back(v);
+    }
+    for (auto v : backward_) {
+        vertices_[v].position = static_cast<uint32_t>(order_.size());
+        order_.push_back(v);
+    }
+
+    if (backward_.empty())
+        return;
+
+    // edges out of a left over node can only lead to other left over nodes, whose levels so far only count sorted predecessors
+    std::vector<Edge> retry;
+    for (auto v : backward_) {
+        for (auto next : vertices_[v].out) {
+            retry.push_back(Edge{.from = v, .to = next});
+            eraseOne(vertices_[next].in, v);
+        }
+        vertices_[v].out.clear();
+    }
+    for (auto e : retry)
+        applyAdd(e.from, e.to);
+}
+
+void TopoOrder::compact()
+{
+    uint32_t position = 0;
+    for (auto v : order_) {
+        if (v == Invalid)
+            continue;
+        vertices_[v].position = position;
+        order_[position++]    = v;
+    }
+    order_.resize(position);
+    holes_ = 0;
+}
+
+void TopoOrder::eraseOne(std::vector<Vertex> &list, Vertex v)
+{
+    auto it = std::ranges::find(list, v);
+    assert(it != list.end()); // the edge must exist
+    *it = list.back();
+    list.pop_back();
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "data.h"
+
+namespace Mirael
+{
+
+/// <summary>
+/// Incrementally maintains a topological order of a graph's nodes, along with each node's dependency level (the longest path
+/// to it from any source), as nodes and edges are added and removed.
+///
+/// Edge edits are queued, then applied by update().  A few edits are applied one at a time: an added edge that already agrees
+/// with the order costs nothing beyond the level update, otherwise only the nodes whose position lies between the edge's two
+/// ends and that are reachable from (or reach) them are visited and reordered among themselves, per Pearce and Kelly's dynamic
+/// topological sort.  Level changes likewise propagate only as far as levels actually change, and removing an edge never
+/// invalidates the order.  Many edits at once (e.g. loading a graph) are instead applied by one full sort.
+///
+/// Edges that would close a cycle are kept aside, excluded from the order and levels, and retried whenever an edge is removed.
+/// The graph is therefore cyclic exactly while any edge is kept aside.  Parallel edges between the same two nodes are allowed,
+/// each added and removed separately.
+/// </summary>
+class TopoOrder
+{
+public:
+    // nodes must be added before, and removed after, all of their edges
+    void addNode(NodeId nodeId);
+    void removeNode(NodeId nodeId); // applies any queued edits first
+
+    void addEdge(NodeId from, NodeId to);    // queued until update()
+    void removeEdge(NodeId from, NodeId to); // queued until update()
+
+    // applies queued edits - the order, levels and cycle state only reflect edits up to the last update()
+    void update();
+
+    void clear();
+
+    bool hasCycle() const noexcept { return !asideEdges_.empty(); }
+    size_t getNodeCount() const noexcept { return indices_.size(); }
+    uint32_t getLevel(NodeId nodeId) const { return vertices_[getVertex(nodeId)].level; }
+
+    /// <summary>
+    /// Collect the nodes whose level has changed since the last call, for callers that follow the levels incrementally.
+    /// Nodes added since then are not included unless their level changed afterwards, nor are nodes since removed.
+    /// </summary>
+    /// <returns>False if every node's level must be assumed to have changed, because a full sort happened since.</returns>
+    bool takeLevelChanges(std::vector<NodeId> &changed);
+
+    /// <summary>
+    /// Visit every node in topological order.  Only meaningful while !hasCycle().
+    /// </summary>
+    /// <param name="fn">Called as fn(NodeId, uint32_t level).</param>
+    template <typename F> void forEachInOrder(F &&fn) const
+    {
+        for (auto v : order_)
+            if (v != Invalid)
+                fn(vertices_[v].nodeId, vertices_[v].level);
+    }
+
+    // diagnostics - number of nodes visited by the most recent update()
+    size_t getLastVisitedCount() const noexcept { return lastVisitedCount_; }
+
+private:
+    using Vertex                      = uint32_t;
+    static constexpr Vertex Invalid   = UINT32_MAX;
+    static constexpr uint32_t NoOrder = UINT32_MAX;
+
+    // update() sorts from scratch once there are at least this many queued edits, and at least one per this many nodes
+    static constexpr size_t ResortMinEdits = 16, ResortNodesPerEdit = 256;
+
+    struct VertexInfo {
+        NodeId nodeId;
+        uint32_t position = NoOrder; // index into order_
+        uint32_t level    = 0;
+        bool levelChanged = false;   // listed in levelChanges_
+        std::vector<Vertex> out, in; // integrated edges only, one entry per edge
+    };
+
+    struct Edge {
+        Vertex from, to;
+    };
+
+    struct QueuedEdit {
+        Vertex from, to;
+        bool add;
+    };
+
+    std::unordered_map<NodeId, Vertex> indices_;
+    std::vector<VertexInfo> vertices_;
+    std::vector<Vertex> freeVertices_;
+    std::vector<Vertex> order_; // the topological order, with Invalid left where removed nodes used to be
+    size_t holes_ = 0;          // Invalid entries in order_
+    std::vector<Edge> asideEdges_;
+    std::vector<QueuedEdit> queued_;
+    std::vector<Vertex> levelChanges_; // since the last takeLevelChanges()
+    bool resorted_ = false;            // likewise
+
+    // scratch, kept between updates to avoid reallocation
+    std::vector<uint8_t> marks_; // per vertex
+    std::vector<uint32_t> inDegrees_;
+    std::vector<Vertex> stack_, forward_, backward_, heap_;
+    std::vector<uint32_t> positions_;
+    size_t lastVisitedCount_ = 0;
+
+    Vertex getVertex(NodeId nodeId) const { return indices_.at(nodeId); }
+
+    void applyAdd(Vertex from, Vertex to);
+    void applyRemove(Vertex from, Vertex to);
+    bool eraseAside(Vertex from, Vertex to);
+    bool tryIntegrate(Vertex from, Vertex to);
+    bool searchForward(Vertex start, uint32_t upperBound, Vertex target);
+    void searchBackward(Vertex start, uint32_t lowerBound);
+    void reorder();
+    void updateLevelsFrom(Vertex v);
+
+    void resort();
+    void compact();
+
+    static void eraseOne(std::vector<Vertex> &list, Vertex v);
+};
+
+} // namespace Mirael
@@ -1,11 +1,16 @@
 #pragma once
 
+#include <charconv>
+#include <format>
 #include <optional>
 #include <type_traits>
 #include <variant>
 
 #include "lua.hpp"
 
+#include "NativeArray.h"
+#include "NativeImage.h"
+
 namespace Mirael
 {
 
@@ -17,6 +22,26 @@ namespace Mirael
  * updating the value of the ValueBuffers for its Output Pins as desired.  It is valid
  * for a Core to avoid updating the value if it wants, or to read the value that persisted
  * from the previous frame.
+ *
+ * Each buffer also counts its changes in a generation, which the Runner compares between
+ * frames to skip pure cores whose inputs are unchanged.  Setting a trivial value equal to
+ * the current one doesn't count as a change, but setting any lua ref value does, as refs
+ * can't be compared cheaply.  The same goes for images, whose pixels may be written in place.
+ *
+ * Native images and arrays are held by ref as well, but that ref is counted by the image or
+ * array itself, so cores can read them without touching the lua state at all.
+ *
+ * Buffers copying a lua ref value from one another (as a Switch does) share a single registry
+ * ref, rather than each taking its own.  The buffers sharing it are linked in a ring, and only
+ * the last to let go of the value releases the ref - so routing a value from buffer to buffer
+ * never touches the registry, however large the value.
+ *
+ * A buffer belongs to the lua state of the core writing it, which may not be the state of
+ * a core reading it, nor even run on the same thread (see CoreAffinity::AnyLuaState).  So
+ * readers give their own state, and a buffer never touches its own on their behalf: from
+ * another state, trivial values, images and arrays read as they are, strings are copied from the
+ * bytes the buffer keeps a pointer to, and all else (tables, functions...) reads as nil - though
+ * a script reading such a value raises an error instead (see getUncrossableTypeName()).
  */
 class ValueBuffer final
 {
@@ -31,7 +56,14 @@ public:
     ValueBuffer &operator=(ValueBuffer &&)      = delete;
 
     bool isTrivial() const noexcept { return value_.index() <= LastTrivialTypeIndex; }
-    bool isLuaRef() const noexcept { return value_.index() > LastTrivialTypeIndex; }
+    bool isLuaRef() const noexcept { return value_.index() >= FirstLuaRefTypeIndex; }
+
+    // the lua type of a value that can't cross into the reader's state (a table, function...), which it reads as nil - otherwise
+    // nullptr, as all other values read as they are
+    const char *getUncrossableTypeName(lua_State *readerL) const noexcept
+    {
+        return readerL != L && isLuaRef() && !isString() ? getLuaTypeName() : nullptr;
+    }
 
     void clear() { internalSafeSetValue(std::monostate()); }
 
@@ -39,10 +71,49 @@ public:
     void setValue(double other) { internalSafeSetValue(other); }
     void setValue(int other) { internalSafeSetValue(static_cast<double>(other)); }
 
+    void setValue(NativeImage *other) // acquires its own ref to the image
+    {
+        if (!other) {
+            clear();
+            return;
+        }
+        other->retain();
+        internalSafeSetValue(ImageRef{other});
+    }
+
+    void setValue(NativeArray *other) // acquires its own ref to the array
+    {
+        if (!other) {
+            clear();
+            return;
+        }
+        other->retain();
+        internalSafeSetValue(ArrayRef{other});
+    }
+
+    // an array of the given count and type, held by this buffer alone, for a core to write its output into - the buffer's own
+    // array if it alone holds one of that shape, else a new array of zeroes (see NativeArray).  Either way it counts as a change.
+    NativeArray *setWritableArray(int32_t count, NativeArray::Type type)
+    {
+        if (auto *a = std::get_if<ArrayRef>(&value_)) {
+            auto *array = a->array;
+            if (array->getCount() == count && array->getType() == type && array->isUnique()) {
+                generation_++;
+                return array;
+            }
+        }
+        auto *array = NativeArray::create(count, type);
+        if (!array)
+            clear();
+        else
+            internalSafeSetValue(ArrayRef{array}); // takes over the ref created with it
+        return array;
+    }
+
     void setValue(std::string_view other)
     {
         lua_pushlstring(L, other.data(), other.size());
-        internalSafeSetValue(LuaString{luaL_ref(L, LUA_REGISTRYINDEX)});
+        setStringFromLuaStack();
     }
 
     void setValue(const ValueBuffer &other)
@@ -51,30 +122,29 @@ public:
             internalSafeSetValue(other.value_);
             return;
         }
+        if (other.isImage()) {
+            setValue(std::get<ImageRef>(other.value_).image);
+            return;
+        }
+        if (other.isArray()) {
+            setValue(std::get<ArrayRef>(other.value_).array);
+            return;
+        }
+        if (other.L != L) {
+            if (auto *s = std::get_if<LuaString>(&other.value_))
+                setValue(s->view());
+            else
+                clear(); // nothing else crosses between states
+            return;
+        }
+        if (isSharing(other)) {
+            generation_++; // as setting a lua ref value always counts as a change
+            return;
+        }
 
-        // acquire new ref to the other's value
-        std::visit(overloaded{[this]<typename T>(T &base)
-                                  requires std::derived_from<T, LuaRefBase>
-                              { lua_rawgeti(L, LUA_REGISTRYINDEX, base.ref); },
-
-                              [](auto &&) { assert(false); }},
-
-                              other.value_);
-        int newRef = luaL_ref(L, LUA_REGISTRYINDEX);
-
-        // prepare replacement variant
-        value_t newValue = other.value_; // sets proper type efficiently, no destructor risk, other.value_.ref to be replaced
-        std::visit(                      // now set correct ref value
-            overloaded{[&]<typename T>(T &base)
-                           requires std::derived_from<T, LuaRefBase>
-                       { base.ref = newRef; },
-
-                       [](auto &&) { assert(false); }},
-
-                       newValue);
-
-        // set it
-        internalSafeSetValue(newValue);
+        // share the other's ref, rather than take a new one
+        internalSafeSetValue(other.value_);
+        joinSharers(const_cast<ValueBuffer &>(other)); // only its links change, never its value
     }
 
     bool setValueFromLuaStack()
@@ -115,7 +185,7 @@ public:
 
         // ref types automatically pop as part of the luaL_ref() call
         case LUA_TSTRING:
-            internalSafeSetValue(LuaString{luaL_ref(L, LUA_REGISTRYINDEX)});
+            setStringFromLuaStack();
             return true;
         case LUA_TTABLE:
             internalSafeSetValue(LuaTable{luaL_ref(L, LUA_REGISTRYINDEX)});
@@ -130,6 +200,16 @@ public:
             internalSafeSetValue(LuaFullUserData{luaL_ref(L, LUA_REGISTRYINDEX)});
             return true;
         default:
+            if (auto *image = NativeImage::toNativeImage(L, -1)) {
+                lua_pop(L, 1);
+                setValue(image);
+                return true;
+            }
+            if (auto *array = NativeArray::toNativeArray(L, -1)) {
+                lua_pop(L, 1);
+                setValue(array);
+                return true;
+            }
             internalSafeSetValue(LuaOpaqueRef{luaL_ref(L, LUA_REGISTRYINDEX)});
             return true;
         }
@@ -145,25 +225,30 @@ public:
             return true; // lua standard - all but nil and false are considered true
     }
 
-    std::optional<double> toDouble() const
+    // strings only convert given the reader's lua state - without one, as for cores that never touch lua, they yield nullopt
+    std::optional<double> toDouble(lua_State *readerL = nullptr) const
     {
         if (isDouble())
             return std::get<double>(value_);
-        else if (isString()) {
-            lua_rawgeti(L, LUA_REGISTRYINDEX, std::get<LuaString>(value_).ref);
+        else if (isString() && readerL) {
+            const auto &s = std::get<LuaString>(value_);
+            if (readerL == L)
+                lua_rawgeti(L, LUA_REGISTRYINDEX, s.ref);
+            else
+                lua_pushlstring(readerL, s.data, s.size);
             std::optional<double> result{};
-            if (lua_isnumber(L, -1))
-                result = lua_tonumber(L, -1);
-            lua_pop(L, 1);
+            if (lua_isnumber(readerL, -1))
+                result = lua_tonumber(readerL, -1);
+            lua_pop(readerL, 1);
             return result;
         } else
             return std::nullopt;
     }
 
-    std::optional<int> toInt() const
+    std::optional<int> toInt(lua_State *readerL = nullptr) const
     {
         // use saturation math for actual numbers, but nullopt for non-numbers/NaN
-        auto d = toDouble(); // allow strings to convert by reusing toDouble()
+        auto d = toDouble(readerL); // allow strings to convert by reusing toDouble()
         // TODO: can increase efficiency by going straight to int in the string case, but that's low priority for now
         if (!d || std::isnan(*d))
             return std::nullopt;
@@ -175,16 +260,38 @@ public:
             return static_cast<int>(*d); // in range we truncate toward zero, same as C++ and LuaJIT internally
     }
 
-    std::string toString() const // no optional<T> needed - this will always yield a string
+    std::string toString(lua_State *readerL) const // no optional<T> needed - this will always yield a string
     {
-        if (isNil())
-            return "nil";
-        else if (isBool())
-            return std::get<bool>(value_) ? "true" : "false";
+        std::string result;
+        toString(readerL, result);
+        return result;
+    }
+
+    // as above, but overwriting the given string - so a reader converting every frame into the same string reuses its storage
+    void toString(lua_State *readerL, std::string &out) const
+    {
+        if (isNil()) {
+            out = "nil";
+            return;
+        } else if (isBool()) {
+            out = std::get<bool>(value_) ? "true" : "false";
+            return;
+        } else if (auto *s = std::get_if<LuaString>(&value_)) {
+            out = s->view();
+            return;
+        } else if (auto *a = std::get_if<ArrayRef>(&value_)) {
+            describeArray(*a->array, out);
+            return;
+        } else if (isLuaRef() && readerL != L) {
+            out = getLuaTypeName();
+            out += " (in another lua state)";
+            return;
+        }
 
         std::visit(overloaded{
-            [this](double d) { lua_pushnumber(L, d); },       //
-            [this](void *p) { lua_pushlightuserdata(L, p); }, //
+            [readerL](double d) { lua_pushnumber(readerL, d); },       //
+            [readerL](void *p) { lua_pushlightuserdata(readerL, p); }, //
+            [readerL](ImageRef i) { NativeImage::pushLuaView(readerL, i.image); },
 
             [this]<typename T>(T &base)
                 requires std::derived_from<T, LuaRefBase>
@@ -198,40 +305,77 @@ public:
         size_t len = 0;
         // NOTE: we're relying on LuaJIT-specific behavior that isn't in the Lua specification, where
         // it returns "type: 0x..." for non-coercible types.
-        const char *s = lua_tolstring(L, -1, &len);
+        const char *s = lua_tolstring(readerL, -1, &len);
         if (!s)
             s = ""; // TODO: should really flag some kind of live warning when things like this happen
-        std::string result(s, len);
-        lua_pop(L, 1);
-
-        return result;
+        out.assign(s, len);
+        lua_pop(readerL, 1);
     }
 
-    void pushValueToLuaStack() const
+    void pushValueToLuaStack(lua_State *readerL) const
     {
         std::visit(overloaded{
-            [this](std::monostate) { lua_pushnil(L); },
-            [this](bool b) { lua_pushboolean(L, b ? 1 : 0); },
-            [this](double d) { lua_pushnumber(L, d); },
-            [this](void *p) { lua_pushlightuserdata(L, p); },
+            [readerL](std::monostate) { lua_pushnil(readerL); },
+            [readerL](bool b) { lua_pushboolean(readerL, b ? 1 : 0); },
+            [readerL](double d) { lua_pushnumber(readerL, d); },
+            [readerL](void *p) { lua_pushlightuserdata(readerL, p); },
+            [readerL](ImageRef i) { NativeImage::pushLuaView(readerL, i.image); },
+            [readerL](ArrayRef a) { NativeArray::pushLuaView(readerL, a.array); },
+
+            [this, readerL](const LuaString &s) {
+                if (readerL == L)
+                    lua_rawgeti(L, LUA_REGISTRYINDEX, s.ref);
+                else
+                    lua_pushlstring(readerL, s.data, s.size);
+            },
 
-            [this]<typename T>(T &base)
+            [this, readerL]<typename T>(T &base)
                 requires std::derived_from<T, LuaRefBase>
-            { lua_rawgeti(L, LUA_REGISTRYINDEX, base.ref); },
+            {
+                if (readerL == L)
+                    lua_rawgeti(L, LUA_REGISTRYINDEX, base.ref);
+                else
+                    lua_pushnil(readerL);
+            },
 
-            [this](auto &&) {
+            [readerL](auto &&) {
                 assert(false); // shouldn't occur, but we handle it safely just in case
-                lua_pushnil(L);
+                lua_pushnil(readerL);
             },
 
             },
             value_);
     }
 
+    // exchanges values with another buffer - any lua refs simply change owner, and their state goes with them, so no lua calls
+    // are made
+    void swapValue(ValueBuffer &other) noexcept
+    {
+        if (isSharing(other)) {
+            std::swap(generation_, other.generation_); // the values are one and the same
+            return;
+        }
+
+        // each takes the other's place among the buffers sharing its value
+        ValueBuffer *mine   = leaveSharers();
+        ValueBuffer *theirs = other.leaveSharers();
+        std::swap(L, other.L);
+        std::swap(value_, other.value_);
+        std::swap(generation_, other.generation_); // each generation stays with its value
+        if (theirs)
+            joinSharers(*theirs);
+        if (mine)
+            other.joinSharers(*mine);
+    }
+
+    uint64_t getGeneration() const noexcept { return generation_; } // changes whenever the value does
+
     bool isNil() const noexcept { return std::holds_alternative<std::monostate>(value_); }
     bool isBool() const noexcept { return std::holds_alternative<bool>(value_); }
     bool isDouble() const noexcept { return std::holds_alternative<double>(value_); }
     bool isLightUserData() const noexcept { return std::holds_alternative<void *>(value_); }
+    bool isImage() const noexcept { return std::holds_alternative<ImageRef>(value_); }
+    bool isArray() const noexcept { return std::holds_alternative<ArrayRef>(value_); }
     bool isString() const noexcept { return std::holds_alternative<LuaString>(value_); }
     bool isFunction() const noexcept { return std::holds_alternative<LuaFunction>(value_); }
     bool isThread() const noexcept { return std::holds_alternative<LuaThread>(value_); }
@@ -239,13 +383,42 @@ public:
     bool isFullUserData() const noexcept { return std::holds_alternative<LuaFullUserData>(value_); }
     bool isOpaqueRef() const noexcept { return std::holds_alternative<LuaOpaqueRef>(value_); }
 
+    const NativeImage *getImage() const noexcept // nullptr unless the value is an image
+    {
+        auto *i = std::get_if<ImageRef>(&value_);
+        return i ? i->image : nullptr;
+    }
+
+    const NativeArray *getArray() const noexcept // nullptr unless the value is an array
+    {
+        auto *a = std::get_if<ArrayRef>(&value_);
+        return a ? a->array : nullptr;
+    }
+
     void onNewLuaState(lua_State *luaState)
     {
         L = luaState;
         assert(!isLuaRef()); // the buffer should have been cleared before the prior state was destroyed
     }
 
+    // hands the buffer to the core writing it in another (live) state, which must not be running - so its value is cleared
+    void moveToLuaState(lua_State *luaState)
+    {
+        if (luaState == L)
+            return;
+        clear();
+        L = luaState;
+    }
+
 private:
+    struct ImageRef {
+        NativeImage *image; // counted by the image itself
+    };
+
+    struct ArrayRef {
+        NativeArray *array; // counted by the array itself
+    };
+
     struct LuaRefBase {
         int ref;
         explicit LuaRefBase(int r) : ref(r) {}
@@ -255,7 +428,16 @@ private:
         using LuaRefBase::LuaRefBase;
     };
 
-    using LuaString       = LuaRef<LUA_TSTRING>;
+    // lua never moves a string's bytes, so they stay where the ref found them for as long as it holds the string - which lets
+    // cores in other states read them without touching ours
+    struct LuaString : public LuaRefBase {
+        uint32_t size; // packs beside the ref, and lua strings are far shorter anyway
+        const char *data;
+
+        LuaString(int r, const char *d, size_t s) : LuaRefBase(r), size(static_cast<uint32_t>(s)), data(d) {}
+        std::string_view view() const noexcept { return {data, size}; }
+    };
+
     using LuaFunction     = LuaRef<LUA_TFUNCTION>;
     using LuaThread       = LuaRef<LUA_TTHREAD>;
     using LuaTable        = LuaRef<LUA_TTABLE>;
@@ -266,6 +448,8 @@ private:
                                  bool,            // lua bool
                                  double,          // lua number
                                  void *,          // lua light userdata
+                                 ImageRef,        // native image, which lua sees as an FFI cdata view
+                                 ArrayRef,        // native array, likewise
                                  LuaString,       //
                                  LuaFunction,     //
                                  LuaThread,       //
@@ -275,17 +459,93 @@ private:
                                  >;
 
     static constexpr int LastTrivialTypeIndex = 3;
+    static constexpr int FirstLuaRefTypeIndex = 6;
     static_assert(std::is_same_v<std::variant_alternative_t<LastTrivialTypeIndex, value_t>, void *>,
                   "LastTrivialTypeIndex must be in sync with value_t.");
+    static_assert(std::is_same_v<std::variant_alternative_t<FirstLuaRefTypeIndex, value_t>, LuaString>,
+                  "FirstLuaRefTypeIndex must be in sync with value_t.");
     static_assert(std::is_trivially_copyable_v<value_t>, "ValueBuffer::value_t must be trivially copyable.");
 
     template <typename... Ts> struct overloaded : Ts... { // helper for std::visit()
         using Ts::operator()...;
     };
 
+    void setStringFromLuaStack() // pops the string atop the stack
+    {
+        size_t size      = 0;
+        const char *data = lua_tolstring(L, -1, &size);
+        internalSafeSetValue(LuaString{luaL_ref(L, LUA_REGISTRYINDEX), data, size});
+    }
+
+    int getLuaRef() const noexcept // or LUA_NOREF, if the value isn't a lua ref
+    {
+        return std::visit(overloaded{[]<typename T>(const T &base)
+                                         requires std::derived_from<T, LuaRefBase>
+                                     { return base.ref; },
+
+                                     [](auto &&) { return LUA_NOREF; }},
+                          value_);
+    }
+
+    // true if both hold the same ref, which they then share
+    bool isSharing(const ValueBuffer &other) const noexcept
+    {
+        return this == &other || (isLuaRef() && L == other.L && getLuaRef() == other.getLuaRef());
+    }
+
+    void joinSharers(ValueBuffer &sharer) noexcept // of a value just copied from the sharer, having left any others
+    {
+        prevSharer_                     = &sharer;
+        nextSharer_                     = sharer.nextSharer_;
+        sharer.nextSharer_->prevSharer_ = this;
+        sharer.nextSharer_              = this;
+    }
+
+    ValueBuffer *leaveSharers() noexcept // returns another buffer still sharing the value, if any
+    {
+        if (nextSharer_ == this)
+            return nullptr;
+        ValueBuffer *next        = nextSharer_;
+        prevSharer_->nextSharer_ = nextSharer_;
+        nextSharer_->prevSharer_ = prevSharer_;
+        prevSharer_ = nextSharer_ = this;
+        return next;
+    }
+
+    static void describeArray(const NativeArray &array, std::string &out) // its type, count and first few elements
+    {
+        constexpr int32_t MaxShown = 8;
+
+        char number[32];
+        auto append = [&](auto value) { out.append(number, std::to_chars(number, number + sizeof(number), value).ptr); };
+
+        out = NativeArray::getTypeName(array.getType());
+        out += '[';
+        append(array.getCount());
+        out += ']';
+        for (int32_t i = 0; i < std::min(array.getCount(), MaxShown); i++) {
+            out += i ? ", " : ": ";
+            append(array.getElement(i));
+        }
+        if (array.getCount() > MaxShown)
+            out += ", ...";
+    }
+
+    const char *getLuaTypeName() const noexcept
+    {
+        return std::visit(overloaded{[](const LuaString &) { return "string"; },
+                                     [](const LuaFunction &) { return "function"; },
+                                     [](const LuaThread &) { return "thread"; },
+                                     [](const LuaTable &) { return "table"; },
+                                     [](const LuaFullUserData &) { return "userdata"; },
+                                     [](const LuaOpaqueRef &) { return "cdata"; },
+                                     [](auto &&) { return "value"; }},
+                          value_);
+    }
+
     void internalSafeSetValue(value_t newValue)
     {
-        if (isLuaRef())
+        if (isLuaRef() && !leaveSharers()) // the last buffer sharing a ref releases it
             std::visit(overloaded{[this]<typename T>(T &base)
                                       requires std::derived_from<T, LuaRefBase>
                                   { luaL_unref(L, LUA_REGISTRYINDEX, base.ref); },
@@ -294,12 +554,36 @@ private:
 
                                   },
                                   value_);
+        else if (isImage())
+            std::get<ImageRef>(value_).image->release();
+        else if (isArray())
+            std::get<ArrayRef>(value_).array->release();
+
+        if (!isSameTrivialValue(newValue))
+            generation_++;
+        value_ = newValue; // this is the ONLY line of code which should directly modify the value_ member (swapValue() only trades it)
+    }
 
-        value_ = newValue; // this is the ONLY line of code which should directly modify the value_ member
+    bool isSameTrivialValue(const value_t &other) const noexcept
+    {
+        if (other.index() != value_.index())
+            return false;
+        if (auto *b = std::get_if<bool>(&value_))
+            return *b == std::get<bool>(other);
+        if (auto *d = std::get_if<double>(&value_))
+            return *d == std::get<double>(other); // so a NaN always counts as a change
+        if (auto *p = std::get_if<void *>(&value_))
+            return *p == std::get<void *>(other);
+        return isNil();
     }
 
     lua_State *L = nullptr; // traditional name in all examples, which I'm adopting even at odds to the naming standard for members
     value_t value_{};
+    uint64_t generation_ = 0;
+
+    // the ring of buffers sharing this one's lua ref, if any, else just itself
+    ValueBuffer *prevSharer_ = this;
+    ValueBuffer *nextSharer_ = this;
 };
 
 } // namespace Mirael
\ No newline at end of file
@@ -0,0 +1,211 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <span>
+#include <vector>
+
+#include "lua.hpp"
+
+#include "ValueBuffer.h"
+
+namespace Mirael
+{
+
+/// <summary>
+/// Owns a set of ValueBuffers in fixed-size chunks of contiguous storage, each buffer addressed by a stable slot index.
+///
+/// Acquiring or releasing a slot only constructs or destroys a buffer in place and pops or pushes the free list, so once the
+/// arena has grown to fit a graph, adding and removing Output Pins does not touch the heap.  Chunks never move, so a buffer's
+/// address is stable until the next arrangeInOrder(), which permutes the live buffers so that slot order matches a given order
+/// (normally execution order), letting a Frame walk its buffers sequentially through memory.
+/// </summary>
+class ValueBufferArena
+{
+public:
+    using Slot                      = uint32_t;
+    static constexpr Slot ChunkSize = 256;
+
+    explicit ValueBufferArena(lua_State *luaState = nullptr) : L(luaState) {}
+    ~ValueBufferArena()
+    {
+        for (Slot s = 0; s < live_.size(); s++)
+            if (live_[s])
+                buffer(s).~ValueBuffer();
+    }
+
+    // forbid copy/move
+    ValueBufferArena(const ValueBufferArena &)            = delete;
+    ValueBufferArena &operator=(const ValueBufferArena &) = delete;
+    ValueBufferArena(ValueBufferArena &&)                 = delete;
+    ValueBufferArena &operator=(ValueBufferArena &&)      = delete;
+
+    /// <summary>
+    /// Construct a new nil buffer, growing by one chunk only if there is no free slot.
+    /// </summary>
+    /// <returns>The slot of the new buffer.</returns>
+    Slot acquire()
+    {
+        if (free_.empty())
+            grow();
+
+        Slot s = free_.back();
+        free_.pop_back();
+        construct(s);
+        return s;
+    }
+
+    /// <summary>
+    /// Destroy the buffer in the given slot, releasing any lua ref it holds, and make the slot available for reuse.
+    /// </summary>
+    void release(Slot s)
+    {
+        assert(isLive(s));
+        destroy(s);
+        free_.push_back(s); // the free list is unordered from here until the next arrangeInOrder()
+    }
+
+    ValueBuffer &operator[](Slot s)
+    {
+        assert(isLive(s));
+        return buffer(s);
+    }
+
+    const ValueBuffer &operator[](Slot s) const
+    {
+        assert(isLive(s));
+        return const_cast<ValueBufferArena *>(this)->buffer(s);
+    }
+
+    bool isLive(Slot s) const noexcept { return s < live_.size() && live_[s]; }
+    size_t getLiveCount() const noexcept { return liveCount_; }
+    size_t getCapacity() const noexcept { return live_.size(); }
+
+    template <typename F> void forEachLive(F &&fn)
+    {
+        for (Slot s = 0; s < live_.size(); s++)
+            if (live_[s])
+                fn(buffer(s));
+    }
+
+    void onNewLuaState(lua_State *luaState)
+    {
+        L = luaState;
+        forEachLive([this](ValueBuffer &buf) { buf.onNewLuaState(L); });
+    }
+
+    /// <summary>
+    /// Check whether the given live slots already occupy slots 0..n-1 in the given order.
+    /// </summary>
+    static bool isInOrder(std::span<const Slot> order)
+    {
+        for (size_t i = 0; i < order.size(); i++)
+            if (order[i] != i)
+                return false;
+        return true;
+    }
+
+    /// <summary>
+    /// Permute the live buffers so that the buffer formerly in slot order[i] ends up in slot i.  Values move by swapping, so
+    /// lua refs are neither taken nor released.  Addresses of all buffers change; slot indices held by callers must be remapped.
+    /// </summary>
+    /// <param name="order">Every live slot, each exactly once.</param>
+    void arrangeInOrder(std::span<const Slot> order)
+    {
+        assert(order.size() == liveCount_);
+        const Slot count = static_cast<Slot>(order.size());
+
+        // every slot up to the highest live one takes part in the permutation, so the dead ones among them become nil buffers
+        Slot extent = count;
+        for (auto s : order)
+            extent = std::max(extent, s + 1);
+
+        for (Slot s = 0; s < extent; s++)
+            if (!live_[s])
+                construct(s);
+
+        // source_[i] is the slot whose buffer should end up in slot i: the listed slots first, then the nil ones in any order
+        source_.assign(order.begin(), order.end());
+        visited_.assign(extent, 0);
+        for (auto s : order) {
+            assert(!visited_[s]); // each live slot must be listed exactly once
+            visited_[s] = 1;
+        }
+        for (Slot s = 0; s < extent; s++)
+            if (!visited_[s])
+                source_.push_back(s);
+
+        // apply the permutation one cycle at a time
+        std::fill(visited_.begin(), visited_.end(), 0);
+        for (Slot i = 0; i < extent; i++) {
+            for (Slot j = i; !visited_[j];) {
+                visited_[j] = 1;
+                Slot k      = source_[j];
+                if (k == i)
+                    break;
+                buffer(j).swapValue(buffer(k));
+                j = k;
+            }
+        }
+
+        // everything beyond the listed slots now holds nil, and becomes free again
+        for (Slot s = count; s < extent; s++)
+            destroy(s);
+
+        free_.clear();
+        for (Slot s = static_cast<Slot>(live_.size()); s-- > count;)
+            free_.push_back(s); // descending, so the lowest free slot is acquired first
+    }
+
+private:
+    struct alignas(ValueBuffer) Cell {
+        std::byte bytes[sizeof(ValueBuffer)];
+    };
+
+    std::vector<std::unique_ptr<Cell[]>> chunks_;
+    std::vector<uint8_t> live_; // per slot
+    std::vector<Slot> free_;    // used as a stack
+    size_t liveCount_ = 0;
+
+    std::vector<Slot> source_;     // arrangeInOrder() scratch
+    std::vector<uint8_t> visited_; // arrangeInOrder() scratch
+
+    lua_State *L = nullptr; // handed to each buffer as it is constructed
+
+    ValueBuffer &buffer(Slot s) noexcept
+    {
+        return *std::launder(reinterpret_cast<ValueBuffer *>(chunks_[s / ChunkSize][s % ChunkSize].bytes));
+    }
+
+    void construct(Slot s)
+    {
+        assert(!live_[s]);
+        new (chunks_[s / ChunkSize][s % ChunkSize].bytes) ValueBuffer(L);
+        live_[s] = 1;
+        liveCount_++;
+    }
+
+    void destroy(Slot s)
+    {
+        assert(live_[s]);
+        buffer(s).~ValueBuffer();
+        live_[s] = 0;
+        liveCount_--;
+    }
+
+    void grow()
+    {
+        const Slot first = static_cast<Slot>(live_.size());
+        chunks_.push_back(std::make_unique<Cell[]>(ChunkSize));
+        live_.resize(live_.size() + ChunkSize, 0);
+
+        for (Slot s = first + ChunkSize; s-- > first;)
+            free_.push_back(s);
+    }
+};
+
+} // namespace Mirael
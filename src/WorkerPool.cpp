@@ -0,0 +1,85 @@
+#include "pch.h"
+
+#include "FrameTrace.h"
+#include "WorkerPool.h"
+
+namespace Mirael
+{
+
+void WorkerPool::start(size_t workerCount)
+{
+    if (isRunning() || !workerCount)
+        return;
+
+    stopping_.store(false, std::memory_order_relaxed);
+    threads_.reserve(workerCount);
+    for (size_t i = 0; i < workerCount; i++)
+        threads_.emplace_back([this, slot = i + 1]() { workerLoop(slot); });
+}
+
+void WorkerPool::stop()
+{
+    if (!isRunning())
+        return;
+
+    stopping_.store(true, std::memory_order_relaxed);
+    generation_.fetch_add(1, std::memory_order_release);
+    generation_.notify_all();
+
+    threads_.clear(); // joins
+}
+
+void WorkerPool::beginBatch(JobFn fn, void *context, size_t jobCount)
+{
+    assert(unfinished_.load(std::memory_order_relaxed) == 0); // the prior batch must have been finished
+
+    fn_       = fn;
+    context_  = context;
+    jobCount_ = jobCount;
+
+    unfinished_.store(static_cast<int64_t>(jobCount), std::memory_order_relaxed);
+    unclaimed_.store(static_cast<int64_t>(jobCount), std::memory_order_release); // publishes the batch description above
+
+    generation_.fetch_add(1, std::memory_order_release);
+    generation_.notify_all();
+}
+
+void WorkerPool::finishBatch()
+{
+    drain(0);
+
+    while (unfinished_.load(std::memory_order_acquire) > 0)
+        std::this_thread::yield(); // remaining jobs are already running on workers, and frames are short, so we don't park here
+}
+
+void WorkerPool::workerLoop(size_t workerSlot)
+{
+    FrameTrace::setThreadName(std::format("Worker {}", workerSlot));
+    uint32_t seen = generation_.load(std::memory_order_acquire);
+    while (true) {
+        generation_.wait(seen, std::memory_order_acquire);
+        seen = generation_.load(std::memory_order_acquire);
+        if (stopping_.load(std::memory_order_relaxed))
+            return;
+        drain(workerSlot);
+    }
+}
+
+void WorkerPool::drain(size_t workerSlot)
+{
+    // NOTE: the batch description is only read after a successful claim.  A successful claim implies the batch cannot finish
+    // (and therefore cannot be replaced) until this job completes, so a worker that wakes late never sees a torn description.
+
+    while (true) {
+        int64_t claimed = unclaimed_.fetch_sub(1, std::memory_order_acquire);
+        if (claimed <= 0)
+            return;
+
+        size_t jobIndex = jobCount_ - static_cast<size_t>(claimed);
+        fn_(context_, jobIndex, workerSlot);
+
+        unfinished_.fetch_sub(1, std::memory_order_release);
+    }
+}
+
+} // namespace Mirael
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace Mirael
+{
+
+/// <summary>
+/// Implements a small fork-join pool of worker threads used by a Runner to execute independent jobs within a Frame.
+///
+/// One owning thread publishes a batch of jobs with beginBatch(), is free to do other (e.g. Lua-pinned) work meanwhile, then
+/// calls finishBatch(), where it helps drain the batch and returns only once every job has completed.  Idle threads claim the
+/// next unclaimed job with a single atomic decrement, so uneven job costs balance themselves across threads.  All
+/// synchronization is lock-free; sleeping workers are parked on an atomic wait.
+///
+/// Each job receives a worker slot: slot 0 is the owning thread, slots 1..getWorkerCount() are the pool's own threads.  Callers
+/// can use it to index per-thread scratch state.
+/// </summary>
+class WorkerPool
+{
+public:
+    using JobFn = void (*)(void *context, size_t jobIndex, size_t workerSlot);
+
+    WorkerPool() = default;
+    ~WorkerPool() { stop(); }
+
+    // forbid copy/move
+    WorkerPool(const WorkerPool &)            = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+    WorkerPool(WorkerPool &&)                 = delete;
+    WorkerPool &operator=(WorkerPool &&)      = delete;
+
+    void start(size_t workerCount); // does nothing if already running
+    void stop();                    // must not be called while a batch is in progress
+    bool isRunning() const noexcept { return !threads_.empty(); }
+    size_t getWorkerCount() const noexcept { return threads_.size(); }
+
+    // owning thread methods - batches must strictly alternate begin/finish
+    void beginBatch(JobFn fn, void *context, size_t jobCount);
+    void finishBatch();
+
+private:
+    std::vector<std::jthread> threads_;
+
+    // batch description, written only by the owning thread while no job of the prior batch can still be claimed
+    JobFn fn_        = nullptr;
+    void *context_   = nullptr;
+    size_t jobCount_ = 0;
+
+    static constexpr size_t align_sz = 64; // std::hardware_destructive_interference_size; // but we're avoiding include <new>
+
+    alignas(align_sz) std::atomic<int64_t> unclaimed_{0}; // jobs left to claim - goes negative as late claimers overshoot
+    alignas(align_sz) std::atomic<int64_t> unfinished_{0}; // jobs claimed or unclaimed that have not yet completed
+    alignas(align_sz) std::atomic<uint32_t> generation_{0}; // bumped per batch (and on stop) to wake parked workers
+    std::atomic<bool> stopping_ = false;
+
+    void workerLoop(size_t workerSlot);
+    void drain(size_t workerSlot);
+};
+
+} // namespace Mirael
@@ -0,0 +1,97 @@
+#include "pch.h"
+
+#include "imgui.h"
+#include "ine/imgui_node_editor.h"
+
+#include "Array.h"
+#include "data.h"
+#include "NodeEditorEx.h"
+
+namespace ne = ax::NodeEditor;
+
+namespace Mirael::NodeTypes
+{
+
+void Array::onDeserialize(const nlohmann::json &j) { settings_ = Cores::ArrayCore::readSettings(j); }
+
+void Array::onInit() { addPins(Cores::ArrayCore::getPinKeys(settings_.op)); }
+
+void Array::onOrderPins(std::vector<PinId> &pinOrder)
+{
+    const auto keys = Cores::ArrayCore::getPinKeys(settings_.op);
+    orderPins(getPinIds(keys), pinOrder);
+    outPinIndex_ = keys.inputs.size();
+}
+
+void Array::onShow()
+{
+    auto pins        = std::span{getPinOrder()};
+    const auto &info = Cores::ArrayCore::getOpInfo(settings_.op);
+    auto getPinLabel = [&info](size_t index, PinDirection dir) {
+        return dir == PinDirection::Output ? "out" : index == 0 ? "a" : info.pins[index - 1];
+    };
+
+    NodeEditorEx::StandardNode(
+        *this,                                                      // node
+        [&info]() -> void { ImGui::Text("Array: %s", info.name); }, // header UI
+        pins.subspan(0, outPinIndex_),                              // input pin order
+        pins.subspan(outPinIndex_),                                 // output pin order
+        [&getPinLabel](size_t index, PinId id, PinDirection dir) -> float { return ImGui::CalcTextSize(getPinLabel(index, dir)).x; },
+        [&getPinLabel](size_t index, PinId id, PinDirection dir) -> void { ImGui::TextUnformatted(getPinLabel(index, dir)); });
+}
+
+void Array::onSerialize(nlohmann::json &j) const { Cores::ArrayCore::writeSettings(settings_, j); }
+
+void Array::onShowProperties()
+{
+    bool changed = false;
+
+    if (ImGui::BeginCombo("Op", Cores::ArrayCore::getOpInfo(settings_.op).name)) {
+        for (size_t i = 0; i < std::size(Cores::ArrayCore::Ops); i++) {
+            const auto op = static_cast<Op>(i);
+            if (ImGui::Selectable(Cores::ArrayCore::Ops[i].name, op == settings_.op) && op != settings_.op) {
+                changeOp(op);
+                changed = true;
+            }
+        }
+        ImGui::EndCombo();
+    }
+
+    // the numbers an op uses where their pins give none
+    switch (settings_.op) {
+    case Op::Scale:
+        changed |= ImGui::InputDouble("k", &settings_.params.k);
+        break;
+    case Op::Lerp:
+        changed |= ImGui::InputDouble("t", &settings_.params.t);
+        break;
+    case Op::Map:
+        changed |= ImGui::InputDouble("lo", &settings_.params.lo);
+        changed |= ImGui::InputDouble("hi", &settings_.params.hi);
+        break;
+    default:
+        break;
+    }
+
+    if (changed) {
+        raiseModified(ChangeImpact::NodeConfig);
+        postConfig();
+    }
+}
+
+void Array::changeOp(Op op)
+{
+    // a pin the old and new ops share (always at the same index, as with b) is kept, along with its links
+    const auto &oldKeys = Cores::ArrayCore::getOpInfo(settings_.op).pins, &newKeys = Cores::ArrayCore::getOpInfo(op).pins;
+    for (size_t i = 0; i < oldKeys.size(); i++) {
+        if (oldKeys[i] && newKeys[i] && !std::strcmp(oldKeys[i], newKeys[i]))
+            continue;
+        if (oldKeys[i])
+            removePin(oldKeys[i]);
+        if (newKeys[i])
+            addPin(newKeys[i], {.direction = PinDirection::Input});
+    }
+    settings_.op = op;
+}
+
+} // namespace Mirael::NodeTypes
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "ArrayCore.h"
+#include "Node.h"
+
+namespace Mirael::NodeTypes
+{
+
+class Array : public Node
+{
+public:
+    static const char *typeName() { return "array"; }
+
+protected:
+    void onDeserialize(const nlohmann::json &j) override;
+    void onInit() override;
+    void onOrderPins(std::vector<PinId> &pinOrder) override;
+    void onShow() override;
+    void onSerialize(nlohmann::json &j) const override;
+
+    void onShowProperties() override;
+
+    using Op       = Cores::ArrayCore::Op;
+    using Settings = Cores::ArrayCore::Settings;
+    using Config   = Cores::ArrayCore::Config;
+    using Channel  = Cores::ArrayCore::Channel;
+
+    virtual std::unique_ptr<NodeCore> createCore()
+    {
+        return Cores::ArrayCore::create(settings_, getPinIds(Cores::ArrayCore::getPinKeys(settings_.op)), channel_);
+    }
+
+private:
+    std::shared_ptr<Channel> channel_ = std::make_shared<Channel>();
+    Config buildConfig() const
+    {
+        return Cores::ArrayCore::buildConfig(settings_, getPinIds(Cores::ArrayCore::getPinKeys(settings_.op)));
+    }
+    void postConfig() { channel_->pendingConfig.postNew(std::make_unique<Config>(buildConfig())); }
+
+    Settings settings_{};
+    size_t outPinIndex_{};
+    void changeOp(Op op); // swapping the op's pins for those of the new op
+};
+
+} // namespace Mirael::NodeTypes
@@ -0,0 +1,149 @@
+#include "pch.h"
+
+#include "ArrayCore.h"
+#include "ArrayKernels.h"
+
+namespace Mirael::NodeTypes::Cores
+{
+
+ArrayCore::Settings ArrayCore::readSettings(const nlohmann::json &j)
+{
+    Settings settings;
+    settings.op        = parseOpName(j.value("op", getOpInfo(settings.op).name).c_str()).value_or(settings.op);
+    settings.params.k  = j.value("k", settings.params.k);
+    settings.params.t  = j.value("t", settings.params.t);
+    settings.params.lo = j.value("lo", settings.params.lo);
+    settings.params.hi = j.value("hi", settings.params.hi);
+    return settings;
+}
+
+void ArrayCore::writeSettings(const Settings &settings, nlohmann::json &j)
+{
+    j["op"] = getOpInfo(settings.op).name;
+    j["k"]  = settings.params.k;
+    j["t"]  = settings.params.t;
+    j["lo"] = settings.params.lo;
+    j["hi"] = settings.params.hi;
+}
+
+NodePinKeys ArrayCore::getPinKeys(Op op)
+{
+    NodePinKeys keys{.inputs = {"a"}, .outputs = {"out"}};
+    for (auto key : getOpInfo(op).pins)
+        if (key)
+            keys.inputs.emplace_back(key);
+    return keys;
+}
+
+ArrayCore::Config ArrayCore::buildConfig(const Settings &settings, const NodePins &pins)
+{
+    Config config{.op = settings.op, .aPin = pins.inputs.at(0), .outPin = pins.outputs.at(0), .opPins = {}, .params = settings.params};
+    const auto &keys = getOpInfo(settings.op).pins;
+    for (size_t i = 0, next = 1; i < keys.size(); i++)
+        if (keys[i])
+            config.opPins[i] = pins.inputs.at(next++);
+    return config;
+}
+
+void ArrayCore::onFrame(const RunContext &context)
+{
+    acceptLatestConfig();
+
+    auto output = context.getOutput(config_.outPin);
+    if (!output)
+        return;
+
+    auto aBuf     = context.getFirstInput(config_.aPin);
+    const auto *a = aBuf ? aBuf->getArray() : nullptr;
+    if (!a) {
+        output->clear();
+        return;
+    }
+
+    switch (config_.op) {
+        using enum Op;
+
+    case Add:
+    case Mul:
+    case Lerp: {
+        auto bBuf     = context.getFirstInput(config_.opPins[0]);
+        const auto *b = bBuf ? bBuf->getArray() : nullptr;
+        if (b) {
+            const auto &bAsA = convert(*b, a->getType());
+            auto *out        = output->setWritableArray(std::min(a->getCount(), b->getCount()), a->getType());
+            if (!out)
+                return;
+            if (config_.op == Add)
+                ArrayKernels::add(*out, *a, bAsA);
+            else if (config_.op == Mul)
+                ArrayKernels::mul(*out, *a, bAsA);
+            else
+                ArrayKernels::lerp(*out, *a, bAsA, getParam(context, 1, config_.params.t));
+            return;
+        }
+
+        auto bNumber = bBuf && config_.op != Lerp ? bBuf->toDouble() : std::nullopt;
+        if (!bNumber) {
+            output->clear();
+            return;
+        }
+        if (auto *out = output->setWritableArray(a->getCount(), a->getType()))
+            ArrayKernels::affine(*out, *a, config_.op == Mul ? *bNumber : 1, config_.op == Add ? *bNumber : 0);
+        return;
+    }
+
+    case Scale:
+    case Map: {
+        auto *out = output->setWritableArray(a->getCount(), a->getType());
+        if (!out)
+            return;
+        if (config_.op == Scale) {
+            ArrayKernels::affine(*out, *a, getParam(context, 0, config_.params.k), 0);
+        } else {
+            const double lo = getParam(context, 0, config_.params.lo), hi = getParam(context, 1, config_.params.hi);
+            ArrayKernels::affine(*out, *a, hi - lo, lo);
+        }
+        return;
+    }
+
+    case Sum:
+        output->setValue(ArrayKernels::sum(*a));
+        return;
+
+    case Min:
+    case Max:
+        if (auto result = config_.op == Min ? ArrayKernels::min(*a) : ArrayKernels::max(*a))
+            output->setValue(*result);
+        else
+            output->clear();
+        return;
+
+    default:
+        assert(false); // should have handled all ops above
+        output->clear();
+        break;
+    }
+}
+
+double ArrayCore::getParam(const RunContext &context, int index, double fallback) const
+{
+    auto buf = context.getFirstInput(config_.opPins[index]);
+    return buf ? buf->toDouble().value_or(fallback) : fallback;
+}
+
+const NativeArray &ArrayCore::convert(const NativeArray &array, NativeArray::Type type)
+{
+    if (array.getType() == type)
+        return array;
+
+    // the converted copy is this core's alone, so is rewritten in place while the shape holds
+    if (!converted_ || converted_->getCount() != array.getCount() || converted_->getType() != type) {
+        if (converted_)
+            converted_->release();
+        converted_ = NativeArray::create(array.getCount(), type);
+    }
+    ArrayKernels::convert(*converted_, array);
+    return *converted_;
+}
+
+} // namespace Mirael::NodeTypes::Cores
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <array>
+#include <cstring>
+#include <memory>
+#include <optional>
+
+#include <nlohmann/json.hpp>
+
+#include "Mailbox.h"
+#include "NativeArray.h"
+#include "NodeCore.h"
+
+namespace Mirael::NodeTypes::Cores
+{
+
+class ArrayCore : public NodeCore
+{
+public:
+    enum class Op {
+        Add,   // out = a + b, for b an array or a number
+        Mul,   // out = a * b, likewise
+        Scale, // out = a * k
+        Lerp,  // out = a + (b - a) * t
+        Map,   // out = lo + a * (hi - lo), mapping 0..1 onto lo..hi
+        Sum,   // out = the sum of a's elements, as a number
+        Min,   // out = the least of a's elements (skipping NaNs), or nil if a is empty
+        Max,   // out = the greatest, likewise
+    };
+
+    struct OpInfo {
+        const char *name;
+        std::array<const char *, 2> pins; // the keys of the op's inputs besides "a", in order (nullptr where it has fewer)
+    };
+
+    static constexpr OpInfo Ops[] = {
+        {"add", {"b"}},         //
+        {"mul", {"b"}},         //
+        {"scale", {"k"}},       //
+        {"lerp", {"b", "t"}},   //
+        {"map", {"lo", "hi"}},  //
+        {"sum", {}},            //
+        {"min", {}},            //
+        {"max", {}},            //
+    };
+
+    static const OpInfo &getOpInfo(Op op) noexcept { return Ops[static_cast<int>(op)]; }
+
+    static std::optional<Op> parseOpName(const char *name) noexcept
+    {
+        for (size_t i = 0; i < std::size(Ops); i++)
+            if (!std::strcmp(name, Ops[i].name))
+                return static_cast<Op>(i);
+        return std::nullopt;
+    }
+
+    struct Params { // the op's numbers, used where their pins are unconnected or don't give a number
+        double k = 1, t = 0.5, lo = 0, hi = 1;
+    };
+
+    struct Config {
+        Op op = Op::Add;
+        PinId aPin, outPin;
+        std::array<PinId, 2> opPins; // as OpInfo::pins, 0 where the op has fewer
+        Params params;
+    };
+
+    struct Channel {
+        Mailbox<Config> pendingConfig;
+    };
+
+    struct Settings { // the node's saved config, from which its pins and Config follow
+        Op op = Op::Add;
+        Params params;
+    };
+
+    // the node's saved config and pins, shared by the Array node and headless graphs
+    static Settings readSettings(const nlohmann::json &j); // keys missing from j keep their defaults
+    static void writeSettings(const Settings &settings, nlohmann::json &j);
+    static NodePinKeys getPinKeys(Op op); // a, then the op's pins
+    static Config buildConfig(const Settings &settings, const NodePins &pins);
+    static std::unique_ptr<ArrayCore> create(const Settings &settings, const NodePins &pins, std::shared_ptr<Channel> channel)
+    {
+        return std::make_unique<ArrayCore>(buildConfig(settings, pins), std::move(channel));
+    }
+
+    ArrayCore(Config &&initialConfig, std::shared_ptr<Channel> channel) : config_(std::move(initialConfig)), channel_(channel) {}
+    ~ArrayCore() override
+    {
+        if (converted_)
+            converted_->release();
+    }
+
+protected:
+    void onFrame(const RunContext &context) override;
+    CoreAffinity getAffinity() const override { return CoreAffinity::Any; } // only ever reads and writes numbers and arrays
+    bool isPure() const override { return true; }
+    bool hasPendingChanges() const override { return channel_->pendingConfig.hasPending(); }
+
+private:
+    Config config_;
+    std::shared_ptr<Channel> channel_;
+    NativeArray *converted_ = nullptr; // kept between frames, for an array b of another type than a
+
+    void acceptLatestConfig()
+    {
+        if (auto taken = channel_->pendingConfig.tryAcceptLatest())
+            config_ = std::move(*taken);
+    }
+
+    double getParam(const RunContext &context, int index, double fallback) const;
+    const NativeArray &convert(const NativeArray &array, NativeArray::Type type);
+};
+
+} // namespace Mirael::NodeTypes::Cores
@@ -10,17 +10,9 @@ namespace ne = ax::NodeEditor;
 namespace Mirael::NodeTypes
 {
 
-void Mirael::NodeTypes::Counter::onDeserialize(const nlohmann::json &j)
-{
-    config_.step     = j["step"].get<value_t>();
-    config_.clipMin  = j["clipMin"].get<bool>();
-    config_.clipMax  = j["clipMax"].get<bool>();
-    config_.minValue = j["min"].get<value_t>();
-    config_.maxValue = j["max"].get<value_t>();
-    config_.wrap     = j["wrap"].get<bool>();
-}
+void Mirael::NodeTypes::Counter::onDeserialize(const nlohmann::json &j) { config_ = Cores::CounterCore::readConfig(j); }
 
-void Counter::onInit() { outPinId_ = addPin("out", {.direction = PinDirection::Output}); }
+void Counter::onInit() { outPinId_ = addPins(Cores::CounterCore::getPinKeys()).outputs.front(); }
 
 void Counter::onShow()
 {
@@ -35,15 +27,7 @@ void Counter::onShow()
     ne::EndNode();
 }
 
-void Counter::onSerialize(nlohmann::json &j) const
-{
-    j["step"]    = config_.step;
-    j["clipMin"] = config_.clipMin;
-    j["clipMax"] = config_.clipMax;
-    j["min"]     = config_.minValue;
-    j["max"]     = config_.maxValue;
-    j["wrap"]    = config_.wrap;
-}
+void Counter::onSerialize(nlohmann::json &j) const { Cores::CounterCore::writeConfig(config_, j); }
 
 void Counter::onShowProperties()
 {
@@ -59,33 +43,4 @@ void Counter::onShowProperties()
         postConfig();
 }
 
-void Counter::Core::onFrame(const RunContext &context)
-{
-    acceptLatestConfig(); // gets latest config from the channel (if any)
-
-    // TODO: note: the below logic is flawed - but not worth resolving at the moment because this is a temporary/throwaway node type
-    value_ += config_.step;
-    const value_t range = 1 + config_.maxValue - config_.minValue;
-    if (config_.clipMax && value_ > config_.maxValue) {
-        if (config_.wrap)
-            value_ -= range;
-        else
-            value_ = config_.maxValue;
-    }
-    if (config_.clipMin && value_ < config_.minValue) {
-        if (config_.wrap)
-            value_ += range;
-        else
-            value_ = config_.minValue;
-    }
-
-    putValue(); // puts updated value on the channel for the UI to display
-
-    // now we need to write to the output buffer
-    auto outBufferPtr = context.outputs.at(outPinId_);
-    assert(outBufferPtr); // should have been created by the Runner before onFrame() was called
-    auto &outBuffer = *outBufferPtr;
-    outBuffer.setValue(value_);
-}
-
 } // namespace Mirael::NodeTypes
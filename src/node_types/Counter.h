@@ -1,10 +1,7 @@
 #pragma once
 
-#include <atomic>
-#include <limits>
-
+#include "CounterCore.h"
 #include "Node.h"
-#include "Mailbox.h"
 
 namespace Mirael::NodeTypes
 {
@@ -12,7 +9,7 @@ namespace Mirael::NodeTypes
 class Counter : public Node
 {
 public:
-    using value_t = int;
+    using value_t = Cores::CounterCore::value_t;
 
     static const char *typeName() { return "counter"; }
 
@@ -24,43 +21,12 @@ protected:
 
     void onShowProperties() override;
 
-    struct Config {
-        value_t step     = 1;
-        value_t minValue = std::numeric_limits<value_t>::min(), maxValue = std::numeric_limits<value_t>::max();
-        bool clipMin = false, clipMax = false, wrap = true;
-    };
-
-    struct Channel {
-        std::atomic<value_t> value;
-        Mailbox<Config> pendingConfig{};
-    };
-
-    class Core : public NodeCore
-    {
-    public:
-        Core(PinId outPinId, std::shared_ptr<Channel> channel) : outPinId_(outPinId), channel_(std::move(channel)) {}
-
-    protected:
-        void onFrame(const RunContext &context) override;
-
-    private:
-        PinId outPinId_;
-        std::shared_ptr<Channel> channel_;
-        value_t value_ = 0;
-        Config config_;
-
-        void acceptLatestConfig()
-        {
-            if (auto taken = channel_->pendingConfig.tryAcceptLatest())
-                config_ = *taken;
-        }
-        void putValue() { channel_->value.store(value_, std::memory_order_relaxed); }
-    };
+    using Config  = Cores::CounterCore::Config;
+    using Channel = Cores::CounterCore::Channel;
 
     std::unique_ptr<NodeCore> createCore()
     {
-        postConfig();
-        return std::make_unique<Core>(outPinId_, channel_);
+        return Cores::CounterCore::create(config_, getPinIds(Cores::CounterCore::getPinKeys()), channel_);
     };
 
 private:
@@ -0,0 +1,63 @@
+#include "pch.h"
+
+#include "CounterCore.h"
+
+namespace Mirael::NodeTypes::Cores
+{
+
+CounterCore::Config CounterCore::readConfig(const nlohmann::json &j)
+{
+    Config config;
+    config.step     = j.value("step", config.step);
+    config.clipMin  = j.value("clipMin", config.clipMin);
+    config.clipMax  = j.value("clipMax", config.clipMax);
+    config.minValue = j.value("min", config.minValue);
+    config.maxValue = j.value("max", config.maxValue);
+    config.wrap     = j.value("wrap", config.wrap);
+    return config;
+}
+
+void CounterCore::writeConfig(const Config &config, nlohmann::json &j)
+{
+    j["step"]    = config.step;
+    j["clipMin"] = config.clipMin;
+    j["clipMax"] = config.clipMax;
+    j["min"]     = config.minValue;
+    j["max"]     = config.maxValue;
+    j["wrap"]    = config.wrap;
+}
+
+std::unique_ptr<CounterCore> CounterCore::create(const Config &config, const NodePins &pins, std::shared_ptr<Channel> channel)
+{
+    channel->pendingConfig.postNew(std::make_unique<Config>(config)); // taken on the core's first frame
+    return std::make_unique<CounterCore>(pins.outputs.at(0), std::move(channel));
+}
+
+void CounterCore::onFrame(const RunContext &context)
+{
+    acceptLatestConfig(); // gets latest config from the channel (if any)
+
+    // TODO: note: the below logic is flawed - but not worth resolving at the moment because this is a temporary/throwaway node type
+    value_ += config_.step;
+    const value_t range = 1 + config_.maxValue - config_.minValue;
+    if (config_.clipMax && value_ > config_.maxValue) {
+        if (config_.wrap)
+            value_ -= range;
+        else
+            value_ = config_.maxValue;
+    }
+    if (config_.clipMin && value_ < config_.minValue) {
+        if (config_.wrap)
+            value_ += range;
+        else
+            value_ = config_.minValue;
+    }
+
+    putValue(); // puts updated value on the channel for the UI to display
+
+    // now we need to write to the output buffer, which can be missing until the Runner adopts a plan that includes it
+    if (auto outBufferPtr = context.getOutput(outPinId_))
+        outBufferPtr->setValue(value_);
+}
+
+} // namespace Mirael::NodeTypes::Cores
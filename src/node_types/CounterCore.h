@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <limits>
+#include <memory>
+
+#include <nlohmann/json.hpp>
+
+#include "Mailbox.h"
+#include "NodeCore.h"
+
+namespace Mirael::NodeTypes::Cores
+{
+
+class CounterCore : public NodeCore
+{
+public:
+    using value_t = int;
+
+    struct Config {
+        value_t step     = 1;
+        value_t minValue = std::numeric_limits<value_t>::min(), maxValue = std::numeric_limits<value_t>::max();
+        bool clipMin = false, clipMax = false, wrap = true;
+    };
+
+    struct Channel {
+        std::atomic<value_t> value;
+        Mailbox<Config> pendingConfig{};
+    };
+
+    // the node's saved config and pins, shared by the Counter node and headless graphs
+    static Config readConfig(const nlohmann::json &j); // keys missing from j keep their defaults
+    static void writeConfig(const Config &config, nlohmann::json &j);
+    static NodePinKeys getPinKeys() { return {.inputs = {}, .outputs = {"out"}}; }
+    static std::unique_ptr<CounterCore> create(const Config &config, const NodePins &pins, std::shared_ptr<Channel> channel);
+
+    CounterCore(PinId outPinId, std::shared_ptr<Channel> channel) : outPinId_(outPinId), channel_(std::move(channel)) {}
+
+protected:
+    void onFrame(const RunContext &context) override;
+    CoreAffinity getAffinity() const override { return CoreAffinity::Any; } // only ever writes a trivial value
+
+private:
+    PinId outPinId_;
+    std::shared_ptr<Channel> channel_;
+    value_t value_ = 0;
+    Config config_;
+
+    void acceptLatestConfig()
+    {
+        if (auto taken = channel_->pendingConfig.tryAcceptLatest())
+            config_ = *taken;
+    }
+    void putValue() { channel_->value.store(value_, std::memory_order_relaxed); }
+};
+
+} // namespace Mirael::NodeTypes::Cores
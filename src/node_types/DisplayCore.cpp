@@ -0,0 +1,128 @@
+#include "pch.h"
+
+#include <cstring>
+
+#include "DisplayCore.h"
+
+namespace Mirael::NodeTypes::Cores
+{
+
+void DisplayCore::onFrame(const RunContext &context)
+{
+    L = context.L;
+
+    auto vbuf = context.getFirstInput(inPinId_); // may return nullptr
+    auto info = getValueInfo(vbuf);              // this is safe, as getValueInfo accepts nullptr
+
+    switch (info.kind) {
+        using enum DataKind;
+
+    case None:
+        // intentional nop/fallthrough to end
+        break;
+
+    case String: {
+        assert(vbuf); // info.Kind should not be String unless vbuf is not null
+        auto &sbuf = channel_->stringBuffer;
+        vbuf->toString(L, sbuf.getWriteSlot()); // into the slot's own storage, so that steady frames don't allocate
+        sbuf.commitWrite();
+        channel_->dataKind.store(DataKind::String, std::memory_order_release);
+        return;
+    }
+
+    case Image: {
+        acceptLatestBufferCarrier();
+        auto buffer = currentBufferCarrier_ ? currentBufferCarrier_->buffer : nullptr;
+        bool ready  = buffer && buffer->dim == info.dim;
+        if (ready) {
+            auto &slot              = buffer->images.getWriteSlot();
+            auto *dest              = static_cast<uint8_t *>(slot.mapped);          // uses rowPitch
+            auto *src               = static_cast<const uint8_t *>(info.pixelData); // uses pixelPitch
+            const uint32_t rowBytes = info.dim.width * 4;
+            const auto *end         = dest + info.dim.height * slot.rowPitch;
+            for (; dest < end; dest += slot.rowPitch, src += info.pixelPitch)
+                std::memcpy(dest, src, rowBytes);
+            slot.written = true;
+            // the above assumes no row padding, which the UI is currently expected to ensure
+            buffer->images.commitWrite();
+            requestedDimensions_.reset();
+        } else {
+            currentBufferCarrier_ = nullptr;
+            // the node only acts on the latest request, so the same one isn't posted again (which would allocate every frame)
+            // while it waits for the node's answer
+            if (requestedDimensions_ != info.dim) {
+                channel_->pendingDimensions.postNew(std::make_unique<Dimensions>(info.dim));
+                requestedDimensions_ = info.dim;
+            }
+        }
+        channel_->dataKind.store(DataKind::Image, std::memory_order_release);
+        return;
+    }
+
+    default:
+        assert(false); // should have handled all possibilities above
+        break;
+    }
+
+    // set kind = none if we didn't set otherwise and return above
+    channel_->dataKind.store(DataKind::None, std::memory_order_release);
+}
+
+DisplayCore::ValueInfo DisplayCore::getValueInfo(const ValueBuffer *vbuf)
+{
+    ValueInfo info = {.kind = DataKind::None};
+
+    if (!vbuf)
+        return info;
+
+    info.kind = DataKind::String; // we display everything but images as a string
+
+    if (const auto *image = vbuf->getImage()) { // native images need no lua at all
+        info.dim.width  = static_cast<Dimensions::dim_t>(image->getWidth());
+        info.dim.height = static_cast<Dimensions::dim_t>(image->getHeight());
+        info.kind       = DataKind::Image;
+        info.pixelData  = image->getPixels();
+        info.pixelPitch = static_cast<uint32_t>(image->getStride());
+        return info;
+    }
+
+    if (!vbuf->isTable()) // otherwise only image tables, as projects made before native images may still define
+        return info;
+
+    auto entryTop = lua_gettop(L);
+
+    vbuf->pushValueToLuaStack(L); // [value]
+    if (!lua_istable(L, -1)) {    // as tables in another lua state read as nil
+        lua_pop(L, 1);
+        return info;
+    }
+
+    lua_getfield(L, -1, "_tag"); // [value, _tag]
+    auto tag = lua_tostring(L, -1);
+    if (!tag || std::strcmp(tag, "image")) { // TODO: can the strcmp be done faster since lua interns strings?
+        lua_pop(L, 2);
+        assert(lua_gettop(L) == entryTop);
+        return info;
+    }
+
+    lua_getfield(L, -2, "w"); // [value, _tag, w]
+    int w = static_cast<int>(lua_tointeger(L, -1));
+    lua_getfield(L, -3, "h"); // [value, _tag, w, h]
+    int h = static_cast<int>(lua_tointeger(L, -1));
+    lua_getfield(L, -4, "buf");              // [value, _tag, w, h, buf]
+    const void *pbuf = lua_topointer(L, -1); // TODO: need a safer approach - a user could put non-cdata/non-GC values here
+    lua_pop(L, 5);
+    assert(lua_gettop(L) == entryTop);
+
+    if (pbuf && w > 0 && h > 0 && w <= 2000 && h <= 2000) { // TODO: handle these maximums better - for now this is a sanity limit
+        info.dim.width  = static_cast<Dimensions::dim_t>(w);
+        info.dim.height = static_cast<Dimensions::dim_t>(h);
+        info.kind       = DataKind::Image;
+        info.pixelData  = pbuf;
+        info.pixelPitch = info.dim.width * 4; // image tables are always packed
+    }
+
+    return info;
+}
+
+} // namespace Mirael::NodeTypes::Cores
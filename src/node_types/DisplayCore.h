@@ -0,0 +1,119 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "lua.hpp"
+
+#include "Mailbox.h"
+#include "NodeCore.h"
+#include "TripleBuffer.h"
+
+namespace Mirael::NodeTypes::Cores
+{
+
+class DisplayCore : public NodeCore
+{
+public:
+    struct Dimensions {
+        using dim_t = uint32_t;
+        dim_t width, height;
+        bool operator==(const Dimensions &) const = default;
+    };
+
+    struct Image {
+        ~Image()
+        {
+            if (cleanup)
+                cleanup();
+            cleanup = nullptr;
+            mapped  = nullptr;
+#ifndef MIRAEL_HEADLESS
+            descriptor = VK_NULL_HANDLE;
+#endif
+        }
+#ifndef MIRAEL_HEADLESS // the core only touches the mapped memory, so headless builds leave out the GPU side
+        VkImage image              = VK_NULL_HANDLE;
+        VmaAllocation allocation   = VK_NULL_HANDLE;
+        vk::raii::ImageView view   = nullptr;
+        VkDescriptorSet descriptor = VK_NULL_HANDLE;
+#endif
+        void *mapped                  = nullptr;
+        uint32_t rowPitch             = 0;
+        bool written                  = false;
+        std::function<void()> cleanup = nullptr; // TODO: this doesn't feel right - reconsider how this cleans up
+    };
+
+    struct ImageBuffer {               // shared by App and Node, can outlive Node, App won't destroy until !live
+        Dimensions dim{};              // immutable upon creation by UI
+        std::atomic<bool> live = true; // core -> node, set to false when the core no longer needs it (wrong dimensions or overwritten)
+        uint64_t lastDisplayFrameWaitCount = 0; // used to ensure no longer in use before destruction
+        TripleBuffer<Image> images{};           // all images in the buffer have the same dimensions
+    };
+
+    enum class DataKind { None, String, Image };
+
+    struct BufferCarrier {
+        // this is the means by which Node passes a non-owning pointer back to the Core, safely marking dead if overwritten in the
+        // mailbox
+        ImageBuffer *buffer = nullptr;
+        ~BufferCarrier()
+        {
+            if (buffer)
+                buffer->live.store(false, std::memory_order_release);
+            buffer = nullptr;
+        }
+    };
+
+    struct Channel {
+        std::atomic<DataKind> dataKind = DataKind::None; // core -> node
+
+        // string channels
+        TripleBuffer<std::string> stringBuffer{}; // shared
+
+        // image channels
+        Mailbox<Dimensions> pendingDimensions{}; // core -> node - signals need for new ImageBuffer
+        Mailbox<BufferCarrier>
+            pendingBufferCarrier{}; // node -> core - gives the core the latest ImageBuffer, sets dead on destruction
+    };
+
+    // the node's pins, shared by the Display node and headless graphs - it has no saved config
+    static NodePinKeys getPinKeys() { return {.inputs = {"in"}, .outputs = {}}; }
+    static std::unique_ptr<DisplayCore> create(const NodePins &pins, std::shared_ptr<Channel> channel)
+    {
+        return std::make_unique<DisplayCore>(pins.inputs.at(0), std::move(channel));
+    }
+
+    DisplayCore(PinId inPinId, std::shared_ptr<Channel> channel) : inPinId_(inPinId), channel_(std::move(channel)) {}
+
+    struct ValueInfo {
+        DataKind kind;
+        Dimensions dim;
+        const void *pixelData;
+        uint32_t pixelPitch; // bytes per row of pixelData
+    };
+
+    void onFrame(const RunContext &context) override;
+    bool isPure() const override { return true; } // the node keeps showing what was last sent
+    bool hasPendingChanges() const override { return channel_->pendingBufferCarrier.hasPending(); }
+
+private:
+    PinId inPinId_;
+    std::shared_ptr<Channel> channel_;
+    lua_State *L                                         = nullptr;
+    std::unique_ptr<BufferCarrier> currentBufferCarrier_ = nullptr;
+    std::optional<Dimensions> requestedDimensions_{}; // posted, and not yet answered by a buffer of those dimensions
+
+    ValueInfo getValueInfo(const ValueBuffer *vbuf);
+
+    void acceptLatestBufferCarrier()
+    {
+        if (auto latest = channel_->pendingBufferCarrier.tryAcceptLatest())
+            currentBufferCarrier_ = std::move(latest);
+    }
+};
+
+} // namespace Mirael::NodeTypes::Cores
@@ -18,12 +18,8 @@ namespace Mirael::NodeTypes
 
 void Script::onDeserialize(const nlohmann::json &j)
 {
-    scriptName_   = j["name"].get<std::string>();
-    inputsCsv_    = j["inputs"].get<std::string>();
-    outputsCsv_   = j["outputs"].get<std::string>();
+    settings_     = Cores::ScriptCore::readSettings(j);
     inlineEditor_ = j["inline"].get<bool>();
-    script_       = j["script"].get<std::string>();
-    enabled_      = j["enabled"].get<bool>();
 
     auto rawCompileMode = j["compile"].get<std::string>();
     if (rawCompileMode == "none")
@@ -35,41 +31,20 @@ void Script::onDeserialize(const nlohmann::json &j)
     else
         throw std::runtime_error(
             std::format("Error during Script node deserializatoin: unknown script compilation mode: {}", rawCompileMode));
-
-    if (j.contains("errors")) {
-        auto rawErrorMode = j["errors"].get<std::string>();
-        if (rawErrorMode == "silent")
-            errorMode_ = RuntimeErrorHandlingMode::Silent;
-        else if (rawErrorMode == "visual")
-            errorMode_ = RuntimeErrorHandlingMode::Visual;
-        else if (rawErrorMode == "autodis")
-            errorMode_ = RuntimeErrorHandlingMode::AutoDisable;
-        else
-            throw std::runtime_error(
-                std::format("Error during Script node deserializatoin: unknown runtime error handling mode mode: {}", rawErrorMode));
-    } else
-        errorMode_ = RuntimeErrorHandlingMode::Visual;
 }
 
 void Script::onInit()
 {
-    if (!isDeserializing() && scriptName_.empty())
-        scriptName_ = std::format("Script (node {})", getId());
+    if (!isDeserializing() && settings_.name.empty())
+        settings_.name = std::format("Script (node {})", getId());
 
-    establishPins(PinDirection::Input, inputsCsv_, inputLabels_, inputPinIds_);
-    establishPins(PinDirection::Output, outputsCsv_, outputLabels_, outputPinIds_);
+    establishPins(PinDirection::Input, settings_.inputsCsv, inputLabels_, inputPinIds_);
+    establishPins(PinDirection::Output, settings_.outputsCsv, outputLabels_, outputPinIds_);
 }
 
 void Script::onOrderPins(std::vector<PinId> &pinOrder)
 {
-    pinOrder.clear();
-    pinOrder.reserve(inputPinIds_.size() + outputPinIds_.size());
-
-    for (auto id : inputPinIds_)
-        pinOrder.push_back(id);
-
-    for (auto id : outputPinIds_)
-        pinOrder.push_back(id);
+    orderPins(getPinIds(Cores::ScriptCore::getPinKeys(settings_)), pinOrder);
 }
 
 void Script::onShow()
@@ -91,17 +66,17 @@ void Script::onShow()
     };
 
     bool showErrorBackground =
-        (errorMode_ == RuntimeErrorHandlingMode::Visual || errorMode_ == RuntimeErrorHandlingMode::AutoDisable) &&
+        (settings_.errorMode == RuntimeErrorHandlingMode::Visual || settings_.errorMode == RuntimeErrorHandlingMode::AutoDisable) &&
         (autoDisabled_ || coreStatus_.scriptStatus == ScriptStatus::RuntimeError);
 
     if (showErrorBackground)
         ne::PushStyleColor(ne::StyleColor_NodeBg, App::get().getStyle().colors.errorNodeBackground);
 
     NodeEditorEx::StandardNode(
-        *this,                                                             // node
-        [this]() -> void { ImGui::TextUnformatted(scriptName_.c_str()); }, // header UI
-        pins.subspan(0, inputPinIds_.size()),                              // input pin order
-        pins.subspan(inputPinIds_.size()),                                 // output pin order
+        *this,                                                                // node
+        [this]() -> void { ImGui::TextUnformatted(settings_.name.c_str()); }, // header UI
+        pins.subspan(0, inputPinIds_.size()),                                 // input pin order
+        pins.subspan(inputPinIds_.size()),                                    // output pin order
         [&](size_t index, PinId id, PinDirection dir) -> float {
             auto labels = getPinLabels(dir);
             if (labels) {
@@ -124,13 +99,9 @@ void Script::onShow()
 
 void Script::onSerialize(nlohmann::json &j) const
 {
-    j["lang"]    = "lua"; // hardcoded until we support others
-    j["name"]    = scriptName_;
-    j["inputs"]  = inputsCsv_;
-    j["outputs"] = outputsCsv_;
-    j["inline"]  = inlineEditor_;
-    j["script"]  = script_;
-    j["enabled"] = enabled_;
+    Cores::ScriptCore::writeSettings(settings_, j);
+    j["lang"]   = "lua"; // hardcoded until we support others
+    j["inline"] = inlineEditor_;
 
     switch (compileMode_) {
         using enum ScriptCompilationMode;
@@ -147,22 +118,6 @@ void Script::onSerialize(nlohmann::json &j) const
         throw std::runtime_error(std::format("Error during Script node serializatoin: unknown script compilation mode: {}",
                                              static_cast<int>(compileMode_)));
     }
-
-    switch (errorMode_) {
-        using enum RuntimeErrorHandlingMode;
-    case Silent:
-        j["errors"] = "silent";
-        break;
-    case Visual:
-        j["errors"] = "visual";
-        break;
-    case AutoDisable:
-        j["errors"] = "autodis";
-        break;
-    default:
-        throw std::runtime_error(std::format("Error during Script node serializatoin: unknown runtime error handling mode: {}",
-                                             static_cast<int>(errorMode_)));
-    }
 }
 
 namespace
@@ -229,24 +184,40 @@ void Script::onShowProperties()
     bool postRequired = false;
     bool otherChange  = false;
 
-    if (ImGui::InputText("Name", &scriptName_))
+    if (ImGui::InputText("Name", &settings_.name))
         otherChange = true;
 
-    if (ImGui::InputText("Input Pins", &inputsCsv_)) {
+    if (ImGui::InputText("Input Pins", &settings_.inputsCsv)) {
         postRequired = true;
-        establishPins(PinDirection::Input, inputsCsv_, inputLabels_, inputPinIds_);
+        establishPins(PinDirection::Input, settings_.inputsCsv, inputLabels_, inputPinIds_);
     }
 
-    if (ImGui::InputText("Output Pins", &outputsCsv_)) {
+    if (ImGui::InputText("Output Pins", &settings_.outputsCsv)) {
         postRequired = true;
-        establishPins(PinDirection::Output, outputsCsv_, outputLabels_, outputPinIds_);
+        establishPins(PinDirection::Output, settings_.outputsCsv, outputLabels_, outputPinIds_);
     }
 
-    if (ImGui::Checkbox("Enabled", &enabled_)) {
+    if (ImGui::Checkbox("Enabled", &settings_.enabled)) {
         otherChange = true;
         putEnabled();
     }
 
+    if (ImGui::Checkbox("Pure", &settings_.pure)) {
+        otherChange = true;
+        putPure();
+    }
+    ImGui::SameLine();
+    ImGuiEx::ToolTipHint("A pure script only reads its inputs, and keeps no state between runs.  Under the Skip Unchanged "
+                         "execution mode, it then only runs when an input changes.");
+
+    if (ImGui::Checkbox("Numeric Pins", &settings_.numericPins)) {
+        otherChange = true;
+        putNumericPins();
+    }
+    ImGui::SameLine();
+    ImGuiEx::ToolTipHint("The script sees input and output as arrays of numbers, which LuaJIT compiles in place of any "
+                         "call.  Booleans read as 1 or 0, and all else that isn't a number as NaN.  See ScriptNode.md.");
+
     if (ImGui::Checkbox("Inline Editor", &inlineEditor_))
         otherChange = true;
 
@@ -266,14 +237,14 @@ void Script::onShowProperties()
         ImGui::EndCombo();
     }
 
-    if (ImGui::BeginCombo("Runtime Error Mode", to_display_string(errorMode_), ImGuiComboFlags_WidthFitPreview)) {
+    if (ImGui::BeginCombo("Runtime Error Mode", to_display_string(settings_.errorMode), ImGuiComboFlags_WidthFitPreview)) {
         static constexpr RuntimeErrorHandlingMode errorModes[] = {RuntimeErrorHandlingMode::Silent, RuntimeErrorHandlingMode::Visual,
                                                                   RuntimeErrorHandlingMode::AutoDisable};
         for (auto mode : errorModes) {
-            bool selected = mode == errorMode_;
+            bool selected = mode == settings_.errorMode;
             if (ImGui::Selectable(to_display_string(mode), selected)) {
-                errorMode_  = mode;
-                otherChange = true;
+                settings_.errorMode = mode;
+                otherChange         = true;
                 putErrorMode();
             }
             if (selected) {
@@ -316,7 +287,7 @@ void Script::onShowProperties()
         }
     }
 
-    if (ImGui::InputTextMultiline("###script", &script_, ImGui::GetContentRegionAvail(), ImGuiInputTextFlags_AllowTabInput)) {
+    if (ImGui::InputTextMultiline("###script", &settings_.script, ImGui::GetContentRegionAvail(), ImGuiInputTextFlags_AllowTabInput)) {
         otherChange = true;
         if (ScriptCompilationMode::Live == compileMode_) {
             ++scriptVersion_;
@@ -336,11 +307,8 @@ std::unique_ptr<NodeCore> Script::createCore()
     // should only be called once per Node instance
     assert(scriptVersion_ == 1);
     assert(latestPostedScriptVersion_ == 0);
-    postConfig();
-    assert(latestPostedScriptVersion_ == 1);
-    putEnabled();
-    putErrorMode();
-    return std::make_unique<Cores::ScriptCore>(channel_, buildDebugInfo());
+    latestPostedScriptVersion_ = scriptVersion_;
+    return Cores::ScriptCore::create(settings_, buildDebugInfo(), channel_);
 }
 
 Script::DebugInfo Script::buildDebugInfo()
@@ -354,10 +322,7 @@ Script::DebugInfo Script::buildDebugInfo()
 
 void Script::establishPins(PinDirection dir, const std::string &csv, std::vector<std::string> &labels, std::vector<PinId> &pinIds)
 {
-    labels.clear();
-    for (auto &&part : csv | std::views::split(',')) {
-        labels.emplace_back(part.begin(), part.end());
-    }
+    labels = Cores::ScriptCore::splitPinLabels(csv);
 
     const char *prefix = dir == PinDirection::Input ? "in" : "out";
 
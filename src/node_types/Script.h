@@ -2,6 +2,7 @@
 
 #include "Mailbox.h"
 #include "Node.h"
+#include "ScriptCore.h"
 
 namespace Mirael::NodeTypes
 {
@@ -11,39 +12,17 @@ class Script : public Node
 public:
     static const char *typeName() { return "script"; }
 
-    struct DebugInfo {                    // used for debug purposes
-        std::string graphNameWhenCreated; // will not be kept up-to-date with Graph name changes
-        std::string graphUid;
-        GraphId graphId;
-        NodeId nodeId;
-    };
-
-    using ScriptVersion = uint64_t;
     enum class ScriptCompilationMode { None, Live, Explicit };
-    enum class RuntimeErrorHandlingMode { Silent, Visual, AutoDisable };
-    enum class ScriptStatus { Empty, Good, CompileError, RuntimeError };
-
-    struct Config {
-        std::vector<PinId> inPins, outPins;
-        std::string scriptNameWhenPosted = ""; // used for debug purposes - only current as of the last script post
-        std::string script               = "";
-        ScriptVersion scriptVersion      = 0;
-    };
-
-    struct CoreStatus {
-        ScriptVersion receivedScriptVersion, runningScriptVersion;
-        ScriptStatus scriptStatus;
-        std::string errorScript;
-        std::string errorText;
-    };
-
-    struct Channel {
-        Mailbox<Config> pendingConfig;                                                      // ui -> core
-        Mailbox<CoreStatus> pendingCoreStatus;                                              // core -> ui
-        std::atomic<bool> enabled                       = true;                             // ui -> core
-        std::atomic<bool> autoDisabled                  = false;                            // core -> ui
-        std::atomic<RuntimeErrorHandlingMode> errorMode = RuntimeErrorHandlingMode::Visual; // ui->core
-    };
+
+    // the core defines what crosses the channel
+    using DebugInfo                = Cores::ScriptCore::DebugInfo;
+    using ScriptVersion            = Cores::ScriptCore::ScriptVersion;
+    using RuntimeErrorHandlingMode = Cores::ScriptCore::RuntimeErrorHandlingMode;
+    using Settings                 = Cores::ScriptCore::Settings;
+    using ScriptStatus             = Cores::ScriptCore::ScriptStatus;
+    using Config                   = Cores::ScriptCore::Config;
+    using CoreStatus               = Cores::ScriptCore::CoreStatus;
+    using Channel                  = Cores::ScriptCore::Channel;
 
 protected:
     void onDeserialize(const nlohmann::json &j) override;
@@ -60,17 +39,12 @@ private:
     std::shared_ptr<Channel> channel_ = std::make_shared<Channel>();
 
     // UI configuration
-    std::string scriptName_;
-    std::string inputsCsv_  = "in1,in2";
-    std::string outputsCsv_ = "out";
+    Settings settings_{};
     std::vector<std::string> inputLabels_;
     std::vector<std::string> outputLabels_;
-    bool inlineEditor_ = true;
-    std::string script_;
+    bool inlineEditor_           = true;
     ScriptVersion scriptVersion_ = 1, latestPostedScriptVersion_ = 0;
-    ScriptCompilationMode compileMode_  = ScriptCompilationMode::Live;
-    RuntimeErrorHandlingMode errorMode_ = RuntimeErrorHandlingMode::Visual;
-    bool enabled_                       = true;
+    ScriptCompilationMode compileMode_ = ScriptCompilationMode::Live;
 
     // pin information
     std::vector<PinId> inputPinIds_;
@@ -84,10 +58,8 @@ private:
 
     Config buildConfig()
     {
-        return Config{.inPins               = inputPinIds_,
-                      .outPins              = outputPinIds_,
-                      .scriptNameWhenPosted = scriptName_,
-                      .script               = script_,
+        return Config{.scriptNameWhenPosted = settings_.name,
+                      .script               = settings_.script,
                       .scriptVersion        = scriptVersion_};
     }
 
@@ -97,8 +69,10 @@ private:
         latestPostedScriptVersion_ = scriptVersion_;
     }
 
-    void putEnabled() { channel_->enabled.store(enabled_, std::memory_order_relaxed); }
-    void putErrorMode() { channel_->errorMode.store(errorMode_, std::memory_order_relaxed); }
+    void putEnabled() { channel_->enabled.store(settings_.enabled, std::memory_order_relaxed); }
+    void putErrorMode() { channel_->errorMode.store(settings_.errorMode, std::memory_order_relaxed); }
+    void putPure() { channel_->pure.store(settings_.pure, std::memory_order_relaxed); }
+    void putNumericPins() { channel_->numericPins.store(settings_.numericPins, std::memory_order_relaxed); }
 
     void updateCoreStatus()
     {
@@ -8,30 +8,135 @@
 namespace Mirael::NodeTypes::Cores
 {
 
-void ScriptCore::compileNewScript()
+ScriptCore::Settings ScriptCore::readSettings(const nlohmann::json &j)
 {
-    receivedScript_               = std::move(config_.script);
-    status_.receivedScriptVersion = config_.scriptVersion;
+    Settings settings;
+    settings.name        = j.value("name", settings.name);
+    settings.script      = j.value("script", settings.script);
+    settings.inputsCsv   = j.value("inputs", settings.inputsCsv);
+    settings.outputsCsv  = j.value("outputs", settings.outputsCsv);
+    settings.enabled     = j.value("enabled", settings.enabled);
+    settings.pure        = j.value("pure", settings.pure);
+    settings.numericPins = j.value("numericpins", settings.numericPins);
 
-    chunkName_ = std::format("{}/{}.v{}={}/{}", debugInfo_.graphId, debugInfo_.nodeId, config_.scriptVersion,
-                             debugInfo_.graphNameWhenCreated, config_.scriptNameWhenPosted);
+    if (j.contains("errors")) {
+        auto rawErrorMode = j["errors"].get<std::string>();
+        if (rawErrorMode == "silent")
+            settings.errorMode = RuntimeErrorHandlingMode::Silent;
+        else if (rawErrorMode == "visual")
+            settings.errorMode = RuntimeErrorHandlingMode::Visual;
+        else if (rawErrorMode == "autodis")
+            settings.errorMode = RuntimeErrorHandlingMode::AutoDisable;
+        else
+            throw std::runtime_error(
+                std::format("Error during Script node deserializatoin: unknown runtime error handling mode mode: {}", rawErrorMode));
+    }
+    return settings;
+}
 
-    auto ret = luaL_loadbuffer(L, receivedScript_.data(), receivedScript_.size(), chunkName_.c_str());
+void ScriptCore::writeSettings(const Settings &settings, nlohmann::json &j)
+{
+    j["name"]        = settings.name;
+    j["inputs"]      = settings.inputsCsv;
+    j["outputs"]     = settings.outputsCsv;
+    j["script"]      = settings.script;
+    j["enabled"]     = settings.enabled;
+    if (settings.pure)
+        j["pure"] = true; // only where set, as are the graph's settings since added
+    if (settings.numericPins)
+        j["numericpins"] = true;
 
-    if (ret != LUA_OK) {
-        status_.errorText = lua_tostring(L, -1);
-        lua_pop(L, 1);
-        status_.errorScript  = receivedScript_;
+    switch (settings.errorMode) {
+        using enum RuntimeErrorHandlingMode;
+    case Silent:
+        j["errors"] = "silent";
+        break;
+    case Visual:
+        j["errors"] = "visual";
+        break;
+    case AutoDisable:
+        j["errors"] = "autodis";
+        break;
+    default:
+        throw std::runtime_error(std::format("Error during Script node serializatoin: unknown runtime error handling mode: {}",
+                                             static_cast<int>(settings.errorMode)));
+    }
+}
+
+std::vector<std::string> ScriptCore::splitPinLabels(const std::string &csv)
+{
+    std::vector<std::string> labels;
+    for (auto &&part : csv | std::views::split(','))
+        labels.emplace_back(part.begin(), part.end());
+    return labels;
+}
+
+NodePinKeys ScriptCore::getPinKeys(const Settings &settings)
+{
+    NodePinKeys keys;
+    for (size_t n = 1, count = splitPinLabels(settings.inputsCsv).size(); n <= count; n++)
+        keys.inputs.push_back(std::format("in{}", n));
+    for (size_t n = 1, count = splitPinLabels(settings.outputsCsv).size(); n <= count; n++)
+        keys.outputs.push_back(std::format("out{}", n));
+    return keys;
+}
+
+std::unique_ptr<ScriptCore> ScriptCore::create(const Settings &settings, DebugInfo &&debugInfo, std::shared_ptr<Channel> channel)
+{
+    channel->pendingConfig.postNew(
+        std::make_unique<Config>(Config{.scriptNameWhenPosted = settings.name, .script = settings.script, .scriptVersion = 1}));
+    channel->enabled.store(settings.enabled, std::memory_order_relaxed);
+    channel->errorMode.store(settings.errorMode, std::memory_order_relaxed);
+    channel->pure.store(settings.pure, std::memory_order_relaxed);
+    channel->numericPins.store(settings.numericPins, std::memory_order_relaxed);
+    return std::make_unique<ScriptCore>(std::move(channel), std::move(debugInfo));
+}
+
+void ScriptCore::submitNewScript(ScriptCompiler &compiler)
+{
+    submittedScriptVersion_ = config_.scriptVersion;
+
+    auto chunkName = std::format("{}/{}.v{}={}/{}", debugInfo_.graphId, debugInfo_.nodeId, config_.scriptVersion,
+                                 debugInfo_.graphNameWhenCreated, config_.scriptNameWhenPosted);
+
+    // the result comes back through our channel, which the compiler keeps alive until then
+    compiler.submit(std::shared_ptr<ScriptCompiler::ResultMailbox>(channel_, &channel_->compiledScript), config_.scriptVersion,
+                    std::move(config_.script), std::move(chunkName));
+}
+
+void ScriptCore::loadReceivedScript(const RunContext &context)
+{
+    const auto &received          = *receivedScript_;
+    status_.receivedScriptVersion = received.version;
+
+    auto reportCompileError = [&](std::string errorText) {
+        status_.errorText    = std::move(errorText);
+        status_.errorScript  = received.script;
         status_.scriptStatus = ScriptStatus::CompileError;
         postStatus();
+    };
+
+    if (received.bytecode.empty()) {
+        reportCompileError(received.errorText);
+        return;
+    }
+
+    // loading bytecode skips parsing entirely, so costs the frame far less than compiling here would
+    auto ret = luaL_loadbuffer(L, received.bytecode.data(), received.bytecode.size(), received.chunkName.c_str());
+
+    if (ret != LUA_OK) {
+        reportCompileError(lua_tostring(L, -1));
+        lua_pop(L, 1);
         return;
     }
 
+    bindEnv(context); // once here, rather than on every run
+
     if (chunkRef_)
         luaL_unref(L, LUA_REGISTRYINDEX, *chunkRef_);
     chunkRef_ = luaL_ref(L, LUA_REGISTRYINDEX);
 
-    runningScript_               = receivedScript_;
+    runningScript_               = received.script;
     status_.runningScriptVersion = status_.receivedScriptVersion;
 
     autoDisabled_ = false;
@@ -43,22 +148,87 @@ void ScriptCore::compileNewScript()
     postStatus();
 }
 
-void ScriptCore::updatePinAccess(const RunContext &context)
+void ScriptCore::bindEnv(const RunContext &context)
+{
+    boundNumericPins_ = getNumericPins();
+    if (!boundNumericPins_) {
+        context.env->pushNodeEnvTable();
+        lua_setfenv(L, -2);
+        return;
+    }
+
+    // the env holds pointers to the slots, so they only ever grow, and do so here before the env is made
+    inputSlots_.resize(std::max(inputSlots_.size(), context.inputs.size() + 1));
+    outputSlots_.resize(std::max(outputSlots_.size(), context.outputs.size() + 1));
+    context.env->pushNodeEnvTable(inputSlots_.data(), outputSlots_.data());
+    lua_setfenv(L, -2);
+}
+
+namespace
 {
-    assert(context.env);
-    context.env->registerPins({.inPins = &config_.inPins, .outPins = &config_.outPins});
+
+// an output holding anything but a number or boolean starts as this NaN, whose payload sets it apart from any NaN a script
+// would write, so that it can be told whether the script wrote the output at all
+const double UnwrittenOutput = std::bit_cast<double>(uint64_t{0x7ff8'0000'dead'0000});
+
+// numeric pins read booleans as 1 or 0, and anything else that isn't a number (nil included) as NaN
+double toSlotValue(const ValueBuffer *buf, double otherwise = std::numeric_limits<double>::quiet_NaN())
+{
+    if (buf && buf->isDouble())
+        return *buf->toDouble();
+    else if (buf && buf->isBool())
+        return buf->toBool() ? 1.0 : 0.0;
+    else
+        return otherwise;
+}
+
+} // namespace
+
+void ScriptCore::readNumericInputs(const RunContext &context)
+{
+    if (!boundNumericPins_ || inputSlots_.size() <= context.inputs.size() || outputSlots_.size() <= context.outputs.size()) {
+        lua_rawgeti(L, LUA_REGISTRYINDEX, *chunkRef_);
+        bindEnv(context); // rebinds to slots grown for added pins
+        lua_pop(L, 1);
+    }
+
+    for (size_t i = 0; i < context.inputs.size(); i++)
+        inputSlots_[i + 1] = toSlotValue(context.inputs[i]);
+    for (size_t i = 0; i < context.outputs.size(); i++)
+        outputSlots_[i + 1] = toSlotValue(context.outputs[i], UnwrittenOutput);
+}
+
+void ScriptCore::writeNumericOutputs(const RunContext &context)
+{
+    // only slots the script changed are written, so that outputs it left alone keep any value that isn't a number
+    for (size_t i = 0; i < context.outputs.size(); i++) {
+        auto *buf = context.outputs[i];
+        if (buf && std::bit_cast<uint64_t>(outputSlots_[i + 1]) != std::bit_cast<uint64_t>(toSlotValue(buf, UnwrittenOutput)))
+            buf->setValue(outputSlots_[i + 1]);
+    }
 }
 
 void ScriptCore::runScript(const RunContext &context)
 {
-    if (autoDisabled_ || !chunkRef_ || !getEnabled())
+    enabled_ = getEnabled(); // as last seen by a run, for hasPendingChanges()
+    if (autoDisabled_ || !chunkRef_ || !enabled_)
         return;
 
+    const bool numericPins = getNumericPins();
+    if (numericPins)
+        readNumericInputs(context);
+    else if (boundNumericPins_) {
+        lua_rawgeti(L, LUA_REGISTRYINDEX, *chunkRef_);
+        bindEnv(context);
+        lua_pop(L, 1);
+    }
+
     lua_rawgeti(L, LUA_REGISTRYINDEX, *chunkRef_);
-    context.env->pushEnvTable();
-    lua_setfenv(L, -2);
     auto ret = lua_pcall(L, 0, 0, 0);
 
+    if (numericPins)
+        writeNumericOutputs(context); // even after an error, as writes through the proxies would have been made by then
+
     if (ret != LUA_OK) {
         bool willReport = status_.scriptStatus != ScriptStatus::CompileError;
         auto *errorText = lua_tostring(L, -1);
@@ -91,27 +261,34 @@ void ScriptCore::onFrame(const RunContext &context)
 {
     L = context.L;
 
-    bool configUpdated = tryAcceptLatestConfig() && config_.scriptVersion > status_.receivedScriptVersion;
-    if (configUpdated || needHandleLuaStateReset_) {
-        if (needHandleLuaStateReset_ && !configUpdated) {
-            config_.script = receivedScript_; // this is an awkward kludge.  see TD1 in TechDebt.md
-        }
-        needHandleLuaStateReset_ = false;
-        compileNewScript();
-        updatePinAccess(context);
+    // new scripts compile off our thread, so the prior script keeps running until the result comes back on a later frame
+    if (tryAcceptLatestConfig() && config_.scriptVersion > submittedScriptVersion_) {
+        assert(context.compiler);
+        submitNewScript(*context.compiler);
     }
 
-    assert(status_.receivedScriptVersion >
-           0); // the above should always compile a script on first frame, as the UI side should post config before create
+    if (auto compiled = channel_->compiledScript.tryAcceptLatest()) {
+        receivedScript_ = std::move(compiled);
+        loadReceivedScript(context);
+    } else if (needHandleLuaStateReset_ && receivedScript_)
+        loadReceivedScript(context); // reloads the latest script into the new lua state.  see TD1 in TechDebt.md
+    needHandleLuaStateReset_ = false;
 
     runScript(context);
 }
 
 void ScriptCore::onLuaStateReset()
 {
-    L                        = nullptr;
-    chunkRef_                = LUA_NOREF;
+    L = nullptr;
+    chunkRef_.reset();
     needHandleLuaStateReset_ = true;
 }
 
+void ScriptCore::onLuaStateMoved()
+{
+    if (L && chunkRef_)
+        luaL_unref(L, LUA_REGISTRYINDEX, *chunkRef_); // and with it the env bound to it
+    onLuaStateReset();                                // as it's reloaded the same way
+}
+
 } // namespace Mirael::NodeTypes::Cores
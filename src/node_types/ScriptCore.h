@@ -1,35 +1,90 @@
 #pragma once
 
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
 #include "lua.hpp"
 
 #include "Mailbox.h"
 #include "NodeCore.h"
-#include "Script.h"
+#include "ScriptCompiler.h"
 
 namespace Mirael::NodeTypes::Cores
 {
 
-using DebugInfo     = Script::DebugInfo;
-using ScriptVersion = Script::ScriptVersion;
-using ScriptStatus  = Script::ScriptStatus;
-using Config        = Script::Config;
-using CoreStatus    = Script::CoreStatus;
-using Channel       = Script::Channel;
-using ErrorMode     = Script::RuntimeErrorHandlingMode;
-
 class ScriptCore : public NodeCore
 {
 public:
+    struct DebugInfo {                    // used for debug purposes
+        std::string graphNameWhenCreated; // will not be kept up-to-date with Graph name changes
+        std::string graphUid;
+        GraphId graphId;
+        NodeId nodeId;
+    };
+
+    using ScriptVersion = uint64_t;
+    enum class RuntimeErrorHandlingMode { Silent, Visual, AutoDisable };
+    enum class ScriptStatus { Empty, Good, CompileError, RuntimeError };
+
+    struct Config {
+        std::string scriptNameWhenPosted = ""; // used for debug purposes - only current as of the last script post
+        std::string script               = "";
+        ScriptVersion scriptVersion      = 0;
+    };
+
+    struct CoreStatus {
+        ScriptVersion receivedScriptVersion, runningScriptVersion;
+        ScriptStatus scriptStatus;
+        std::string errorScript;
+        std::string errorText;
+    };
+
+    struct Channel {
+        Mailbox<Config> pendingConfig;                                                      // ui -> core
+        Mailbox<CoreStatus> pendingCoreStatus;                                              // core -> ui
+        ScriptCompiler::ResultMailbox compiledScript;                                       // compiler -> core
+        std::atomic<bool> enabled                       = true;                             // ui -> core
+        std::atomic<bool> autoDisabled                  = false;                            // core -> ui
+        std::atomic<RuntimeErrorHandlingMode> errorMode = RuntimeErrorHandlingMode::Visual; // ui->core
+        std::atomic<bool> pure                          = false;                            // ui -> core
+        std::atomic<bool> numericPins                   = false;                            // ui -> core
+    };
+
+    struct Settings { // the node's saved config that affects execution - the Script node keeps its editor's own
+        std::string name, script;
+        std::string inputsCsv = "in1,in2", outputsCsv = "out"; // the pins' labels, one pin per label
+        RuntimeErrorHandlingMode errorMode = RuntimeErrorHandlingMode::Visual;
+        bool enabled = true, pure = false, numericPins = false;
+    };
+
+    // the node's saved config and pins, shared by the Script node and headless graphs
+    static Settings readSettings(const nlohmann::json &j); // keys missing from j keep their defaults
+    static void writeSettings(const Settings &settings, nlohmann::json &j);
+    static std::vector<std::string> splitPinLabels(const std::string &csv);
+    static NodePinKeys getPinKeys(const Settings &settings); // in1 to inN, then out1 to outN, as labelled
+
+    // posts the script as its first version, for the new core to submit on its first frame
+    static std::unique_ptr<ScriptCore> create(const Settings &settings, DebugInfo &&debugInfo, std::shared_ptr<Channel> channel);
+
     ScriptCore(std::shared_ptr<Channel> channel, DebugInfo &&debugInfo) : channel_(channel), debugInfo_(std::move(debugInfo)) {}
 
 private:
+    using ErrorMode = RuntimeErrorHandlingMode;
+
     std::shared_ptr<Channel> channel_;
     Config config_{};
     CoreStatus status_{};
     bool enabled_      = true;
     bool autoDisabled_ = false;
 
-    std::string receivedScript_, runningScript_;
+    ScriptVersion submittedScriptVersion_ = 0;
+    std::unique_ptr<ScriptCompiler::Result> receivedScript_{}; // the latest compiled, kept to reload into a new lua state
+    std::string runningScript_;
 
     DebugInfo debugInfo_{};
 
@@ -45,21 +100,40 @@ private:
             return false;
     }
 
-    bool getEnabled() { return channel_->enabled.load(std::memory_order_relaxed); }
+    bool getEnabled() const { return channel_->enabled.load(std::memory_order_relaxed); }
+    bool getNumericPins() const { return channel_->numericPins.load(std::memory_order_relaxed); }
     ErrorMode getErrorMode() { return channel_->errorMode.load(std::memory_order_relaxed); }
 
-    lua_State *L = nullptr; // handy alias for context.L
-    std::string chunkName_{"(none)"};
-    std::optional<int> chunkRef_{};
+    lua_State *L = nullptr;         // handy alias for context.L
+    std::optional<int> chunkRef_{}; // the loaded chunk, already bound to its env
     bool needHandleLuaStateReset_ = false;
 
-    void compileNewScript();
-    void updatePinAccess(const RunContext &context);
+    // numeric pins - each array is indexed by slot + 1, as scripts index pins from 1, so [0] is unused
+    std::vector<double> inputSlots_, outputSlots_;
+    bool boundNumericPins_ = false; // whether the chunk's env was made for numeric pins
+
+    void submitNewScript(ScriptCompiler &compiler);
+    void loadReceivedScript(const RunContext &context);
+    void bindEnv(const RunContext &context); // binds the function atop the lua stack to a new env for this node
     void runScript(const RunContext &context);
+    void readNumericInputs(const RunContext &context);
+    void writeNumericOutputs(const RunContext &context);
 
 protected:
     void onFrame(const RunContext &context) override;
     void onLuaStateReset() override;
+    void onLuaStateMoved() override;
+
+    // scripts reach lua only through their context, so the Runner may spread them across its lua states
+    CoreAffinity getAffinity() const override { return CoreAffinity::AnyLuaState; }
+
+    // only the user knows whether a script is pure, i.e. neither keeps state between runs nor reads anything but its inputs
+    bool isPure() const override { return channel_->pure.load(std::memory_order_relaxed); }
+    bool hasPendingChanges() const override
+    {
+        return channel_->pendingConfig.hasPending() || channel_->compiledScript.hasPending() || needHandleLuaStateReset_ ||
+               getEnabled() != enabled_ || (chunkRef_ && getNumericPins() != boundNumericPins_);
+    }
 };
 
 } // namespace Mirael::NodeTypes::Cores
\ No newline at end of file
@@ -17,26 +17,16 @@ namespace ne = ax::NodeEditor;
 namespace Mirael::NodeTypes
 {
 
-void Switch::onDeserialize(const nlohmann::json &j)
-{
-    if (j.empty())
-        return;
-
-    enabled_    = j["enabled"].get<bool>();
-    dynamic_    = j["dynamic"].get<bool>();
-    inputCount_ = j["n"].get<int>();
-    if (j.contains("choice"))
-        manualChoice_ = j["choice"].get<int>();
-}
+void Switch::onDeserialize(const nlohmann::json &j) { settings_ = Cores::SwitchCore::readSettings(j); }
 
 void Switch::onInit()
 {
     choicePinId_ = 0;
-    if (dynamic_)
+    if (settings_.dynamic)
         handleToggleDynamic();
 
-    inputs_.reserve(inputCount_);
-    for (int n : std::views::iota(1, inputCount_ + 1)) {
+    inputs_.reserve(settings_.inputCount);
+    for (int n : std::views::iota(1, settings_.inputCount + 1)) {
         addSwitchInputPin(n);
     }
 
@@ -45,17 +35,9 @@ void Switch::onInit()
 
 void Switch::onOrderPins(std::vector<PinId> &pinOrder)
 {
-    pinOrder.clear();
-    pinOrder.reserve(getPinCount());
-
-    if (dynamic_)
-        pinOrder.push_back(choicePinId_);
-
-    for (auto &input : inputs_)
-        pinOrder.push_back(input.id);
-
-    outPinIndex_ = pinOrder.size();
-    pinOrder.push_back(outPinId_);
+    const auto keys = Cores::SwitchCore::getPinKeys(settings_);
+    orderPins(getPinIds(keys), pinOrder);
+    outPinIndex_ = keys.inputs.size();
 }
 
 void Switch::onShow()
@@ -71,12 +53,12 @@ void Switch::onShow()
         [this](size_t index, PinId id, PinDirection dir) -> float {
             switch (dir) {
             case PinDirection::Input:
-                if (dynamic_ && id == choicePinId_) {
+                if (settings_.dynamic && id == choicePinId_) {
                     return ImGui::CalcTextSize("choice").x;
                 } else {
-                    auto &[n, checkPinId, label] = dynamic_ ? inputs_[index - 1] : inputs_[index];
+                    auto &[n, checkPinId, label] = settings_.dynamic ? inputs_[index - 1] : inputs_[index];
                     assert(id == checkPinId);
-                    if (dynamic_)
+                    if (settings_.dynamic)
                         return ImGui::CalcTextSize(label.c_str()).x;
                     else {
                         return ImGui::GetFrameHeight() + ImGui::GetStyle().ItemInnerSpacing.x + ImGui::CalcTextSize(label.c_str()).x;
@@ -93,25 +75,25 @@ void Switch::onShow()
         [this, &changed](size_t index, PinId id, PinDirection dir) -> void {
             switch (dir) {
             case PinDirection::Input:
-                if (dynamic_ && id == choicePinId_) {
+                if (settings_.dynamic && id == choicePinId_) {
                     ImGui::AlignTextToFramePadding();
                     ImGui::TextUnformatted("choice");
                 } else {
-                    auto &[n, checkPinId, label] = dynamic_ ? inputs_[index - 1] : inputs_[index];
+                    auto &[n, checkPinId, label] = settings_.dynamic ? inputs_[index - 1] : inputs_[index];
                     assert(id == checkPinId);
-                    if (dynamic_)
+                    if (settings_.dynamic)
                         ImGui::TextUnformatted(label.c_str());
                     else {
-                        if (ImGui::RadioButton(label.c_str(), manualChoice_ == n)) {
-                            if (manualChoice_ != n)
+                        if (ImGui::RadioButton(label.c_str(), settings_.manualChoice == n)) {
+                            if (settings_.manualChoice != n)
                                 changed = true;
-                            manualChoice_ = n;
+                            settings_.manualChoice = n;
                         }
                     }
                 }
                 break;
             case PinDirection::Output:
-                if (ImGui::Checkbox("out", &enabled_))
+                if (ImGui::Checkbox("out", &settings_.enabled))
                     changed = true;
                 break;
             default:
@@ -126,41 +108,34 @@ void Switch::onShow()
     }
 }
 
-void Switch::onSerialize(nlohmann::json &j) const
-{
-    j["enabled"] = enabled_;
-    j["dynamic"] = dynamic_;
-    j["n"]       = inputCount_;
-    if (manualChoice_ != 0)
-        j["choice"] = manualChoice_;
-}
+void Switch::onSerialize(nlohmann::json &j) const { Cores::SwitchCore::writeSettings(settings_, j); }
 
 void Switch::onShowProperties()
 {
     bool changed = false;
 
-    int priorInputCount = inputCount_;
-    ImGui::InputInt("Inputs", &inputCount_);
-    inputCount_ = std::clamp(inputCount_, 1, 100);
-    if (priorInputCount != inputCount_) {
+    int priorInputCount = settings_.inputCount;
+    ImGui::InputInt("Inputs", &settings_.inputCount);
+    settings_.inputCount = std::clamp(settings_.inputCount, 1, 100);
+    if (priorInputCount != settings_.inputCount) {
         changed = true;
-        if (inputCount_ > priorInputCount)
+        if (settings_.inputCount > priorInputCount)
             expandInputs();
         else {
-            assert(inputCount_ < priorInputCount);
+            assert(settings_.inputCount < priorInputCount);
             reduceInputs();
         }
     }
 
-    changed |= ImGui::Checkbox("Enabled", &enabled_);
+    changed |= ImGui::Checkbox("Enabled", &settings_.enabled);
 
-    bool preDynamic = dynamic_;
-    changed |= ImGui::Checkbox("Dynamic", &dynamic_);
-    if (preDynamic != dynamic_)
+    bool preDynamic = settings_.dynamic;
+    changed |= ImGui::Checkbox("Dynamic", &settings_.dynamic);
+    if (preDynamic != settings_.dynamic)
         handleToggleDynamic();
 
-    if (!dynamic_)
-        changed |= ImGui::InputInt("Manual Choice", &manualChoice_);
+    if (!settings_.dynamic)
+        changed |= ImGui::InputInt("Manual Choice", &settings_.manualChoice);
 
     if (changed) {
         raiseModified(ChangeImpact::NodeConfig);
@@ -168,56 +143,12 @@ void Switch::onShowProperties()
     }
 }
 
-void Switch::Core::onFrame(const RunContext &context)
-{
-    acceptLatestConfig();
-
-    auto output = context.getOutput(config_.outPin);
-
-    if (!config_.enabled) {
-        if (output)
-            output->clear();
-        return;
-    }
-
-    int choice;
-
-    if (config_.dynamic) {
-        if (auto buf = context.getFirstInput(config_.choicePin)) {
-            auto val = buf->toInt();
-            if (val)
-                choice = *val;
-            else
-                choice = 0; // TODO: in this case we may also want to set a visual error flag
-        } else {
-            choice = 0;
-        }
-    } else {
-        choice = config_.manualChoice;
-    }
-
-    if (choice < 1 || choice > config_.inPins.size()) {
-        if (output)
-            output->clear();
-        // TODO: also set visual error here
-        return;
-    }
-
-    auto input = context.getFirstInput(config_.inPins[choice - 1]);
-    if (output) {
-        if (input)
-            output->setValue(*input);
-        else
-            output->clear();
-    }
-}
-
 void Switch::expandInputs()
 {
-    if (inputCount_ > inputs_.size())
-        inputs_.reserve(inputCount_);
+    if (settings_.inputCount > inputs_.size())
+        inputs_.reserve(settings_.inputCount);
 
-    while (inputCount_ > inputs_.size()) {
+    while (settings_.inputCount > inputs_.size()) {
         int pinNum = static_cast<int>(inputs_.size()) + 1;
         addSwitchInputPin(pinNum);
     }
@@ -227,9 +158,9 @@ void Switch::reduceInputs()
 {
     auto priorSize = static_cast<int>(inputs_.size());
 
-    inputs_.resize(inputCount_);
+    inputs_.resize(settings_.inputCount);
 
-    while (priorSize > inputCount_) {
+    while (priorSize > settings_.inputCount) {
         int pinNum = priorSize--;
         removeSwitchInputPin(pinNum);
     }
@@ -250,9 +181,9 @@ void Switch::removeSwitchInputPin(int pinNumber)
 
 void Switch::handleToggleDynamic()
 {
-    if (dynamic_ && !choicePinId_) {
+    if (settings_.dynamic && !choicePinId_) {
         choicePinId_ = addPin("choice", {.direction = PinDirection::Input});
-    } else if (choicePinId_ && !dynamic_) {
+    } else if (choicePinId_ && !settings_.dynamic) {
         removePin("choice");
         choicePinId_ = 0;
     } else {
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Node.h"
+#include "SwitchCore.h"
 
 namespace Mirael::NodeTypes
 {
@@ -19,59 +20,21 @@ protected:
 
     void onShowProperties() override;
 
-    struct Config {
-        std::vector<PinId> inPins;
-        PinId choicePin, outPin;
-        int manualChoice;
-        bool enabled, dynamic;
-    };
-
-    struct Channel {
-        Mailbox<Config> pendingConfig;
-    };
-
-    class Core : public NodeCore
-    {
-    public:
-        Core(Config &&initialConfig, std::shared_ptr<Channel> channel) : config_(std::move(initialConfig)), channel_(channel) {}
-
-    protected:
-        void onFrame(const RunContext &context) override;
-
-    private:
-        Config config_;
-        std::shared_ptr<Channel> channel_;
-
-        void acceptLatestConfig()
-        {
-            if (auto taken = channel_->pendingConfig.tryAcceptLatest())
-                config_ = std::move(*taken);
-        }
-    };
+    using Settings = Cores::SwitchCore::Settings;
+    using Config   = Cores::SwitchCore::Config;
+    using Channel  = Cores::SwitchCore::Channel;
 
-    virtual std::unique_ptr<NodeCore> createCore() { return std::make_unique<Core>(buildConfig(), channel_); }
+    virtual std::unique_ptr<NodeCore> createCore() { return std::make_unique<Cores::SwitchCore>(buildConfig(), channel_); }
 
 private:
     std::shared_ptr<Channel> channel_ = std::make_shared<Channel>();
     Config buildConfig() const
     {
-        std::vector<PinId> inPins;
-        inPins.reserve(inputs_.size());
-        for (auto &s : inputs_)
-            inPins.push_back(s.id);
-        return Config{.inPins       = std::move(inPins),
-                      .choicePin    = choicePinId_,
-                      .outPin       = outPinId_,
-                      .manualChoice = manualChoice_,
-                      .enabled      = enabled_,
-                      .dynamic      = dynamic_};
+        return Cores::SwitchCore::buildConfig(settings_, getPinIds(Cores::SwitchCore::getPinKeys(settings_)));
     }
     void postConfig() { channel_->pendingConfig.postNew(std::make_unique<Config>(buildConfig())); }
 
-    bool enabled_     = true;
-    bool dynamic_     = true;
-    int inputCount_   = 2;
-    int manualChoice_ = 0;
+    Settings settings_{};
     PinId choicePinId_{}, outPinId_{};
     struct InputPin {
         int n;
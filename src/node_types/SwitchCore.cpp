@@ -0,0 +1,92 @@
+#include "pch.h"
+
+#include "SwitchCore.h"
+
+namespace Mirael::NodeTypes::Cores
+{
+
+SwitchCore::Settings SwitchCore::readSettings(const nlohmann::json &j)
+{
+    Settings settings;
+    settings.enabled      = j.value("enabled", settings.enabled);
+    settings.dynamic      = j.value("dynamic", settings.dynamic);
+    settings.inputCount   = j.value("n", settings.inputCount);
+    settings.manualChoice = j.value("choice", settings.manualChoice);
+    return settings;
+}
+
+void SwitchCore::writeSettings(const Settings &settings, nlohmann::json &j)
+{
+    j["enabled"] = settings.enabled;
+    j["dynamic"] = settings.dynamic;
+    j["n"]       = settings.inputCount;
+    if (settings.manualChoice != 0)
+        j["choice"] = settings.manualChoice;
+}
+
+NodePinKeys SwitchCore::getPinKeys(const Settings &settings)
+{
+    NodePinKeys keys{.inputs = {}, .outputs = {"out"}};
+    if (settings.dynamic)
+        keys.inputs.emplace_back("choice");
+    for (int n = 1; n <= settings.inputCount; n++)
+        keys.inputs.push_back(std::format("in{}", n));
+    return keys;
+}
+
+SwitchCore::Config SwitchCore::buildConfig(const Settings &settings, const NodePins &pins)
+{
+    const auto firstIn = pins.inputs.begin() + (settings.dynamic ? 1 : 0);
+    return Config{.inPins       = std::vector<PinId>(firstIn, pins.inputs.end()),
+                  .choicePin    = settings.dynamic ? pins.inputs.at(0) : 0,
+                  .outPin       = pins.outputs.at(0),
+                  .manualChoice = settings.manualChoice,
+                  .enabled      = settings.enabled,
+                  .dynamic      = settings.dynamic};
+}
+
+void SwitchCore::onFrame(const RunContext &context)
+{
+    acceptLatestConfig();
+
+    auto output = context.getOutput(config_.outPin);
+
+    if (!config_.enabled) {
+        if (output)
+            output->clear();
+        return;
+    }
+
+    int choice;
+
+    if (config_.dynamic) {
+        if (auto buf = context.getFirstInput(config_.choicePin)) {
+            auto val = buf->toInt(context.L);
+            if (val)
+                choice = *val;
+            else
+                choice = 0; // TODO: in this case we may also want to set a visual error flag
+        } else {
+            choice = 0;
+        }
+    } else {
+        choice = config_.manualChoice;
+    }
+
+    if (choice < 1 || choice > config_.inPins.size()) {
+        if (output)
+            output->clear();
+        // TODO: also set visual error here
+        return;
+    }
+
+    auto input = context.getFirstInput(config_.inPins[choice - 1]);
+    if (output) {
+        if (input)
+            output->setValue(*input);
+        else
+            output->clear();
+    }
+}
+
+} // namespace Mirael::NodeTypes::Cores
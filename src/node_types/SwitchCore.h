@@ -0,0 +1,62 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "Mailbox.h"
+#include "NodeCore.h"
+
+namespace Mirael::NodeTypes::Cores
+{
+
+class SwitchCore : public NodeCore
+{
+public:
+    struct Config {
+        std::vector<PinId> inPins;
+        PinId choicePin, outPin;
+        int manualChoice;
+        bool enabled, dynamic;
+    };
+
+    struct Channel {
+        Mailbox<Config> pendingConfig;
+    };
+
+    struct Settings { // the node's saved config, from which its pins and Config follow
+        int inputCount = 2, manualChoice = 0;
+        bool enabled = true, dynamic = true;
+    };
+
+    // the node's saved config and pins, shared by the Switch node and headless graphs
+    static Settings readSettings(const nlohmann::json &j); // keys missing from j keep their defaults
+    static void writeSettings(const Settings &settings, nlohmann::json &j);
+    static NodePinKeys getPinKeys(const Settings &settings); // the choice pin first (if dynamic), then in1 to inN
+    static Config buildConfig(const Settings &settings, const NodePins &pins);
+    static std::unique_ptr<SwitchCore> create(const Settings &settings, const NodePins &pins, std::shared_ptr<Channel> channel)
+    {
+        return std::make_unique<SwitchCore>(buildConfig(settings, pins), std::move(channel));
+    }
+
+    SwitchCore(Config &&initialConfig, std::shared_ptr<Channel> channel) : config_(std::move(initialConfig)), channel_(channel) {}
+
+protected:
+    void onFrame(const RunContext &context) override;
+    bool isPure() const override { return true; }
+    bool hasPendingChanges() const override { return channel_->pendingConfig.hasPending(); }
+    bool forwardsLuaValues() const override { return true; } // its output is whichever input is chosen
+
+private:
+    Config config_;
+    std::shared_ptr<Channel> channel_;
+
+    void acceptLatestConfig()
+    {
+        if (auto taken = channel_->pendingConfig.tryAcceptLatest())
+            config_ = std::move(*taken);
+    }
+};
+
+} // namespace Mirael::NodeTypes::Cores
@@ -12,13 +12,9 @@ namespace ne = ax::NodeEditor;
 namespace Mirael::NodeTypes
 {
 
-void Value::onDeserialize(const nlohmann::json &j)
-{
-    if (!j.empty())
-        value_ = j["value"].get<std::string>();
-}
+void Value::onDeserialize(const nlohmann::json &j) { value_ = Cores::ValueCore::readValue(j); }
 
-void Value::onInit() { outPinId_ = addPin("out", {.direction = PinDirection::Output}); }
+void Value::onInit() { outPinId_ = addPins(Cores::ValueCore::getPinKeys()).outputs.front(); }
 
 void Value::onShow()
 {
@@ -40,18 +36,6 @@ void Value::onShow()
     ne::EndNode();
 }
 
-void Value::onSerialize(nlohmann::json &j) const
-{
-    if (!value_.empty())
-        j["value"] = value_;
-}
-
-void Value::Core::onFrame(const RunContext &context)
-{
-    acceptLatestValue();
-
-    if (auto buf = context.getOutput(outPinId_))
-        buf->setValue(value_);
-}
+void Value::onSerialize(nlohmann::json &j) const { Cores::ValueCore::writeValue(value_, j); }
 
 } // namespace Mirael::NodeTypes
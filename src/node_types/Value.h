@@ -1,8 +1,7 @@
 #pragma once
 
 #include "Node.h"
-
-#include "Mailbox.h"
+#include "ValueCore.h"
 
 namespace Mirael::NodeTypes
 {
@@ -18,34 +17,11 @@ protected:
     void onShow() override;
     void onSerialize(nlohmann::json &j) const override;
 
-    struct Channel {
-        Mailbox<std::string> pendingValue;
-    };
-
-    class Core : public NodeCore
-    {
-    public:
-        Core(PinId outPinId, std::shared_ptr<Channel> channel) : outPinId_(outPinId), channel_(channel) {}
-
-    protected:
-        void onFrame(const RunContext &context) override;
-
-    private:
-        std::shared_ptr<Channel> channel_;
-        std::string value_{};
-        PinId outPinId_;
-
-        void acceptLatestValue()
-        {
-            if (auto taken = channel_->pendingValue.tryAcceptLatest())
-                value_ = std::move(*taken);
-        }
-    };
+    using Channel = Cores::ValueCore::Channel;
 
     std::unique_ptr<NodeCore> createCore()
     {
-        postValue();
-        return std::make_unique<Core>(outPinId_, channel_);
+        return Cores::ValueCore::create(value_, getPinIds(Cores::ValueCore::getPinKeys()), channel_);
     };
 
 private:
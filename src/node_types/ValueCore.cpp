@@ -0,0 +1,16 @@
+#include "pch.h"
+
+#include "ValueCore.h"
+
+namespace Mirael::NodeTypes::Cores
+{
+
+void ValueCore::onFrame(const RunContext &context)
+{
+    acceptLatestValue();
+
+    if (auto buf = context.getOutput(outPinId_))
+        buf->setValue(value_);
+}
+
+} // namespace Mirael::NodeTypes::Cores
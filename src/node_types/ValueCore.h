@@ -0,0 +1,54 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include <nlohmann/json.hpp>
+
+#include "Mailbox.h"
+#include "NodeCore.h"
+
+namespace Mirael::NodeTypes::Cores
+{
+
+class ValueCore : public NodeCore
+{
+public:
+    struct Channel {
+        Mailbox<std::string> pendingValue;
+    };
+
+    // the node's saved value and pins, shared by the Value node and headless graphs
+    static std::string readValue(const nlohmann::json &j) { return j.value("value", ""); }
+    static void writeValue(const std::string &value, nlohmann::json &j)
+    {
+        if (!value.empty())
+            j["value"] = value;
+    }
+    static NodePinKeys getPinKeys() { return {.inputs = {}, .outputs = {"out"}}; }
+    static std::unique_ptr<ValueCore> create(const std::string &value, const NodePins &pins, std::shared_ptr<Channel> channel)
+    {
+        channel->pendingValue.postNew(std::make_unique<std::string>(value)); // taken on the core's first frame
+        return std::make_unique<ValueCore>(pins.outputs.at(0), std::move(channel));
+    }
+
+    ValueCore(PinId outPinId, std::shared_ptr<Channel> channel) : outPinId_(outPinId), channel_(channel) {}
+
+protected:
+    void onFrame(const RunContext &context) override;
+    bool isPure() const override { return true; } // has no inputs, so only runs for a new value
+    bool hasPendingChanges() const override { return channel_->pendingValue.hasPending(); }
+
+private:
+    PinId outPinId_;
+    std::shared_ptr<Channel> channel_;
+    std::string value_{};
+
+    void acceptLatestValue()
+    {
+        if (auto taken = channel_->pendingValue.tryAcceptLatest())
+            value_ = std::move(*taken);
+    }
+};
+
+} // namespace Mirael::NodeTypes::Cores
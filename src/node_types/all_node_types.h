@@ -1,5 +1,6 @@
 #pragma once
 
+#include "Array.h"
 #include "Comment.h"
 #include "Counter.h"
 #include "Display.h"
@@ -14,7 +15,7 @@ template <typename F> inline void registerAll(F &&registrar)
 {
     registrar.template operator()<
         // === list each Node-dervied class once, order doesn't matter ===
-        Comment, Counter, Display, Script, Switch, Value
+        Array, Comment, Counter, Display, Script, Switch, Value
         // ===============================================================
         >();
 }
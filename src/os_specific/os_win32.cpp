@@ -9,6 +9,7 @@
 #include <optional>
 #include <dwmapi.h>
 #include <windows.h>
+#include <timeapi.h>
 
 #include "os_win32.h"
 #include "resource.h"
@@ -54,6 +55,16 @@ void customizeSeparatedWindow(GLFWwindow *window)
     setWindowIcon(hwnd);
 }
 
+void beginFineTimerResolution()
+{
+    timeBeginPeriod(1);
+}
+
+void endFineTimerResolution()
+{
+    timeEndPeriod(1);
+}
+
 } // namespace Mirael::WindowsOnly
 
 #endif // WIN32
\ No newline at end of file
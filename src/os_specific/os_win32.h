@@ -10,6 +10,11 @@ namespace Mirael::WindowsOnly
 void customizeMainWindow(GLFWwindow *mainWindow);
 void customizeSeparatedWindow(GLFWwindow *window);
 
+// raises the system timer's resolution to 1 ms while the app runs, as timed waits (the Runners' frame waits among them)
+// otherwise wake at its default 15.6 ms granularity
+void beginFineTimerResolution();
+void endFineTimerResolution();
+
 };
 
 #endif // WIN32
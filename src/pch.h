@@ -1,10 +1,15 @@
 #pragma once
 
+// MIRAEL_HEADLESS builds (e.g. mirael_bench) compile only the engine, without any UI or GPU dependencies
+
+#ifndef MIRAEL_HEADLESS
 #include "imgui.h"
 #include "implot.h"
+#endif
 #include "lua.hpp"
 #include "readerwriterqueue.h"
 
+#ifndef MIRAEL_HEADLESS
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #define GLM_ENABLE_EXPERIMENTAL
@@ -23,6 +28,7 @@
 
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
+#endif
 
 #include <nlohmann/json.hpp>
 
@@ -49,4 +55,6 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
+#ifdef _MSC_VER
 #include <xutility>
+#endif